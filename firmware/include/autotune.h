@@ -0,0 +1,90 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ========================================================================= *
+ * RPM_PID AUTOTUNER (CONFIG_MOTOR_AUTOTUNE)                                 *
+ * ========================================================================= *
+ * Identifies the speed plant around one operating point and derives       *
+ * rpm_pid's PI gains and feedforward from it. Runs in the PID thread as   *
+ * the speed loop of MOTOR_STATE_AUTOTUNE, in three phases:                *
+ *                                                                           *
+ *   SETTLE  rpm_pid holds the operating point; once inside the band, the  *
+ *           mean duty u0 and speed w0 are taken.                           *
+ *   STEP    open loop at u0 + d; the new steady speed gives the static    *
+ *           gain K = Δw / d (rpm per % duty).                              *
+ *   RELAY   Åström–Hägglund relay with hysteresis: u0 ± d, switching at    *
+ *           rpm ± eps. The limit cycle's period Tu and amplitude a give    *
+ *           the ultimate gain Ku = 4d / (π·sqrt(a² − eps²)).               *
+ *                                                                           *
+ * K, Ku and Tu fit a first-order-plus-dead-time model (gain K, time       *
+ * constant T, dead time L), tuned with SIMC (Skogestad) for a PI with     *
+ * closed-loop time constant L. The feedforward is the line through        *
+ * (w0, u0) with slope 1/K.                                                 */
+
+enum autotune_status {
+    AUTOTUNE_IDLE,
+    AUTOTUNE_RUNNING,
+    AUTOTUNE_DONE,
+    AUTOTUNE_FAILED,
+};
+
+enum autotune_error {
+    AUTOTUNE_OK,
+    AUTOTUNE_ERR_SETTLE,        // never held the operating point
+    AUTOTUNE_ERR_GAIN,          // step did not raise the speed
+    AUTOTUNE_ERR_RELAY,         // no usable limit cycle
+    AUTOTUNE_ERR_MODEL,         // K·Ku <= 1: no FOPDT fits
+    AUTOTUNE_ERR_ABORTED,       // mode changed mid-run
+};
+
+struct autotune_result {
+    uint16_t run;               // bumps on every start and every finish
+    uint8_t  status;            // enum autotune_status
+    uint8_t  error;             // enum autotune_error
+    int32_t  rpm;               // operating point
+    uint8_t  cycles;            // relay cycles averaged
+
+    /* Identified plant */
+    float    u0_pct;            // duty holding rpm
+    float    k_rpm_pct;         // static gain K, rpm per % duty
+    float    tau_s;             // T
+    float    dead_s;            // L
+    float    ku;                // ultimate gain, % per rpm
+    float    tu_s;              // ultimate period
+    float    amp_rpm;           // relay limit-cycle amplitude
+
+    /* Derived rpm_pid settings */
+    float    kp, ki;
+    float    ff_gain, ff_offset;
+};
+
+/** @brief Begin an experiment at @p rpm (> 0). PID thread only. */
+void autotune_start(int32_t rpm);
+
+/** @brief Fail a running experiment with AUTOTUNE_ERR_ABORTED. */
+void autotune_abort(void);
+
+/** @brief True while rpm_pid drives the bridge (SETTLE); false while the
+ *  experiment's own duty does (STEP, RELAY). */
+bool autotune_pid_holds(void);
+
+/** @brief One control tick of the experiment.
+ *  @param speed_rpm  Measured speed in the commanded direction.
+ *  @param duty_pct   rpm_pid's duty this tick while autotune_pid_holds().
+ *  @return Duty to apply while !autotune_pid_holds(), else @p duty_pct.
+ */
+float autotune_step(int32_t speed_rpm, float duty_pct, float dt);
+
+/** @brief Status of the current or last experiment. PID thread only. */
+uint8_t autotune_get_status(void);
+
+/** @brief Consistent copy of the current or last result. Any thread. */
+void autotune_get_result(struct autotune_result *out);
+
+/** @brief Back to IDLE with the result cleared (motor_control_reset()). */
+void autotune_reset(void);
+
+#endif /* AUTOTUNE_H */
@@ -0,0 +1,39 @@
+#ifndef BENCH_CLOCK_H_
+#define BENCH_CLOCK_H_
+
+#include <zephyr/kernel.h>
+#include <stdint.h>
+
+/* ========================================================================= *
+ * SELF-TEST / BENCH CLOCK                                                   *
+ * ========================================================================= *
+ * On target the boot-time benches count k_cycle_get_32() CPU cycles. On    *
+ * native_sim that counter is the simulated clock, which stands still while *
+ * code runs, so there the benches read the host's CLOCK_MONOTONIC through  *
+ * host_clock.c, built on the runner side, and report nanoseconds instead.  *
+ * BENCH_CLOCK_UNIT names the unit for the JSON keys.                        */
+
+#ifdef CONFIG_NATIVE_LIBRARY
+
+/** @brief Host monotonic time in ns (src/simulation/host_clock.c). */
+uint64_t bench_host_ns(void);
+
+#define BENCH_CLOCK_UNIT    "ns"
+
+static inline uint32_t bench_clock_get(void)
+{
+    return (uint32_t)bench_host_ns();
+}
+
+#else
+
+#define BENCH_CLOCK_UNIT    "cyc"
+
+static inline uint32_t bench_clock_get(void)
+{
+    return k_cycle_get_32();
+}
+
+#endif
+
+#endif /* BENCH_CLOCK_H_ */
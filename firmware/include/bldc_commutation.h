@@ -0,0 +1,73 @@
+#ifndef BLDC_COMMUTATION_H
+#define BLDC_COMMUTATION_H
+
+#include <stdint.h>
+
+/* ========================================================================= *
+ * SIX-STEP COMMUTATION TABLES                                               *
+ * ========================================================================= *
+ * Shared by bldc_driver.c (real TIM1) and bldc_driver_sim.c (register     *
+ * mock) so both builds apply exactly the same switching sequence.         *
+ *                                                                           *
+ * Confirmed by observation: direct mapping (case==state) = CCW.            *
+ * CCW sequence: 6→4→5→1→3→2→(repeat)                                       *
+ *                                                                           *
+ * Pin → TIM1 channel:                                                      *
+ *   PA8 /CH1  = U+   PB13/CH1N = U-                                        *
+ *   PA9 /CH2  = V+   PB14/CH2N = V-                                        *
+ *   PA10/CH3  = W+   PB15/CH3N = W-                                        *
+ *                                                                           *
+ * CW = swap + and - on every pair (reverse current direction):             *
+ *   0x1→case6  0x2→case5  0x3→case4                                        *
+ *   0x4→case3  0x5→case2  0x6→case1                                        *
+ *                                                                           *
+ * Each entry is fully precomputed per hall state: the CCER enable bits,   *
+ * which CCR gets the PWM pulse (high side) and which CCR gets 0 (low side *
+ * complementary ON for the full period). Hall 0 and 7 have ccer == 0.     */
+
+/* Phase index == TIM1 channel - 1 == offset from CCR1 in 32-bit words */
+#define BLDC_PHASE_U        0
+#define BLDC_PHASE_V        1
+#define BLDC_PHASE_W        2
+
+/* TIM1->CCER layout (RM0434): 4 bits per channel, CCxE = bit 0, CCxNE = bit 2 */
+#define BLDC_CCER_HI(ph)    (1U << (4 * (ph)))      // CCxE  — high side
+#define BLDC_CCER_LO(ph)    (4U << (4 * (ph)))      // CCxNE — low side
+#define BLDC_CCER_ALL       (BLDC_CCER_HI(0) | BLDC_CCER_LO(0) | \
+                             BLDC_CCER_HI(1) | BLDC_CCER_LO(1) | \
+                             BLDC_CCER_HI(2) | BLDC_CCER_LO(2))
+
+struct bldc_comm_step {
+    uint16_t ccer;      // CCER enable bits for this step (0 = invalid hall)
+    uint8_t  high;      // phase whose CCR gets the pulse
+    uint8_t  low;       // phase whose CCR is forced to 0
+};
+
+#define BLDC_STEP(hi, lo) \
+    { BLDC_CCER_HI(BLDC_PHASE_##hi) | BLDC_CCER_LO(BLDC_PHASE_##lo), \
+      BLDC_PHASE_##hi, BLDC_PHASE_##lo }
+
+#define BLDC_DIR_CW         0
+#define BLDC_DIR_CCW        1
+
+/* bldc_comm_table[direction][hall_state] */
+static const struct bldc_comm_step bldc_comm_table[2][8] = {
+    [BLDC_DIR_CW] = {
+        [1] = BLDC_STEP(V, W),      // case 6
+        [2] = BLDC_STEP(U, V),      // case 5
+        [3] = BLDC_STEP(U, W),      // case 4
+        [4] = BLDC_STEP(W, U),      // case 3
+        [5] = BLDC_STEP(V, U),      // case 2
+        [6] = BLDC_STEP(W, V),      // case 1
+    },
+    [BLDC_DIR_CCW] = {
+        [1] = BLDC_STEP(W, V),      // case 1
+        [2] = BLDC_STEP(V, U),      // case 2
+        [3] = BLDC_STEP(W, U),      // case 3
+        [4] = BLDC_STEP(U, W),      // case 4
+        [5] = BLDC_STEP(U, V),      // case 5
+        [6] = BLDC_STEP(V, W),      // case 6
+    },
+};
+
+#endif /* BLDC_COMMUTATION_H */
@@ -7,6 +7,14 @@
 
 extern atomic_t g_motor_speed_atomic;
 
+/* Motor geometry: 8 poles = 4 pole pairs → 6 hall edges per pole pair */
+#define BLDC_POLE_PAIRS         4
+#define BLDC_EDGES_PER_REV      (BLDC_POLE_PAIRS * 6)           // = 24
+#define BLDC_CDEG_PER_EDGE      (36000 / BLDC_EDGES_PER_REV)    // 1500 = 15.00°
+
+/* TIM1 period: 64MHz / 3200 = 20kHz PWM. Pulses are 0 – BLDC_TIM1_ARR. */
+#define BLDC_TIM1_ARR           3200
+
 /* ========================================================================= *
  * BLDC DRIVER — Public API                                                  *
  * ========================================================================= */
@@ -47,10 +55,130 @@ uint32_t bldc_get_last_cycle_count(void);
  */
 void bldc_set_direction(int ccw);
 
+/** @brief Direction the commutation table is currently using (0 = CW). */
+int bldc_get_direction(void);
+
 void bldc_set_bootstrap(void);
 
+/** @brief Start commutating on the softstart ramp: the first edges run at
+ *  the softstart duty, rising by its step, until it reaches the end and
+ *  bldc_set_pwm() takes over. Thread context.
+ */
 void bldc_set_running(void);
 
+/** @brief Start commutating with bldc_set_pwm() in charge from the first
+ *  call, at 0 % until then. For moves of a few sectors, which softstart's
+ *  ramp alone would carry past their target. Thread context.
+ */
+void bldc_set_running_direct(void);
+
 void bldc_set_commutation_with_duty(uint8_t hall_state, int pulse);
 
+#ifdef CONFIG_MOTOR_ESTOP_BREAK
+/** @brief Emergency stop: TIM1 software break, all six outputs to their off
+ *  level before returning. Any context, no logging. Commutation and duty
+ *  writes keep landing in the registers but drive nothing until
+ *  bldc_estop_release().
+ */
+void bldc_estop(void);
+
+/** @brief Re-enable the outputs after bldc_estop(). No-op if they are on. */
+void bldc_estop_release(void);
+#endif
+
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+/** @brief Active brake: all three low sides on for @p pulse of every PWM
+ *  period (0 – TIM1_ARR), high sides off, shorting the windings across
+ *  the back-EMF. Hall edges keep measuring but stop commutating until the
+ *  next bldc_set_pwm(). Ignored until softstart is done. Thread context
+ *  or the fast speed loop.
+ */
+void bldc_set_brake(int pulse);
+
+/** @brief Register half of bldc_set_brake(): the low-side pattern only. */
+void bldc_set_brake_with_duty(int pulse);
+#endif
+
+/** @brief Hall debounce and softstart ramp, from the runtime parameters.
+ *  Takes effect from the next hall edge; a ramp in progress continues
+ *  with the new step and end. Thread context.
+ *  @param debounce_us     Edges closer than this to the last one are dropped.
+ *  @param softstart_duty  First pulse after bldc_set_running().
+ *  @param softstart_step  Added to the pulse on every edge.
+ *  @param softstart_end   bldc_set_pwm() takes over once the pulse reaches it.
+ */
+void bldc_hall_set_tuning(uint32_t debounce_us, int softstart_duty,
+                          int softstart_step, int softstart_end);
+
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+/** @brief Commutation advance, taken from the next hall edge on. Each edge
+ *  then schedules the following step this far ahead of the next edge it
+ *  predicts. Thread context.
+ *  @param cdeg_e  Electrical centidegrees, clamped to 0 – 3000 (half a
+ *                 sector); 0 commutates on the edge only.
+ */
+void bldc_hall_set_advance(int32_t cdeg_e);
+#endif
+
+#ifdef CONFIG_MOTOR_HALL_COMP
+/** @brief Per-sector interval weights, from the next hall edge on. Each
+ *  interval is scaled by the weight of the sector it was spent in, and
+ *  with any weight other than 1 the ISR speed averages the last
+ *  CONFIG_MOTOR_HALL_COMP_WINDOW intervals instead of the whole window.
+ *  Thread context.
+ *  @param weight  Mean sector interval / this sector's, indexed by sector
+ *                 along the CCW hall sequence 6→4→5→1→3→2.
+ */
+void bldc_hall_set_comp(const float weight[6]);
+
+/** @brief Clear the per-sector calibration sums and start collecting raw
+ *  intervals: driven edges in the commanded direction, after softstart.
+ *  Thread context. */
+void bldc_hall_cal_start(void);
+
+/** @brief Copy the calibration sums, per sector as for bldc_hall_set_comp().
+ *  Thread context. */
+void bldc_hall_cal_read(uint32_t sum_us[6], uint16_t n[6]);
+
+/** @brief Stop collecting; the sums keep their values. Any context. */
+void bldc_hall_cal_stop(void);
+#endif
+
+/** @brief True once softstart has handed the duty over to bldc_set_pwm(). */
+bool bldc_softstart_done(void);
+
+/** @brief Pulse every hall edge currently applies (softstart ramp or last bldc_set_pwm()). */
+int bldc_get_pulse(void);
+
+/** @brief Milliseconds since the last valid hall edge. */
+uint32_t bldc_get_rpm_age_ms(void);
+
+/** @brief True once no hall edge has been seen for the stopped timeout. */
+bool bldc_is_rpm_timed_out(void);
+
+/** @brief Signed multi-turn hall edge count since boot (+ = CW, 24 per rev).
+ *  Follows the hall state sequence, so an edge the ISR missed or debounced
+ *  is counted at the next one.
+ *  @note  Consistent snapshot of the ISR's counter; safe from any thread.
+ */
+int32_t bldc_get_edge_count(void);
+
+/** @brief The last counted hall edge, as one consistent record. */
+struct bldc_edge_snapshot {
+    int32_t  edges;         // bldc_get_edge_count() after the edge
+    uint32_t time_us;       // bldc_hall_now_us() time base
+    uint32_t dt_us;         // interval to the edge before, capped at the stopped timeout
+    int8_t   dir;           // +1 CW, -1 CCW, 0 before the first edge
+};
+
+/** @brief Copy the last counted hall edge. Any thread. */
+void bldc_get_edge_snapshot(struct bldc_edge_snapshot *out);
+
+/** @brief Shaft angle in centidegrees [0, 36000), interpolated between hall
+ *  edges from the last measured edge interval (sub-15° resolution). Once
+ *  the next edge is overdue it falls back to the middle of the sector, all
+ *  the halls can say about a stopped shaft.
+ */
+int32_t bldc_get_position_cdeg(void);
+
 #endif /* BLDC_DRIVER_H */
\ No newline at end of file
@@ -0,0 +1,118 @@
+#ifndef BLDC_HALL_H
+#define BLDC_HALL_H
+
+#include <stdint.h>
+
+/* ========================================================================= *
+ * HALL EDGE CORE — shared by bldc_driver.c and bldc_driver_sim.c           *
+ * ========================================================================= *
+ * Debounce, RPM running sum, position tracking, softstart ramp and the    *
+ * per-edge commutation call live in bldc_hall.c and are compiled into     *
+ * both builds, so the simulated plant exercises exactly the code the      *
+ * hardware runs. The driver only supplies the time base, the hall read    *
+ * and the register writes:                                                 *
+ *                                                                           *
+ *   bldc_hall_now_us()               this file (implemented by driver)     *
+ *   bldc_read_hall_state()           bldc_driver.h                          *
+ *   bldc_set_commutation_with_duty() bldc_driver.h                          *
+ *   bldc_comm_timer_start/_cancel()  this file (CONFIG_MOTOR_PHASE_ADVANCE) *
+ *                                                                           *
+ * and calls bldc_hall_edge() from its hall ISR (or synthetic edge), or    *
+ * bldc_hall_edge_at() when the ISR has read the time and state itself.   */
+
+/* ── RPM estimator ─────────────────────────────────────────────────────────
+ * Running sum of the last BLDC_RPM_WINDOW inter-edge intervals, updated
+ * in O(1) per edge. The hall ISR owns one; the hall self-test replays
+ * recorded edges through the same functions.                             */
+#define BLDC_RPM_CONSTANT       2500000UL   // single-edge: 60e6 / 24 edges per rev
+#define BLDC_RPM_WINDOW         CONFIG_BLDC_RPM_WINDOW
+#define BLDC_RPM_TIMEOUT_US     2000000UL   // 2 seconds → rpm = 0 (stopped)
+
+struct bldc_rpm_window {
+    uint32_t hist[BLDC_RPM_WINDOW];
+    uint32_t sum;           // running sum of hist[]
+    uint8_t  idx;           // slot the next sample replaces
+#ifdef CONFIG_MOTOR_HALL_SELFTEST
+    uint32_t reads;         // hist[] slots read, for the self-test's op count
+#endif
+};
+
+static inline void bldc_rpm_window_reset(struct bldc_rpm_window *w)
+{
+    for (int i = 0; i < BLDC_RPM_WINDOW; i++) {
+        w->hist[i] = 0;
+    }
+    w->sum = 0;
+    w->idx = 0;
+#ifdef CONFIG_MOTOR_HALL_SELFTEST
+    w->reads = 0;
+#endif
+}
+
+/** @brief Replace the oldest interval with @p sample_us (already capped at
+ *  BLDC_RPM_TIMEOUT_US) and adjust the sum by the difference. */
+static inline void bldc_rpm_window_push(struct bldc_rpm_window *w, uint32_t sample_us)
+{
+    w->sum += sample_us - w->hist[w->idx];
+#ifdef CONFIG_MOTOR_HALL_SELFTEST
+    w->reads++;
+#endif
+    w->hist[w->idx] = sample_us;
+    if (++w->idx >= BLDC_RPM_WINDOW) {
+        w->idx = 0;
+    }
+}
+
+/** @brief Mechanical rpm from @p sum_us spent on the edges @p num counts
+ *  (BLDC_RPM_CONSTANT × edges); 0 before any interval. */
+static inline int32_t bldc_rpm_from_sum(uint32_t num, uint32_t sum_us)
+{
+    return (sum_us > 0) ? (int32_t)(num / sum_us) : 0;
+}
+
+/** @brief Free-running 1 MHz time base (TIM2 on hardware, plant clock in sim). */
+uint32_t bldc_hall_now_us(void);
+
+/** @brief Reset estimator and position state; seed the sector from the boot hall. */
+void bldc_hall_init(int boot_hall);
+
+/** @brief Process one hall edge at bldc_hall_now_us(). ISR context. */
+void bldc_hall_edge(void);
+
+/** @brief Process one hall edge with a time and hall state the ISR already
+ *  read, so the direct hall ISR does not go back through the GPIO driver.
+ *  ISR context. */
+void bldc_hall_edge_at(uint32_t now_us, uint8_t hall);
+
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+/** @brief Run bldc_hall_advance_fire() from interrupt context once the
+ *  time base reaches @p at_us, or right away if it already has. Replaces
+ *  any pending time. Implemented by the driver; hall ISR context.
+ */
+void bldc_comm_timer_start(uint32_t at_us);
+
+/** @brief Drop the pending bldc_comm_timer_start(), if any. Hall ISR
+ *  context, or a thread under irq_lock(). */
+void bldc_comm_timer_cancel(void);
+
+/** @brief The advanced commutation step is due. Called by the driver's
+ *  compare interrupt, at the hall ISR's priority. */
+void bldc_hall_advance_fire(void);
+#endif
+
+#ifdef CONFIG_MOTOR_HALL_SELFTEST
+/** @brief Replay recorded edge sequences through the RPM estimator and the
+ *  whole-window loop it replaced, check every estimate agrees and time
+ *  both; apply every hall state in both directions through
+ *  bldc_comm_table and the old per-case switch to a register mock and
+ *  check they agree. Prints one "HALLT {json}" line per check.
+ *  @return 0 if every check passed.
+ */
+int bldc_hall_selftest(void);
+#endif
+
+/** @brief Leave run mode: edges stop commutating and the softstart re-arms.
+ *  Called by the driver's bldc_set_bootstrap() before it parks the bridge. */
+void bldc_hall_stop(void);
+
+#endif /* BLDC_HALL_H */
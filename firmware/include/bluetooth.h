@@ -24,6 +24,24 @@
 #define BT_UUID_MOTOR_TELEMETRY_VAL \
     BT_UUID_128_ENCODE(0x17da15e5, 0x05b1, 0x42df, 0x8d9d, 0xd7645d6d9293)
 
+#define BT_UUID_MOTOR_TELEMETRY_V2_VAL \
+    BT_UUID_128_ENCODE(0x5e1f4c2a, 0x7d3b, 0x4a8e, 0x9c61, 0x2b0d8e4f7a19)
+
+#define BT_UUID_MOTOR_TRACE_VAL \
+    BT_UUID_128_ENCODE(0x8b3e0d71, 0x24c6, 0x4f5a, 0xb1e9, 0x6a7c3f2d9e05)
+
+#define BT_UUID_MOTOR_DIAG_VAL \
+    BT_UUID_128_ENCODE(0x3f9a62c4, 0x1d7e, 0x4b05, 0x8e3a, 0x5c0f7b2d91e6)
+
+#define BT_UUID_MOTOR_AUTOTUNE_VAL \
+    BT_UUID_128_ENCODE(0x6c2e9a47, 0x3b18, 0x4d9f, 0xa2c5, 0x81e07f4b3d26)
+
+#define BT_UUID_MOTOR_GAIN_SCHED_VAL \
+    BT_UUID_128_ENCODE(0x9d41b7e2, 0x5a06, 0x4c3f, 0xb8d1, 0x27e5c0a4f613)
+
+#define BT_UUID_MOTOR_PARAMS_VAL \
+    BT_UUID_128_ENCODE(0x4a7d1e93, 0xc62b, 0x4f08, 0x9d35, 0xe1b60c7a2f84)
+
 #define BT_UUID_MOTOR_HEARTBEAT_VAL \
     BT_UUID_128_ENCODE(0x2215d558, 0xc569, 0x4bd1, 0x8947, 0xb4fd5f9432a0)
 
@@ -36,8 +54,42 @@ typedef enum {
     MOTOR_MODE_INIT     = 0x01,
     MOTOR_MODE_SPEED    = 0x02,
     MOTOR_MODE_POSITION = 0x03,
+    MOTOR_MODE_AUTOTUNE = 0x04,   // value = operating point, rpm (CONFIG_MOTOR_AUTOTUNE)
+    MOTOR_MODE_HALL_CAL = 0x05,   // value = speed to calibrate at, rpm (CONFIG_MOTOR_HALL_COMP)
+    MOTOR_MODE_ESTOP    = 0x06,   // value ignored; bridge off from this callback
 } motor_cmd_t;
 
+/* ========================================================================= *
+ * TRACE COMMAND OPCODES                                                     *
+ * Sent as the first byte of a write to the TRACE characteristic.           *
+ * ========================================================================= */
+typedef enum {
+    TRACE_CMD_REARM    = 0x00,   // discard the buffer and resume recording
+    TRACE_CMD_FREEZE   = 0x01,   // freeze now (manual trigger)
+    TRACE_CMD_TRIGGERS = 0x02,   // [1B mask] of TRACE_TRIG_* that freeze the buffer
+    TRACE_CMD_DUMP     = 0x03,   // notify the frozen buffer in chunks (freezes first)
+} trace_cmd_t;
+
+/* ========================================================================= *
+ * PARAMS COMMAND OPCODES AND STATUS                                         *
+ * Opcode is byte [1] of a write to the PARAMS characteristic; the status  *
+ * is byte [3] of the response read (or notified) back from it.            *
+ * ========================================================================= */
+typedef enum {
+    PARAMS_CMD_GET      = 0x01,   // [id]…, none = all: staged values
+    PARAMS_CMD_SET      = 0x02,   // [id][value 4B]…: validated and staged as one batch
+    PARAMS_CMD_SAVE     = 0x03,   // staged values to flash
+    PARAMS_CMD_DEFAULTS = 0x04,   // stage every default
+} params_cmd_t;
+
+typedef enum {
+    PARAMS_ST_OK        = 0x00,
+    PARAMS_ST_REJECTED  = 0x01,   // unknown id, out of range, inconsistent or scheduled
+    PARAMS_ST_STORAGE   = 0x02,   // flash write failed
+    PARAMS_ST_NOT_SUPP  = 0x03,   // SAVE without CONFIG_MOTOR_PARAMS_PERSIST
+    PARAMS_ST_BUSY      = 0x04,   // SAVE still running
+} params_status_t;
+
 /* ========================================================================= *
  * APPLICATION CONTEXT                                                       *
  * ========================================================================= */
@@ -45,6 +97,11 @@ typedef enum {
 /** Internal BLE state. Do not access directly outside bluetooth.c. */
 struct motor_app_ctx {
     volatile bool    notification_enabled;   // True once client subscribes to telemetry
+    volatile bool    stream_enabled;         // True once client subscribes to telemetry v2
+    volatile bool    trace_enabled;          // True once client subscribes to trace dumps
+    volatile bool    autotune_enabled;       // True once client subscribes to autotune results
+    volatile bool    params_enabled;         // True once client subscribes to params responses
+    struct bt_conn  *conn;                   // Current connection (ref held), NULL if none; set under conn_lock
     uint8_t          heartbeat_val;          // Last heartbeat counter value from phone
 };
 
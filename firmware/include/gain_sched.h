@@ -0,0 +1,76 @@
+#ifndef GAIN_SCHED_H
+#define GAIN_SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ========================================================================= *
+ * RPM_PID GAIN SCHEDULE (CONFIG_MOTOR_GAIN_SCHED)                           *
+ * ========================================================================= *
+ * A small table of operating points, sorted by speed, each with its own   *
+ * kp, ki and feedforward. The PID thread indexes it by |filtered_rpm|     *
+ * once per tick and interpolates linearly between the two neighbouring   *
+ * points; below the first and above the last point the end values hold.  *
+ * Interpolation keeps the gains continuous in speed, and pid_set_gains() *
+ * rescales the integral on every change, so the output does not jump     *
+ * when the speed moves across entries.                                   *
+ *                                                                           *
+ * The active table belongs to the PID thread. A new table from another   *
+ * thread is queued with gain_sched_load() and swapped in whole at the    *
+ * start of the next tick; readers get a consistent copy of the active    *
+ * one from gain_sched_get().                                              *
+ *                                                                           *
+ * With CONFIG_MOTOR_PARAMS_PERSIST, gain_sched_save() stores the active   *
+ * table next to the parameters, and it replaces the defaults from the    *
+ * next boot on.                                                            */
+
+#define GAIN_SCHED_MAX_POINTS   8
+
+struct gain_sched_point {
+    int32_t rpm;                // operating point, > 0
+    float   kp, ki;             // rpm_pid gains
+    float   ff_gain, ff_offset; // rpm_pid feedforward
+};
+
+struct gain_sched_table {
+    uint8_t                 n;  // 1..GAIN_SCHED_MAX_POINTS
+    struct gain_sched_point pt[GAIN_SCHED_MAX_POINTS];
+};
+
+/** @brief Make the saved table the active one, or @p defaults if none was
+ *  loaded at boot; drop any queued table. PID thread. */
+void gain_sched_reset(const struct gain_sched_table *defaults);
+
+/** @brief Validate @p t and queue it for the next tick. Any thread.
+ *  @return 0, or -EINVAL if n is out of range, the speeds are not strictly
+ *          increasing within 1..RPM_MAX, or a gain is negative (ki must be
+ *          positive).
+ */
+int gain_sched_load(const struct gain_sched_table *t);
+
+/** @brief Insert or replace one point (an autotune result). PID thread.
+ *  A point within GAIN_SCHED_MERGE_PCT of @p p's speed is replaced;
+ *  otherwise @p p is inserted in order, or replaces the nearest point if
+ *  the table is full.
+ */
+void gain_sched_set_point(const struct gain_sched_point *p);
+
+/** @brief One tick: take a queued table, then interpolate at @p rpm.
+ *  PID thread.
+ *  @param out  Filled with the gains to apply when returning true.
+ *  @return true if the table or the speed moved far enough since the last
+ *          true return that the gains should be re-applied.
+ */
+bool gain_sched_update(float rpm, struct gain_sched_point *out);
+
+/** @brief Consistent copy of the active table. Any thread. */
+void gain_sched_get(struct gain_sched_table *out);
+
+/** @brief Write the active table to flash. Thread context, blocks on the
+ *  flash write.
+ *  @return 0, -ENOTSUP without CONFIG_MOTOR_PARAMS_PERSIST, or the
+ *          settings error.
+ */
+int gain_sched_save(void);
+
+#endif /* GAIN_SCHED_H */
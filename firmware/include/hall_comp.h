@@ -0,0 +1,66 @@
+#ifndef HALL_COMP_H
+#define HALL_COMP_H
+
+#include <stdint.h>
+
+/* ========================================================================= *
+ * HALL PLACEMENT CALIBRATION (CONFIG_MOTOR_HALL_COMP)                       *
+ * ========================================================================= *
+ * Learns the per-sector interval weights bldc_hall_set_comp() applies in  *
+ * the hall ISR. Runs in the PID thread alongside speed mode:              *
+ *                                                                           *
+ *   SETTLE   wait until the filtered speed holds the requested rpm        *
+ *   COLLECT  the hall core sums raw intervals per sector until every      *
+ *            sector has HC_EDGES of them                                   *
+ *                                                                           *
+ * At constant speed each sector's mean interval is proportional to its    *
+ * true width, so weight = mean of the six / this sector's mean. The       *
+ * weights are staged as parameters 0x16–0x1B (live at the next tick) and *
+ * saved with the rest of the parameters when persistence is built in.   */
+
+#define HALL_COMP_MIN_RPM   300         // below it the speed ripple swamps the error
+
+enum hall_comp_status {
+    HALL_COMP_IDLE,
+    HALL_COMP_RUNNING,
+    HALL_COMP_DONE,
+    HALL_COMP_FAILED,
+};
+
+enum hall_comp_error {
+    HALL_COMP_OK,
+    HALL_COMP_ERR_SETTLE,       // never held the requested speed
+    HALL_COMP_ERR_COLLECT,      // too few edges before the time limit
+    HALL_COMP_ERR_RANGE,        // a weight outside the parameter range
+    HALL_COMP_ERR_ABORTED,      // left speed mode or the target changed
+};
+
+struct hall_comp_result {
+    uint16_t run;               // bumps on every start and every finish
+    uint8_t  status;            // enum hall_comp_status
+    uint8_t  error;             // enum hall_comp_error
+    int32_t  rpm;               // speed it ran at
+    uint16_t edges;             // intervals averaged per sector (the fewest)
+    float    weight[6];         // per sector, as bldc_hall_set_comp()
+};
+
+/** @brief Ask for a calibration at @p rpm; the caller sets the speed
+ *  target to the same value. Any thread; the PID thread starts it on its
+ *  next tick. */
+void hall_comp_request(int32_t rpm);
+
+/** @brief Drop any run and request, keep the last result. PID thread. */
+void hall_comp_reset(void);
+
+/** @brief One control tick. PID thread.
+ *  @param state         Motor state this tick (MOTOR_STATE_*).
+ *  @param target_rpm    Speed target the mode was given.
+ *  @param filtered_rpm  Filtered measured speed.
+ */
+void hall_comp_step(uint8_t state, int32_t target_rpm, float filtered_rpm,
+                    float dt);
+
+/** @brief Copy the last published result. Any thread. */
+void hall_comp_get_result(struct hall_comp_result *out);
+
+#endif /* HALL_COMP_H */
@@ -0,0 +1,38 @@
+#ifndef MOTION_PROFILE_H
+#define MOTION_PROFILE_H
+
+/* ========================================================================= *
+ * Motion Profile Generator                                                  *
+ * ========================================================================= *
+ * Shapes a step setpoint into a rate-limited one, one control tick at a    *
+ * time, so the PID never sees a step larger than the motor can follow.     *
+ *   jerk == 0 → trapezoidal: |d(vel)/dt| <= accel (away from 0) / decel    *
+ *   jerk  > 0 → S-curve: acceleration itself ramps at <= jerk, and is      *
+ *               wound back early enough to land on the target without     *
+ *               overshoot.                                                  *
+ * All state lives in the struct; no allocation, safe to step every tick.  */
+
+typedef struct {
+    float accel;    // max |rate| while speeding up   (units/s)
+    float decel;    // max |rate| while slowing down  (units/s)
+    float jerk;     // max |d(rate)/dt|, 0 = trapezoid (units/s^2)
+    float vel;      // current shaped setpoint
+    float acc;      // current rate of change of vel  (units/s)
+} motion_profile_struct;
+
+/** @brief Initialise limits and clear state. Must be called before motion_profile_step().
+ *  @param prof   Pointer to motion_profile_struct to initialise.
+ *  @param accel  Acceleration limit (> 0).
+ *  @param decel  Deceleration limit (> 0).
+ *  @param jerk   Jerk limit, 0 for a trapezoidal profile.
+ */
+void motion_profile_init(motion_profile_struct *prof, float accel, float decel,
+                         float jerk);
+
+/** @brief Restart the profile from a known setpoint (e.g. measured speed) at rest. */
+void motion_profile_reset(motion_profile_struct *prof, float vel);
+
+/** @brief Advance one tick toward target and return the shaped setpoint. */
+float motion_profile_step(motion_profile_struct *prof, float target, float dt);
+
+#endif /* MOTION_PROFILE_H */
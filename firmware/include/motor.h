@@ -16,6 +16,7 @@
 #define MOTOR_STATE_ESTOP			0x03	// 0011 (EMERGENCY STOP)
 #define MOTOR_STATE_RESTART			0x04	// 0100 (SOFT START/CALIBRATING)
 #define MOTOR_STATE_FAULT			0x05	// 0101 (HARDWARE FAILURE)
+#define MOTOR_STATE_AUTOTUNE		0x06	// 0110 - IDENTIFYING THE SPEED PLANT AROUND target_speed (CONFIG_MOTOR_AUTOTUNE)
 
 #define MOTOR_STATE_MASK			0x0F	// 0000 1111 (ISOLATE THE MOTOR STATE)
 
@@ -23,6 +24,7 @@
 #define MOTOR_FLAG_SYNC_BAD			0x10	// 0001 0000 
 #define MOTOR_FLAG_OVERHEAT			0x20	// 0010 0000
 #define MOTOR_FLAG_STALL			0x40	// 0100 0000
+#define MOTOR_FLAG_POS_SETTLED		0x80	// 1000 0000 - POSITION MOVE IS INSIDE THE HOLD BAND AND HAS SETTLED
 /** @todo ADD FLAG FOR MOTOR STALL -> ACTUAL RPM = 0, TARGET != 0; motor cannot move*/
 
 
@@ -51,6 +53,22 @@ struct motor_stats{
 	int32_t filtered_speed;
 };
 
+// VAULT ACCESS COUNTERS (CONFIG_MOTOR_VAULT_STATS) - CUMULATIVE SINCE BOOT
+struct motor_vault_stats{
+	uint32_t writes;			// WRITE SECTIONS ENTERED (SPINLOCK ROUND-TRIPS)
+	uint32_t write_cycles;		// CPU CYCLES SPENT INSIDE WRITE SECTIONS
+	uint32_t reads;				// LOCK-FREE SNAPSHOT READS
+	uint32_t read_retries;		// READS REPEATED BECAUSE A WRITER RACED THEM
+	uint32_t read_cycles;		// CPU CYCLES SPENT COPYING SNAPSHOTS
+};
+
+// EMERGENCY STOP LATENCY (CONFIG_MOTOR_ESTOP_BREAK) - COMMAND TO TIM1 OUTPUTS OFF, k_cycle_get_32() CYCLES
+struct motor_estop_stats{
+	uint32_t count;				// ESTOPS SINCE BOOT
+	uint32_t last_cycles;		// THE MOST RECENT ONE
+	uint32_t max_cycles;		// WORST SINCE BOOT
+};
+
 
 // PUBLIC API - MOTOR CONTROL
 
@@ -70,13 +88,29 @@ void motor_set_filtered_speed(int32_t rpm);
 /** @brief SET THE MOTOR'S POSITION (THIS IS THE ACTUAL VALUE OF THE MOTOR) */
 void motor_set_position(int32_t degrees);
 
+/** @brief PUBLISH ONE CONTROL TICK OF FEEDBACK (STATE, RAW RPM, FILTERED RPM, POSITION) AS A SINGLE
+ *  CONSISTENT UPDATE - ONE LOCK ROUND-TRIP INSTEAD OF ONE PER FIELD. FLAGS ARE LEFT UNTOUCHED.
+ *  @p state IS THE MODE THE LOOP IS RUNNING; A PENDING ESTOP TARGET IS PUBLISHED AS ESTOP */
+void motor_publish_feedback(uint8_t state, int32_t raw_rpm, int32_t filtered_rpm, int32_t degrees);
+
 void motor_set_sync_warning(bool active);
 void motor_set_overheat_warning(bool active);
 void motor_set_stall_warning(bool active);
+void motor_set_settled(bool active);
 
-/** @brief SET THE MOTOR INTO AN EMERGENCY STOP -> SET TARGET/ACTUAL STATE TO ESTOP AND TARGET SPEED TO 0 RPM*/
+/** @brief SET THE MOTOR INTO AN EMERGENCY STOP -> SET TARGET/ACTUAL STATE TO ESTOP AND TARGET SPEED TO 0 RPM.
+ *  WITH CONFIG_MOTOR_ESTOP_BREAK THE BRIDGE OUTPUTS ARE OFF BEFORE IT RETURNS. ANY CONTEXT, ISRs INCLUDED */
 void motor_trigger_estop(void);
 
+#ifdef CONFIG_MOTOR_ESTOP_BREAK
+/** @brief RE-ENABLE THE BRIDGE FOR A NEW MODE UNLESS THE VAULT HOLDS AN ESTOP - CHECKED UNDER THE WRITE
+ *  LOCK, SO AN ESTOP CAN NOT SLIP IN BETWEEN. RETURNS FALSE IF THE OUTPUTS STAY OFF. CONTROL THREAD */
+bool motor_release_outputs(void);
+
+/** @brief COPY THE ESTOP LATENCY COUNTERS */
+void motor_get_estop_stats(struct motor_estop_stats *out);
+#endif
+
 // TARGETED SETTERS
 /** @brief SET THE DESIRED MOTOR RPM (STILL NEED TO SET THE TARGET STATE) */
 void motor_set_target_speed(int32_t rpm);
@@ -84,17 +118,31 @@ void motor_set_target_speed(int32_t rpm);
 /** @brief SET THE DESIRED MOTOR POSITION (STILL NEED TO SET THE TARGET STATE) */
 void motor_set_target_position(int32_t degrees);
 
+/** @brief RUN THE rpm_pid AUTOTUNER AROUND rpm (> 0) - SETS TARGET SPEED AND STATE TOGETHER.
+ *  THE CONTROL LOOP STOPS THE MOTOR WHEN THE EXPERIMENT ENDS */
+void motor_start_autotune(int32_t rpm);
+
+/** @brief STOP AFTER THE AUTOTUNER, ONLY IF AUTOTUNE IS STILL THE TARGET - AN ESTOP OR A NEWER
+ *  COMMAND IS LEFT AS IT IS. CHECK AND WRITE ARE ONE VAULT WRITE SECTION
+ *  @return true IF THE TARGET WAS CHANGED TO STOPPED */
+bool motor_finish_autotune(void);
+
 
 
 
 // PUBLIC API - GETTERS
 
+/** @brief COPY THE WHOLE STATS RECORD IN ONE CONSISTENT SNAPSHOT. LOCK-FREE: NEVER BLOCKS THE
+ *  CONTROL THREAD. THREAD CONTEXT ONLY - AN ISR COULD SPIN ON A WRITER IT PREEMPTED. */
+void motor_get_snapshot(struct motor_stats *out);
+
 // ACTUAL MOTOR STAT GETTERS
 // STATUS
 uint8_t motor_get_full_status(void);
 bool motor_is_sync_bad(void);
 bool motor_is_overheated(void);
 bool motor_is_stall(void);
+bool motor_is_settled(void);
 
 // TELEMETRY
 int32_t motor_get_speed(void);
@@ -106,4 +154,16 @@ uint8_t motor_get_target_state(void);
 int32_t motor_get_target_speed(void);
 int32_t motor_get_target_position(void);
 
+#ifdef CONFIG_MOTOR_VAULT_STATS
+/** @brief COPY THE VAULT ACCESS COUNTERS (BENCHMARK BUILDS ONLY) */
+void motor_get_vault_stats(struct motor_vault_stats *out);
+#endif
+
+#ifdef CONFIG_MOTOR_VAULT_BENCH
+/** @brief TIME ONE CONTROL TICK OF VAULT TRAFFIC AGAINST THE OLD PER-FIELD MUTEX VAULT AND PRINT A
+ *  "VAULT {json}" LINE. WIPES THE VAULT (motor_init()) - BOOT OR SIM RUNNER ONLY, MOTOR STOPPED.
+ *  RETURNS 0 IF BOTH VAULTS READ BACK WHAT WAS WRITTEN */
+int motor_vault_bench(void);
+#endif
+
 #endif
\ No newline at end of file
@@ -1,10 +1,36 @@
 #ifndef MOTOR_CONTROL_H
 #define MOTOR_CONTROL_H
 
+#include <stdint.h>
+
+/** Control executive timing, cumulative since motor_control_reset(). */
+struct motor_control_timing {
+    uint32_t ticks;          // speed-loop ticks run
+    uint32_t overruns;       // timer periods missed because a tick ran long
+    uint32_t jitter_max_us;  // worst |measured period - nominal period|
+    uint32_t dt_last_us;     // measured period of the last tick
+};
+
 /**
  * @brief Initializes PWM, ADC, PID, and starts the motor threads
  * @return 0 on success, negative error code otherwise
  */
 int motor_control_init(void);
 
+/**
+ * @brief Run one executive tick: supervisor and telemetry when due, speed
+ * loop (snapshot, profile, PID, PWM) always.
+ * Called by the PID thread on every control timer expiry; under
+ * CONFIG_MOTOR_SIM_VIRTUAL_TIME there is no thread and the sim runner
+ * calls it once per simulated period instead.
+ * @param dt Seconds since the previous tick (measured, not nominal).
+ */
+void motor_control_step(float dt);
+
+/** @brief Return every loop state (PID, profile, position hold) to power-on. */
+void motor_control_reset(void);
+
+/** @brief Copy the executive's tick, overrun and jitter counters. */
+void motor_control_get_timing(struct motor_control_timing *out);
+
 #endif
\ No newline at end of file
@@ -1,7 +1,69 @@
 #ifndef MOTOR_SIM_H_
 #define MOTOR_SIM_H_
 
-/** @brief Initialize and start the motor simulation thread */
+#include <stdint.h>
+
+/** @brief Initialize and start the motor simulation thread
+ *  (no thread under CONFIG_MOTOR_SIM_VIRTUAL_TIME — see motor_sim_step()).
+ */
 void motor_sim_init(void);
 
-#endif /* MOTOR_SIM_H_ */
\ No newline at end of file
+/** @brief Advance the simulated plant by one period (one control period of sim time). */
+void motor_sim_step(void);
+
+/** @brief Return plant, clock and register mock to their power-on state. */
+void motor_sim_reset(void);
+
+/** @brief Set the load torque opposing rotation, in mN·m. */
+void motor_sim_set_load(int32_t load_mnm);
+
+/** @brief Swallow the next @p n hall interrupts: the sensor state still
+ *  changes, the edge core just never hears about it, as with a missed or
+ *  debounced EXTI. Cleared by motor_sim_reset(). */
+void motor_sim_drop_hall_edges(uint32_t n);
+
+/** @brief Hall sensor state changes since reset, signed like
+ *  bldc_get_edge_count() (+ = CW), for judging the position count. */
+int32_t motor_sim_get_edge_count(void);
+
+/** @brief True shaft angle in centidegrees [0, 36000), in the frame of
+ *  bldc_get_position_cdeg(): 0 is the start of the sector the rotor was
+ *  parked in at reset. */
+int32_t motor_sim_get_angle_cdeg(void);
+
+/** @brief Hall sensor placement error, electrical centidegrees per sensor
+ *  (+ = switches late in CW rotation). Cleared by motor_sim_reset(). */
+void motor_sim_set_hall_error(int32_t u_cdeg, int32_t v_cdeg, int32_t w_cdeg);
+
+/** @brief True width of the sector reporting hall state @p hall, in
+ *  sectors (1 = 60°e), for judging the hall compensation. */
+float motor_sim_get_sector_width(uint8_t hall);
+
+/** @brief Plant clock in microseconds; advances only in motor_sim_step(). */
+uint32_t motor_sim_time_us(void);
+
+/** @brief True shaft speed in rpm (+ = CW), for judging the estimators. */
+int32_t motor_sim_get_rpm(void);
+
+/** @brief Mean current through the energised pair over the last step, mA. */
+int32_t motor_sim_get_current_ma(void);
+
+/** @brief High-side pulse on the energised pair (0 – TIM1_ARR, 0 if coasting). */
+int motor_sim_get_pulse(void);
+
+/** @brief Plant time of the first substep in which the high sides stopped
+ *  driving after they last did, µs (0 = not since reset). */
+uint32_t motor_sim_drive_off_us(void);
+
+/** @brief Non-adjacent commutation steps seen since reset. */
+uint32_t motor_sim_get_comm_faults(void);
+
+#ifdef CONFIG_MOTOR_SIM_VIRTUAL_TIME
+/** @brief Run every built-in scenario CONFIG_MOTOR_SIM_RUNS times in
+ *  virtual time and print one result line per run.
+ *  @return 0 if every repeat reproduced the first run bit-for-bit.
+ */
+int sim_runner_run(void);
+#endif
+
+#endif /* MOTOR_SIM_H_ */
@@ -0,0 +1,111 @@
+#ifndef PARAMS_H_
+#define PARAMS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ========================================================================= *
+ * RUNTIME PARAMETER REGISTRY                                                *
+ * ========================================================================= *
+ * The control constants that used to be #defines, as typed values with a  *
+ * range and a default. Three copies of the table:                         *
+ *                                                                           *
+ *   staged   written by params_set() (BLE) and the settings load, under  *
+ *            a spinlock; every value in it has passed validation          *
+ *   active   the PID thread's. params_apply() copies staged over it at   *
+ *            the start of a control tick, so a batch of values goes live *
+ *            together, never half-way through a tick                      *
+ *   flash    with CONFIG_MOTOR_PARAMS_PERSIST, params_save() writes       *
+ *            staged to the settings subsystem ("motor/<key>", NVS on     *
+ *            target) and params_init() loads it back at boot             *
+ *                                                                           *
+ * IDs are part of the BLE protocol: append new ones, never renumber.      */
+
+enum param_id {
+    PARAM_RPM_FILTER_TAU_US   = 0x00,   // u32, speed filter time constant
+    PARAM_HALL_TIMEOUT_MS     = 0x01,   // u32, hall silence that means stopped
+    PARAM_STALL_TIMEOUT_MS    = 0x02,   // u32, running target with no motion
+    PARAM_HALL_DEBOUNCE_US    = 0x03,   // u32, edges closer than this are dropped
+    PARAM_SOFTSTART_DUTY_PCT  = 0x04,   // f32, first softstart duty
+    PARAM_SOFTSTART_STEP_PCT  = 0x05,   // f32, added per hall edge
+    PARAM_SOFTSTART_END_PCT   = 0x06,   // f32, rpm_pid takes over above this
+    PARAM_PID_KP              = 0x07,   // f32, % per rpm
+    PARAM_PID_KI              = 0x08,   // f32, % per rpm·s
+    PARAM_PID_KD              = 0x09,   // f32, % per rpm/s
+    PARAM_PID_D_TAU_US        = 0x0A,   // u32, derivative low-pass
+    PARAM_PID_FF_GAIN         = 0x0B,   // f32, % per rpm
+    PARAM_PID_FF_OFFSET       = 0x0C,   // f32, %
+    PARAM_PID_INTEGRAL_LIMIT  = 0x0D,   // f32, rpm·s
+    PARAM_ADV_RPM_0           = 0x0E,   // u32, phase advance table speeds,
+    PARAM_ADV_RPM_1           = 0x0F,   //      strictly increasing
+    PARAM_ADV_RPM_2           = 0x10,
+    PARAM_ADV_RPM_3           = 0x11,
+    PARAM_ADV_DEG_0           = 0x12,   // f32, electrical degrees at each speed
+    PARAM_ADV_DEG_1           = 0x13,
+    PARAM_ADV_DEG_2           = 0x14,
+    PARAM_ADV_DEG_3           = 0x15,
+    PARAM_HALL_COMP_0         = 0x16,   // f32, learned hall interval weight per
+    PARAM_HALL_COMP_1         = 0x17,   //      sector (CCW sequence 6→4→5→1→3→2),
+    PARAM_HALL_COMP_2         = 0x18,   //      1 = uncompensated
+    PARAM_HALL_COMP_3         = 0x19,
+    PARAM_HALL_COMP_4         = 0x1A,
+    PARAM_HALL_COMP_5         = 0x1B,
+    PARAM_COUNT
+};
+
+enum param_type {
+    PARAM_TYPE_U32 = 0,
+    PARAM_TYPE_F32 = 1,
+};
+
+union param_value {
+    uint32_t u;
+    float    f;
+};
+
+struct param_entry {
+    uint8_t           id;       // enum param_id
+    union param_value v;
+};
+
+/** @brief Load defaults, then any saved values, and make them active.
+ *  Call once at boot, before motor_control_init(). */
+void params_init(void);
+
+/** @brief enum param_type of @p id, or -1 if there is no such parameter. */
+int param_type(uint8_t id);
+
+/** @brief Active value. PID thread, or before the control thread starts. */
+uint32_t param_u32(enum param_id id);
+float    param_f32(enum param_id id);
+
+/** @brief Fill in the staged value of each e[i].id. Any thread.
+ *  @return 0, or -(i + 1) for the first unknown id.
+ */
+int params_get(struct param_entry *e, uint8_t n);
+
+/** @brief Validate all @p n values, then stage them together; none are
+ *  staged if any one fails. They go live at the next params_apply().
+ *  Any thread.
+ *  @return 0, or -(i + 1) for the first entry that is unknown, out of
+ *          range, inconsistent with the rest, or owned by the gain
+ *          schedule (kp, ki, feedforward with CONFIG_MOTOR_GAIN_SCHED).
+ */
+int params_set(const struct param_entry *e, uint8_t n);
+
+/** @brief Stage every default, as one batch. Any thread. */
+void params_defaults(void);
+
+/** @brief Write the staged values to flash. Blocks; thread context.
+ *  @return 0, -ENOTSUP without CONFIG_MOTOR_PARAMS_PERSIST, or the
+ *          settings error.
+ */
+int params_save(void);
+
+/** @brief Make staged values active if any changed. PID thread, once at
+ *  the start of each tick.
+ *  @return true if the active values changed.
+ */
+bool params_apply(void);
+
+#endif /* PARAMS_H_ */
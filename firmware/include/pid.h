@@ -1,16 +1,53 @@
 #ifndef PID_H
 #define PID_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 /* ========================================================================= *
  * PID Controller                                                            *
  * ========================================================================= */
 
+/* pid_init() gives the plain clamped PI. The optional terms below are set
+ * afterwards and default to off, leaving the output bit-for-bit the same:
+ *
+ *   derivative    -kd · d(measured)/dt through a first-order low-pass of
+ *                 time constant d_tau. On the measurement, not the error,
+ *                 so a setpoint step does not kick the output.
+ *   feedforward   ff_gain · target + ff_offset (offset signed as target,
+ *                 none at target 0). An open-loop estimate of the output
+ *                 the plant needs, leaving the PI only the residual.
+ *   anti-windup   On top of the integral_limit clamp, while the output
+ *                 sits on out_min / out_max:
+ *                   CONDITIONAL  the integral does not move further in
+ *                                the direction that pushed it there.
+ *                   BACK_CALC    the integral is bled by
+ *                                kaw · (saturated − raw) / ki per second
+ *                                toward the value that just holds the
+ *                                rail.                                    */
+enum pid_antiwindup {
+    PID_AW_CLAMP,           // integral_limit only
+    PID_AW_CONDITIONAL,
+    PID_AW_BACK_CALC,
+};
+
 typedef struct {
     float kp, ki;
     float integral;
     float integral_limit;
     float out_min, out_max;
 
+    float kd;               // output per (unit/s) of measurement
+    float d_tau;            // derivative low-pass time constant, s
+    float d_filt;           // filtered d(measured)/dt, unit/s
+    float prev_measured;
+    bool  d_primed;         // prev_measured valid
+
+    float ff_gain;          // output per unit of target
+    float ff_offset;        // output at target 0⁺
+
+    uint8_t aw_mode;        // enum pid_antiwindup
+    float   kaw;            // back-calculation tracking gain, 1/s
 } pid_struct;
 
 /** @brief Initialise all PID state. Must be called before pid_compute().
@@ -21,8 +58,121 @@ typedef struct {
 void pid_init(pid_struct *pid, float kp, float ki, float integral_limit,
      float out_min, float out_max);
 
+/** @brief Change kp and ki on a running controller. The integral is
+ *  rescaled so ki · integral, and with it the output, does not jump. */
+void pid_set_gains(pid_struct *pid, float kp, float ki);
+
+/** @brief Change the integral clamp on a running controller; an integral
+ *  already beyond the new limit is clamped to it. */
+void pid_set_integral_limit(pid_struct *pid, float integral_limit);
+
+/** @brief Enable the filtered derivative on the measurement.
+ *  @param kd       Derivative gain, output per (unit/s). 0 disables.
+ *  @param tau_s    Low-pass time constant, s.
+ */
+void pid_set_derivative(pid_struct *pid, float kd, float tau_s);
+
+/** @brief Enable feedforward: ff_gain · target + ff_offset (target != 0). */
+void pid_set_feedforward(pid_struct *pid, float ff_gain, float ff_offset);
+
+/** @brief Select the anti-windup scheme.
+ *  @param kaw      PID_AW_BACK_CALC tracking gain, 1/s; ~1/sqrt(Ti·Td), or
+ *                  1/Ti = ki/kp for a PI. Ignored by the other modes.
+ */
+void pid_set_antiwindup(pid_struct *pid, enum pid_antiwindup mode, float kaw);
+
 float pid_compute(pid_struct *pid, float target, float measured, float dt);
 
 void pid_reset(pid_struct *pid);
 
+/* ========================================================================= *
+ * Fixed-point PID (pid_q_*)                                                 *
+ * ========================================================================= *
+ * Same controller and the same anti-windup as pid_compute(): the integral  *
+ * of error·dt is clamped to ±integral_limit, then kp·e + ki·integral is    *
+ * clamped to [out_min, out_max], with the same optional derivative,       *
+ * feedforward and anti-windup terms. Integer only — no float, no logging, *
+ * no locks — so it can run in an ISR and needs no CONFIG_FPU_SHARING.     *
+ *                                                                           *
+ *   gains, output   Q15: int32 with 15 fractional bits (PID_Q15(x))         *
+ *   kd, ff_gain     Q31 (PID_Q31(x), |x| < 1): per-rpm gains are ~1e-2 and *
+ *                   smaller, where Q15 would keep two or three bits        *
+ *   error           integer units of the measurement (rpm)                 *
+ *   dt, d_tau       µs                                                      *
+ *   integral        int64 error·µs, exact                                   *
+ * Constants go through PID_Q15() / PID_Q31() so the conversion folds at   *
+ * build time.                                                              */
+
+#define PID_Q15_SHIFT   15
+#define PID_Q_KI_SHIFT  24          // extra fraction bits on the per-µs ki
+#define PID_Q15(x)      ((int32_t)((x) * 32768.0 + (((x) >= 0) ? 0.5 : -0.5)))
+#define PID_Q31(x)      ((int32_t)((x) * 2147483648.0 + (((x) >= 0) ? 0.5 : -0.5)))
+
+typedef struct {
+    int32_t kp;                 // Q15
+    int32_t ki_us;              // ki per µs, Q(15 + PID_Q_KI_SHIFT)
+    int64_t integral;           // error·µs
+    int64_t integral_limit;     // error·µs
+    int32_t out_min, out_max;   // Q15
+
+    int32_t kd;                 // Q31, output per (unit/s)
+    uint32_t d_tau_us;
+    int32_t d_filt;             // filtered d(measured)/dt, unit/s
+    int32_t prev_measured;
+    bool    d_primed;
+
+    int32_t ff_gain;            // Q31, output per unit of target
+    int32_t ff_offset;          // Q15
+
+    uint8_t aw_mode;            // enum pid_antiwindup
+    int32_t aw_q16;             // kaw / ki, error per output unit, Q16
+} pid_q_struct;
+
+/** @brief Initialise all state. Must be called before pid_q_compute().
+ *  @param kp_q15         Proportional gain, Q15.
+ *  @param ki_q15         Integral gain per second, Q15.
+ *  @param integral_limit Integral clamp in error·s (whole units).
+ *  @param out_min_q15    Output floor, Q15.
+ *  @param out_max_q15    Output ceiling, Q15.
+ */
+void pid_q_init(pid_q_struct *pid, int32_t kp_q15, int32_t ki_q15,
+                int32_t integral_limit, int32_t out_min_q15, int32_t out_max_q15);
+
+/** @brief pid_set_gains() in fixed point. Thread context: one 64-bit divide. */
+void pid_q_set_gains(pid_q_struct *pid, int32_t kp_q15, int32_t ki_q15);
+
+/** @brief pid_set_integral_limit() in fixed point, error·s. */
+void pid_q_set_integral_limit(pid_q_struct *pid, int32_t integral_limit);
+
+/** @brief pid_set_derivative() in fixed point. @p kd_q31 0 disables. */
+void pid_q_set_derivative(pid_q_struct *pid, int32_t kd_q31, uint32_t tau_us);
+
+/** @brief pid_set_feedforward() in fixed point. */
+void pid_q_set_feedforward(pid_q_struct *pid, int32_t ff_gain_q31,
+                           int32_t ff_offset_q15);
+
+/** @brief pid_set_antiwindup() in fixed point. Call after pid_q_init();
+ *  the back-calculation factor is folded with ki here, not per step.
+ *  @param kaw_q15  PID_AW_BACK_CALC tracking gain, 1/s, Q15.
+ */
+void pid_q_set_antiwindup(pid_q_struct *pid, enum pid_antiwindup mode,
+                          int32_t kaw_q15);
+
+/** @brief One PID step. ISR safe.
+ *  @return Output in Q15, within [out_min, out_max].
+ */
+int32_t pid_q_compute(pid_q_struct *pid, int32_t target, int32_t measured,
+                      uint32_t dt_us);
+
+void pid_q_reset(pid_q_struct *pid);
+
+#ifdef CONFIG_MOTOR_PID_SELFTEST
+/** @brief Run pid_q_compute() and pid_compute() side by side on the same
+ *  input sequences, check they agree within tolerance and time both.
+ *  Prints one "PIDQ {json}" line per gain set.
+ *  @return 0 if every set agreed.
+ */
+int pid_q_selftest(void);
+#endif
+
 #endif /* PID_H */
\ No newline at end of file
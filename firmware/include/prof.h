@@ -0,0 +1,77 @@
+#ifndef PROF_H_
+#define PROF_H_
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+
+/* ========================================================================= *
+ * HOT-PATH CYCLE PROFILER                                                   *
+ * ========================================================================= *
+ * Each probe keeps count, min, max, sum and a log2 histogram of the CPU    *
+ * cycles spent in one hot path. Timing is two reads of DWT->CYCCNT on     *
+ * hardware (a monotonic k_cycle_get_32() under simulation) and the update *
+ * is a handful of stores under irq_lock(), so probes stay on in            *
+ * production. Results are read over BLE from the diagnostics              *
+ * characteristic instead of being logged from the control loop.           */
+
+enum prof_probe {
+    PROF_HALL_ISR     = 0,   // hall ISR, either path (edge core incl. commutation)
+    PROF_COMMUTATE    = 1,   // bldc_set_commutation_with_duty
+    PROF_CONTROL      = 2,   // one motor_control_step() (pid_control_thread tick)
+    PROF_NOTIFY_TEL   = 3,   // motor_notify_telemetry
+    PROF_SPEED_FAST   = 4,   // speed_fast_tick (CONFIG_MOTOR_FAST_SPEED_LOOP)
+    PROF_HALL_LATENCY = 5,   // hall edge → commutation (hardware, 1 µs steps)
+    PROF_PROBE_COUNT
+};
+
+/* Bucket b counts samples with 2^(b-1) <= cycles < 2^b (bucket 0 = 0 cycles);
+ * the last bucket also takes everything above.                           */
+#define PROF_HIST_BUCKETS   16
+
+struct prof_stats {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t hist[PROF_HIST_BUCKETS];
+};
+
+#ifdef CONFIG_MOTOR_PROF
+
+/** @brief Start the cycle counter. Call once at boot, before any probe. */
+void prof_init(void);
+
+/** @brief Current cycle count for PROF_* timing. ISR safe. */
+uint32_t prof_now(void);
+
+/** @brief Add one sample of @p cycles to @p probe. ISR and thread safe. */
+void prof_record(uint8_t probe, uint32_t cycles);
+
+/** @brief Consistent copy of one probe's statistics. */
+void prof_snapshot(uint8_t probe, struct prof_stats *out);
+
+/** @brief Clear every probe. */
+void prof_reset(void);
+
+/** @brief Cycle counter frequency in Hz, for converting to time. */
+uint32_t prof_cycles_per_sec(void);
+
+#else
+
+static inline void prof_init(void) {}
+static inline uint32_t prof_now(void) { return 0; }
+static inline void prof_record(uint8_t probe, uint32_t cycles) {}
+static inline void prof_snapshot(uint8_t probe, struct prof_stats *out)
+{
+    *out = (struct prof_stats){ 0 };
+}
+static inline void prof_reset(void) {}
+static inline uint32_t prof_cycles_per_sec(void) { return 0; }
+
+#endif /* CONFIG_MOTOR_PROF */
+
+/* Bracket a hot path:  PROF_BEGIN(t); ... PROF_END(PROF_HALL_ISR, t); */
+#define PROF_BEGIN(var)         uint32_t var = prof_now()
+#define PROF_END(probe, var)    prof_record((probe), prof_now() - (var))
+
+#endif /* PROF_H_ */
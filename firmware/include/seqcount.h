@@ -0,0 +1,56 @@
+#ifndef SEQCOUNT_H_
+#define SEQCOUNT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/sys/barrier.h>
+
+/* ========================================================================= *
+ * SEQUENCE COUNTER                                                          *
+ * ========================================================================= *
+ * Lock-free consistency guard for small records with ONE writer at a time. *
+ * The writer bumps the counter to odd before touching the record and back  *
+ * to even afterwards; a reader copies the record and retries if the count  *
+ * was odd or changed underneath it. Readers never block the writer.        *
+ *                                                                           *
+ * The caller must serialise writers (spinlock, irq_lock, or ISR-only) and  *
+ * the write section must not be preemptible by a reader of the same       *
+ * record, otherwise a higher-priority reader spins on an odd count.        */
+
+typedef struct {
+    volatile uint32_t seq;
+} seqcount_t;
+
+#define SEQCOUNT_INIT { .seq = 0 }
+
+static inline void seqcount_write_begin(seqcount_t *s)
+{
+    s->seq++;
+    barrier_dmem_fence_full();
+}
+
+static inline void seqcount_write_end(seqcount_t *s)
+{
+    barrier_dmem_fence_full();
+    s->seq++;
+}
+
+/** @brief Start a read. Spins only while a writer on another CPU is mid-update. */
+static inline uint32_t seqcount_read_begin(const seqcount_t *s)
+{
+    uint32_t seq;
+    while ((seq = s->seq) & 1U) {
+        /* writer in progress */
+    }
+    barrier_dmem_fence_full();
+    return seq;
+}
+
+/** @brief Return true if the copy taken since read_begin() must be discarded. */
+static inline bool seqcount_read_retry(const seqcount_t *s, uint32_t seq)
+{
+    barrier_dmem_fence_full();
+    return s->seq != seq;
+}
+
+#endif /* SEQCOUNT_H_ */
@@ -0,0 +1,59 @@
+#ifndef SPEED_FAST_H
+#define SPEED_FAST_H
+
+#include <stdint.h>
+#include "bldc_driver.h"
+
+/* ========================================================================= *
+ * FAST SPEED LOOP (CONFIG_MOTOR_FAST_SPEED_LOOP)                            *
+ * ========================================================================= *
+ * Fixed-point PI that closes the speed loop in interrupt context every     *
+ * CONFIG_MOTOR_FAST_SPEED_LOOP_DIV PWM periods (1 – 2 kHz) instead of in   *
+ * the PID thread. The thread keeps modes, profiles, the position loop,    *
+ * the supervisor and telemetry, and hands over one speed goal per tick.   *
+ * speed_fast_tick() uses no float, no logging and no lock other than the  *
+ * commutation write's irq_lock(). The driver calls it: TIM1 update IRQ on *
+ * hardware, the plant's substep loop in simulation.                       */
+
+#define SPEED_FAST_PWM_HZ       (64000000U / BLDC_TIM1_ARR)             // 20 kHz
+#define SPEED_FAST_DIV          CONFIG_MOTOR_FAST_SPEED_LOOP_DIV
+#define SPEED_FAST_PERIOD_US    (SPEED_FAST_DIV * 1000000U / SPEED_FAST_PWM_HZ)
+#define SPEED_FAST_RATE_HZ      (1000000U / SPEED_FAST_PERIOD_US)
+
+/** @brief Track @p goal_rpm (>= 0, in the commanded direction) from the next
+ *  fast tick on. 0 holds the bridge at 0 % with the integrator cleared. */
+void speed_fast_set_goal(int32_t goal_rpm);
+
+/** @brief Stop writing the bridge and clear the integrator. Thread context;
+ *  call before parking the bridge or handing PWM back to softstart. */
+void speed_fast_stop(void);
+
+/** @brief Clear the integrator at the next tick, keeping the goal. */
+void speed_fast_reset(void);
+
+/** @brief Pulse (0 – BLDC_TIM1_ARR) written by the last fast tick. */
+int speed_fast_get_pulse(void);
+
+/** @brief rpm_pid's gains, in its units, from the next fast tick on. The
+ *  integrator keeps its value, which is already in output units.
+ *  Thread context.
+ *  @param kp              % duty per rpm
+ *  @param ki              % duty per rpm·s
+ *  @param ff_gain         % duty per rpm of goal
+ *  @param ff_offset       % duty added to a goal above 0
+ *  @param integral_limit  rpm·s; the integrator stays within ±ki × this
+ */
+void speed_fast_set_gains(float kp, float ki, float ff_gain, float ff_offset,
+                          float integral_limit);
+
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+/** @brief Back-EMF estimate in pulse counts per rpm: outputs below it at
+ *  the measured speed, and a goal of 0, brake instead of driving. 0 only
+ *  drives. Thread context. */
+void speed_fast_set_emf(float pulse_per_rpm);
+#endif
+
+/** @brief One loop iteration. Driver only; ISR context. */
+void speed_fast_tick(void);
+
+#endif /* SPEED_FAST_H */
@@ -0,0 +1,51 @@
+#ifndef SPEED_OBS_H
+#define SPEED_OBS_H
+
+#include <stdint.h>
+
+/* ========================================================================= *
+ * HALL SPEED / POSITION OBSERVER (CONFIG_MOTOR_SPEED_OBSERVER)              *
+ * ========================================================================= *
+ * Type-2 tracking loop (a PLL on the hall edge count) in place of the     *
+ * 6-edge interval average. State is shaft angle θ̂ and speed ω̂ in hall     *
+ * edges, anchored at the last edge the PID thread has seen:               *
+ *                                                                           *
+ *   predict   θ̂ += ω̂·T           T = time since the previous edge used   *
+ *   correct   e = edges − θ̂;  θ̂ += k1·e;  ω̂ += k2·e / T                   *
+ *                                                                           *
+ * with k1 = 2ζ·ωn·T and k2 = (ωn·T)². ωn follows the edge rate (a fixed   *
+ * fraction of 1/T, capped at SPEED_OBS_WN_MAX), so the loop averages over *
+ * about the same number of edges at 60 rpm as at 3000: the 6-edge window *
+ * is 250 ms long at 60 rpm, the observer's lag about one edge interval.  *
+ *                                                                           *
+ * Between edges the angle is extrapolated at ω̂ but never past the next   *
+ * edge, and once an edge is overdue ω̂ is bounded by 1/(time since it):   *
+ * the speed decays as the silence proves it must have, instead of holding *
+ * the last value until a timeout. After the hall timeout it is 0 and the *
+ * next two edges seed it again.                                           *
+ *                                                                           *
+ * Runs in the PID thread (speed_obs_step() once per tick); any thread     *
+ * reads a consistent result through speed_obs_get().                      */
+
+struct speed_obs_result {
+    int32_t rpm;            // signed, + = CW, from the measured direction
+    int32_t pos_cdeg;       // [0, 36000), extrapolated shaft angle
+    uint8_t confidence;     // 0 – 100 %, see speed_obs.c
+};
+
+/** @brief Forget the track; the next edges re-seed it. PID thread. */
+void speed_obs_reset(void);
+
+/** @brief Hall silence after which the shaft counts as stopped. PID thread. */
+void speed_obs_set_timeout(uint32_t timeout_us);
+
+/** @brief Take in the latest hall edge and extrapolate to now. PID thread,
+ *  once per control tick.
+ *  @return Speed estimate in rpm, as published.
+ */
+int32_t speed_obs_step(void);
+
+/** @brief Copy the last published estimate. Any thread. */
+void speed_obs_get(struct speed_obs_result *out);
+
+#endif /* SPEED_OBS_H */
@@ -0,0 +1,52 @@
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+
+/* ========================================================================= *
+ * HIGH-RATE TELEMETRY SAMPLE STREAM                                         *
+ * ========================================================================= *
+ * The PID thread pushes one sample per control tick into a single-        *
+ * producer / single-consumer ring; the BLE telemetry thread drains it     *
+ * into batched v2 notifications. Every sample carries a sequence number   *
+ * assigned at push time, so samples dropped because the ring was full    *
+ * show up as a gap on the client.                                          */
+
+struct telemetry_sample {
+    uint32_t t_ms;          // k_uptime at the control tick
+    uint16_t seq;           // per-sample sequence number (wraps)
+    int16_t  raw_rpm;
+    int16_t  filtered_rpm;
+    int16_t  target_rpm;    // setpoint given to the PID this tick
+    uint16_t duty_cpct;     // PID output duty in 0.01 % (0..10000)
+};
+
+/** @brief Start/stop accepting samples (stream subscribed / unsubscribed). */
+void telemetry_stream_enable(bool enable);
+
+/** @brief Queue one sample. PID thread only; never blocks.
+ *  No-op while the stream is disabled; drops (and burns a sequence number)
+ *  if the ring is full.
+ */
+void telemetry_push(int32_t raw_rpm, int32_t filtered_rpm, int32_t target_rpm,
+                    float duty_pct);
+
+/** @brief Copy the sample @p i places after the oldest, leaving it queued.
+ *  Telemetry thread only.
+ *  @return true if there is one.
+ */
+bool telemetry_peek(uint32_t i, struct telemetry_sample *out);
+
+/** @brief Release the @p n oldest samples, once they have been sent.
+ *  Telemetry thread only; @p n must not exceed telemetry_pending().
+ */
+void telemetry_consume(uint32_t n);
+
+/** @brief Discard everything queued. Telemetry thread only. */
+void telemetry_flush(void);
+
+/** @brief Number of samples waiting in the ring. */
+uint32_t telemetry_pending(void);
+
+#endif /* TELEMETRY_H_ */
@@ -0,0 +1,87 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+
+/* ========================================================================= *
+ * EVENT TRACE BUFFER                                                        *
+ * ========================================================================= *
+ * Fixed-size binary log of individual hall edges, commutation steps and    *
+ * duty changes, written from the hall ISR and the PID thread. Recording   *
+ * is one timer read, one atomic slot reservation and an 8-byte store     *
+ * between two writes of the slot's commit mark, so it stays on in         *
+ * production. When an armed trigger fires (stall, estop, manual) the      *
+ * buffer freezes and keeps the history leading up to it until a client   *
+ * has dumped it over BLE and re-armed it.                                  */
+
+enum trace_event {
+    TRACE_EV_NONE      = 0,
+    TRACE_EV_HALL_EDGE = 1,     // arg = hall state,         val = edge dt us (saturated)
+    TRACE_EV_COMMUTATE = 2,     // arg = hall | (ccw << 3),  val = high-side CCR pulse
+    TRACE_EV_DUTY      = 3,     // val = CCR pulse commanded by the PID thread
+    TRACE_EV_STATE     = 4,     // arg = new control state,  val = target (rpm or deg)
+    TRACE_EV_TRIGGER   = 5,     // arg = trigger bit that froze the buffer
+    TRACE_EV_BRAKE     = 6,     // arg = ccw << 3,           val = low-side on pulse
+};
+
+/* Trigger sources — bit mask, see trace_set_triggers(). MANUAL is only a
+ * reason code: trace_freeze() always works regardless of the mask.       */
+#define TRACE_TRIG_MANUAL   0x01
+#define TRACE_TRIG_STALL    0x02
+#define TRACE_TRIG_ESTOP    0x04
+#define TRACE_TRIG_DEFAULT  (TRACE_TRIG_STALL | TRACE_TRIG_ESTOP)
+
+/* 8 bytes, sent over BLE as-is (little-endian) */
+struct trace_entry {
+    uint32_t ts_us;     // TIM2 (1 MHz) on hardware, uptime us under simulation
+    uint8_t  event;     // enum trace_event
+    uint8_t  arg;
+    uint16_t val;
+};
+
+#ifdef CONFIG_MOTOR_TRACE
+
+/** @brief Append one entry. ISR and thread safe; no-op while frozen. */
+void trace_record(uint8_t event, uint8_t arg, uint16_t val);
+
+/** @brief Freeze the buffer if @p trig is armed. ISR safe. */
+void trace_trigger(uint8_t trig);
+
+/** @brief Freeze the buffer unconditionally, logging @p reason. ISR safe. */
+void trace_freeze(uint8_t reason);
+
+/** @brief Choose which TRACE_TRIG_* sources freeze the buffer. */
+void trace_set_triggers(uint8_t mask);
+
+/** @brief Discard the buffer and resume recording. */
+void trace_rearm(void);
+
+/** @brief Return true once a trigger has frozen the buffer. */
+bool trace_is_frozen(void);
+
+/** @brief Number of valid entries in the frozen buffer (0 while recording). */
+uint16_t trace_count(void);
+
+/** @brief Copy frozen entries oldest-first, starting at index @p first.
+ *  A slot whose writer had not finished storing it, or that a writer
+ *  racing the freeze overwrote, comes back as TRACE_EV_NONE, all zero.
+ *  @return number of entries copied (≤ @p max).
+ */
+uint16_t trace_read(uint16_t first, struct trace_entry *out, uint16_t max);
+
+#else
+
+static inline void trace_record(uint8_t event, uint8_t arg, uint16_t val) {}
+static inline void trace_trigger(uint8_t trig) {}
+static inline void trace_freeze(uint8_t reason) {}
+static inline void trace_set_triggers(uint8_t mask) {}
+static inline void trace_rearm(void) {}
+static inline bool trace_is_frozen(void) { return false; }
+static inline uint16_t trace_count(void) { return 0; }
+static inline uint16_t trace_read(uint16_t first, struct trace_entry *out,
+                                  uint16_t max) { return 0; }
+
+#endif /* CONFIG_MOTOR_TRACE */
+
+#endif /* TRACE_H_ */
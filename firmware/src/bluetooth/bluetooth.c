@@ -11,6 +11,19 @@
 #include "bluetooth.h"
 #include "watchdog.h"
 #include "motor.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "prof.h"
+#include "params.h"
+#ifdef CONFIG_MOTOR_AUTOTUNE
+#include "autotune.h"
+#endif
+#ifdef CONFIG_MOTOR_HALL_COMP
+#include "hall_comp.h"
+#endif
+#ifdef CONFIG_MOTOR_GAIN_SCHED
+#include "gain_sched.h"
+#endif
 
 LOG_MODULE_REGISTER(bluetooth, LOG_LEVEL_INF);
 
@@ -23,33 +36,144 @@ LOG_MODULE_REGISTER(bluetooth, LOG_LEVEL_INF);
 /* Manufacturer specific data: 2-byte company ID + 6-byte unique device ID */
 #define MSD_LEN (2 + 6)
 
+/* Telemetry thread pacing */
+#define TELEMETRY_TICK_MS       10
+#define TELEMETRY_V1_EVERY      10      // legacy 9-byte packet every 10 ticks = 10 Hz
+#define STREAM_MAX_LATENCY_MS   50      // send a partial v2 frame after this long
+
+/* Telemetry v2 frame: 8-byte header + 10 bytes per sample */
+#define STREAM_VERSION          0x02
+#define STREAM_HDR_LEN          8
+#define STREAM_SAMPLE_LEN       10
+#define STREAM_MAX_SAMPLES      23      // 8 + 23*10 = 238 ≤ 244 (247 MTU - 3)
+
+/* Trace dump chunk: 4-byte header + 8 bytes per entry */
+#define TRACE_HDR_LEN           4
+#define TRACE_ENTRY_LEN         8
+#define TRACE_CHUNK_MAX         30      // 4 + 30*8 = 244
+#define TRACE_DUMP_BURST        4       // chunks queued per telemetry tick
+
+/* Diagnostics read: 8-byte header + one fixed-size record per probe */
+#define DIAG_VERSION            0x01
+#define DIAG_HDR_LEN            8
+#define DIAG_PROBE_LEN          (4 * 4 + 4 * PROF_HIST_BUCKETS)     // 80
+#define DIAG_LEN                (DIAG_HDR_LEN + PROF_PROBE_COUNT * DIAG_PROBE_LEN)
+BUILD_ASSERT(DIAG_LEN <= BT_ATT_MAX_ATTRIBUTE_LEN, "diagnostics value too long");
+
+/* Autotune result: one fixed 52-byte record, see read_autotune() */
+#define AUTOTUNE_VERSION        0x01
+#define AUTOTUNE_LEN            52
+
+/* Gain schedule: 4-byte header + 16 bytes per point, see read_gain_sched() */
+#define GSCHED_VERSION          0x01
+#define GSCHED_HDR_LEN          4
+#define GSCHED_POINT_LEN        16
+#define GSCHED_MAX_POINTS       8       // = GAIN_SCHED_MAX_POINTS; 4 + 8*16 = 132
+#ifdef CONFIG_MOTOR_GAIN_SCHED
+BUILD_ASSERT(GSCHED_MAX_POINTS == GAIN_SCHED_MAX_POINTS, "gain schedule size mismatch");
+#endif
+
+/* Parameters: request [version][op][seq][n] + entries, response
+ * [version][op][seq][status][bad][n] + n entries, see write_params() */
+#define PARAMS_VERSION          0x01
+#define PARAMS_REQ_HDR_LEN      4
+#define PARAMS_SET_LEN          5       // [id][value 4B]
+#define PARAMS_RSP_HDR_LEN      6
+#define PARAMS_ENTRY_LEN        6       // [id][type][value 4B]
+#define PARAMS_RSP_MAX          (PARAMS_RSP_HDR_LEN + PARAM_COUNT * PARAMS_ENTRY_LEN)
+BUILD_ASSERT(PARAMS_RSP_MAX + 3 <= CONFIG_BT_L2CAP_TX_MTU,
+             "a full params response no longer fits one notification");
+
 /* ========================================================================= *
  * MODULE STATE                                                              *
  * ========================================================================= */
 static struct motor_app_ctx motor_ctx;
 
+/* motor_ctx.conn changes in the BT RX thread (connected/disconnected). The
+ * telemetry thread takes its own ref under this lock for each tick, so a
+ * disconnect mid-tick cannot free the connection under it. */
+static struct k_spinlock conn_lock;
+
 static bool first_heartbeat = true;
 
 static const struct bt_uuid_128 motor_srv_uuid      = BT_UUID_INIT_128(BT_UUID_MOTOR_SERVICE_VAL);
 static const struct bt_uuid_128 motor_cmd_char_uuid = BT_UUID_INIT_128(BT_UUID_MOTOR_CMD_VAL);
 static const struct bt_uuid_128 heartbeat_char_uuid = BT_UUID_INIT_128(BT_UUID_MOTOR_HEARTBEAT_VAL);
 static const struct bt_uuid_128 motor_tel_char_uuid = BT_UUID_INIT_128(BT_UUID_MOTOR_TELEMETRY_VAL);
+static const struct bt_uuid_128 motor_tel2_char_uuid = BT_UUID_INIT_128(BT_UUID_MOTOR_TELEMETRY_V2_VAL);
+static const struct bt_uuid_128 motor_trace_char_uuid = BT_UUID_INIT_128(BT_UUID_MOTOR_TRACE_VAL);
+static const struct bt_uuid_128 motor_diag_char_uuid = BT_UUID_INIT_128(BT_UUID_MOTOR_DIAG_VAL);
+static const struct bt_uuid_128 motor_autotune_char_uuid = BT_UUID_INIT_128(BT_UUID_MOTOR_AUTOTUNE_VAL);
+static const struct bt_uuid_128 motor_gsched_char_uuid = BT_UUID_INIT_128(BT_UUID_MOTOR_GAIN_SCHED_VAL);
+static const struct bt_uuid_128 motor_params_char_uuid = BT_UUID_INIT_128(BT_UUID_MOTOR_PARAMS_VAL);
 
 static uint8_t dev_id_le[6];
 static uint8_t msd[MSD_LEN];
 
 /* ========================================================================= *
  * TELEMETRY THREAD                                                          *
- * Pushes motor state to the connected BLE device at 10 Hz.                *
+ * Pushes the legacy 9-byte state packet at 10 Hz and drains the v2 sample  *
+ * ring into MTU-sized batches. A v2 frame goes out as soon as it is full, *
+ * or after STREAM_MAX_LATENCY_MS with whatever has accumulated.           *
+ * A requested trace dump is paced out from here as well.                  *
  * Only wakes Zephyr BT stack when a client is actually subscribed.        *
+ * Each tick holds its own connection ref, NULL once disconnected.         *
  * ========================================================================= */
+static bool motor_notify_stream(struct bt_conn *conn);
+static void trace_dump_step(struct bt_conn *conn);
+static void stream_reset(void);
+static void autotune_notify_step(struct bt_conn *conn);
+static void params_notify_step(struct bt_conn *conn);
+static uint32_t stream_backlog(void);
+static uint16_t stream_frame_capacity(struct bt_conn *conn);
+
+/** A new ref to the current connection, or NULL. Release with bt_conn_unref(). */
+static struct bt_conn *conn_get(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&conn_lock);
+    struct bt_conn *conn = motor_ctx.conn ? bt_conn_ref(motor_ctx.conn) : NULL;
+    k_spin_unlock(&conn_lock, key);
+    return conn;
+}
+
 static void telemetry_thread_fn(void *arg1, void *arg2, void *arg3)
 {
+    uint32_t v1_tick    = 0;
+    uint32_t last_frame = k_uptime_get_32();
+
     while (1) {
-        if (motor_ctx.notification_enabled) {
-            motor_notify_telemetry();
+        struct bt_conn *conn = conn_get();
+
+        if (++v1_tick >= TELEMETRY_V1_EVERY) {
+            v1_tick = 0;
+            if (motor_ctx.notification_enabled) {
+                motor_notify_telemetry();
+            }
+        }
+
+        if (motor_ctx.stream_enabled) {
+            uint16_t cap = stream_frame_capacity(conn);
+            while (stream_backlog() >= cap ||
+                   (stream_backlog() > 0 &&
+                    k_uptime_get_32() - last_frame >= STREAM_MAX_LATENCY_MS)) {
+                if (!motor_notify_stream(conn)) {
+                    break;          // TX buffers full — the samples wait
+                }
+                last_frame = k_uptime_get_32();
+            }
+        } else {
+            stream_reset();
+            last_frame = k_uptime_get_32();
+        }
+
+        trace_dump_step(conn);
+        autotune_notify_step(conn);
+        params_notify_step(conn);
+
+        if (conn) {
+            bt_conn_unref(conn);
         }
-        k_msleep(100);
+        k_msleep(TELEMETRY_TICK_MS);
     }
 }
 
@@ -107,6 +231,26 @@ static ssize_t write_motor(struct bt_conn *conn,
         case MOTOR_MODE_OFF:
             motor_set_target_speed(0);
             break;
+        case MOTOR_MODE_ESTOP:
+            motor_trigger_estop();
+            break;
+        case MOTOR_MODE_AUTOTUNE:
+            if (!IS_ENABLED(CONFIG_MOTOR_AUTOTUNE) || val <= 0 || val > RPM_MAX) {
+                return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+            }
+            motor_start_autotune(val);
+            break;
+        case MOTOR_MODE_HALL_CAL:
+#ifdef CONFIG_MOTOR_HALL_COMP
+            if (val < HALL_COMP_MIN_RPM || val > RPM_MAX) {
+                return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+            }
+            motor_set_target_speed(val);
+            hall_comp_request(val);
+            break;
+#else
+            return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+#endif
         default:
             LOG_WRN("Unknown motor command: 0x%02X", cmd);
             return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
@@ -165,6 +309,410 @@ static ssize_t write_heartbeat(struct bt_conn *conn,
     return (ssize_t)len;
 }
 
+/** Trace characteristic write handler.
+ *  Packet layout: [opcode: 1 byte][args] — see trace_cmd_t.
+ *  A dump is only queued here; the telemetry thread sends the chunks.
+ */
+static volatile bool     trace_dump_active = false;
+static volatile uint16_t trace_dump_next   = 0;
+
+static ssize_t write_trace(struct bt_conn *conn,
+                           const struct bt_gatt_attr *attr,
+                           const void *buf, uint16_t len,
+                           uint16_t offset, uint8_t flags)
+{
+    if (offset != 0) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+    if (len < 1) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    const uint8_t *data = (const uint8_t *)buf;
+
+    switch ((trace_cmd_t)data[0]) {
+        case TRACE_CMD_REARM:
+            trace_dump_active = false;
+            trace_rearm();
+            LOG_INF("Trace re-armed");
+            break;
+        case TRACE_CMD_FREEZE:
+            trace_freeze(TRACE_TRIG_MANUAL);
+            break;
+        case TRACE_CMD_TRIGGERS:
+            if (len < 2) {
+                return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+            }
+            trace_set_triggers(data[1]);
+            LOG_INF("Trace triggers = 0x%02X", data[1]);
+            break;
+        case TRACE_CMD_DUMP:
+            // Dumping a live ring would mix old and new entries — freeze it
+            trace_freeze(TRACE_TRIG_MANUAL);
+            trace_dump_next   = 0;
+            trace_dump_active = true;
+            LOG_INF("Trace dump: %u entries", trace_count());
+            break;
+        default:
+            LOG_WRN("Unknown trace command: 0x%02X", data[0]);
+            return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+
+    return (ssize_t)len;
+}
+
+/** Params characteristic write handler — batched runtime parameters.
+ *  Request layout:
+ *   [0] version  [1] op (params_cmd_t)  [2] seq, echoed  [3] n
+ *   GET       n ids, 1 byte each; n = 0 reads every parameter
+ *   SET       n entries of [id][value : 4 bytes LE, uint32 or float bits]
+ *   SAVE, DEFAULTS  n = 0
+ *  The result is the characteristic's value until the next request, and
+ *  is notified when subscribed; see params_respond(). A SET is all or
+ *  nothing and goes live at the next control tick. SAVE runs on the
+ *  system work queue — it blocks on flash — and answers when done.
+ */
+static uint8_t           params_rsp[PARAMS_RSP_MAX];
+static uint16_t          params_rsp_len;
+static uint16_t          params_rsp_count;      // bumped per response, for notify
+static struct k_spinlock params_rsp_lock;
+static uint8_t           params_save_seq;
+static volatile bool     params_saving;
+
+/** @brief Publish a response. Entries are the staged values of @p ids. */
+static void params_respond(uint8_t op, uint8_t seq, uint8_t status, uint8_t bad,
+                           const uint8_t *ids, uint8_t n)
+{
+    struct param_entry e[PARAM_COUNT];
+
+    for (uint8_t i = 0; i < n; i++) {
+        e[i].id = ids[i];
+    }
+    if (params_get(e, n)) {
+        n = 0;                      // ids were checked by the caller
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&params_rsp_lock);
+    params_rsp[0] = PARAMS_VERSION;
+    params_rsp[1] = op;
+    params_rsp[2] = seq;
+    params_rsp[3] = status;
+    params_rsp[4] = bad;
+    params_rsp[5] = n;
+    for (uint8_t i = 0; i < n; i++) {
+        uint8_t *p = &params_rsp[PARAMS_RSP_HDR_LEN + i * PARAMS_ENTRY_LEN];
+        p[0] = e[i].id;
+        p[1] = (uint8_t)param_type(e[i].id);
+        sys_put_le32(e[i].v.u, &p[2]);
+    }
+    params_rsp_len = PARAMS_RSP_HDR_LEN + n * PARAMS_ENTRY_LEN;
+    params_rsp_count++;
+    k_spin_unlock(&params_rsp_lock, key);
+}
+
+static void params_respond_all(uint8_t op, uint8_t seq, uint8_t status)
+{
+    uint8_t ids[PARAM_COUNT];
+    for (uint8_t i = 0; i < PARAM_COUNT; i++) {
+        ids[i] = i;
+    }
+    params_respond(op, seq, status, 0xFF, ids, PARAM_COUNT);
+}
+
+static void params_save_work_fn(struct k_work *work)
+{
+    int err = params_save();
+#ifdef CONFIG_MOTOR_GAIN_SCHED
+    if (!err) {
+        err = gain_sched_save();    // kp, ki and feedforward live in the schedule
+    }
+#endif
+    uint8_t status = (err == 0)        ? PARAMS_ST_OK :
+                     (err == -ENOTSUP) ? PARAMS_ST_NOT_SUPP : PARAMS_ST_STORAGE;
+
+    params_respond(PARAMS_CMD_SAVE, params_save_seq, status, 0xFF, NULL, 0);
+    params_saving = false;
+}
+
+static K_WORK_DEFINE(params_save_work, params_save_work_fn);
+
+static ssize_t write_params(struct bt_conn *conn,
+                            const struct bt_gatt_attr *attr,
+                            const void *buf, uint16_t len,
+                            uint16_t offset, uint8_t flags)
+{
+    if (offset != 0) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+    if (len < PARAMS_REQ_HDR_LEN) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    const uint8_t *data = (const uint8_t *)buf;
+    const uint8_t *body = &data[PARAMS_REQ_HDR_LEN];
+    uint8_t op  = data[1];
+    uint8_t seq = data[2];
+    uint8_t n   = data[3];
+
+    if (data[0] != PARAMS_VERSION || n > PARAM_COUNT) {
+        return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+
+    switch ((params_cmd_t)op) {
+        case PARAMS_CMD_GET:
+            if (len != PARAMS_REQ_HDR_LEN + n) {
+                return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+            }
+            if (n == 0) {
+                params_respond_all(op, seq, PARAMS_ST_OK);
+                break;
+            }
+            for (uint8_t i = 0; i < n; i++) {
+                if (body[i] >= PARAM_COUNT) {
+                    params_respond(op, seq, PARAMS_ST_REJECTED, i, NULL, 0);
+                    return (ssize_t)len;
+                }
+            }
+            params_respond(op, seq, PARAMS_ST_OK, 0xFF, body, n);
+            break;
+
+        case PARAMS_CMD_SET: {
+            if (len != PARAMS_REQ_HDR_LEN + n * PARAMS_SET_LEN) {
+                return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+            }
+            struct param_entry e[PARAM_COUNT];
+            uint8_t            ids[PARAM_COUNT];
+            for (uint8_t i = 0; i < n; i++) {
+                e[i].id   = body[i * PARAMS_SET_LEN];
+                e[i].v.u  = sys_get_le32(&body[i * PARAMS_SET_LEN + 1]);
+                ids[i]    = e[i].id;
+            }
+            int rc = params_set(e, n);
+            if (rc) {
+                LOG_WRN("Params SET rejected at entry %d", -rc - 1);
+                params_respond(op, seq, PARAMS_ST_REJECTED, (uint8_t)(-rc - 1), NULL, 0);
+            } else {
+                params_respond(op, seq, PARAMS_ST_OK, 0xFF, ids, n);
+            }
+            break;
+        }
+
+        case PARAMS_CMD_SAVE:
+            if (params_saving) {
+                params_respond(op, seq, PARAMS_ST_BUSY, 0xFF, NULL, 0);
+                break;
+            }
+            params_saving   = true;
+            params_save_seq = seq;
+            k_work_submit(&params_save_work);
+            break;
+
+        case PARAMS_CMD_DEFAULTS:
+            params_defaults();
+            params_respond_all(op, seq, PARAMS_ST_OK);
+            break;
+
+        default:
+            LOG_WRN("Unknown params command: 0x%02X", op);
+            return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+
+    return (ssize_t)len;
+}
+
+/* ========================================================================= *
+ * GATT READ CALLBACKS                                                       *
+ * ========================================================================= */
+
+/** Params characteristic read handler — the last request's response.
+ *  Layout:
+ *   [0] version  [1] op  [2] seq  [3] status (params_status_t)
+ *   [4] index of the rejected entry, 0xFF if none  [5] n
+ *   then n entries of [id][type : enum param_type][value : 4 bytes LE]
+ *  A GET of the whole table is PARAMS_RSP_MAX = 6 + 6·PARAM_COUNT bytes, so
+ *  it is notified only on an ATT MTU of at least PARAMS_RSP_MAX + 3; the 247
+ *  requested on connect is enough (asserted above). A client on the default
+ *  23-byte MTU reads it in blobs instead.
+ */
+static ssize_t read_params(struct bt_conn *conn,
+                           const struct bt_gatt_attr *attr,
+                           void *buf, uint16_t len, uint16_t offset)
+{
+    uint8_t  rec[PARAMS_RSP_MAX];
+    uint16_t n;
+
+    k_spinlock_key_t key = k_spin_lock(&params_rsp_lock);
+    n = params_rsp_len;
+    memcpy(rec, params_rsp, n);
+    k_spin_unlock(&params_rsp_lock, key);
+
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, rec, n);
+}
+
+/** Gain schedule characteristic write handler — replace rpm_pid's table.
+ *  Same layout as read_gain_sched(); the points must be sorted by speed.
+ *  The new table goes live at the start of the next control tick.
+ */
+static ssize_t write_gain_sched(struct bt_conn *conn,
+                                const struct bt_gatt_attr *attr,
+                                const void *buf, uint16_t len,
+                                uint16_t offset, uint8_t flags)
+{
+    if (offset != 0) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+    if (len < GSCHED_HDR_LEN) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    const uint8_t *data = (const uint8_t *)buf;
+    uint8_t n = data[1];
+
+    if (data[0] != GSCHED_VERSION || n > GSCHED_MAX_POINTS) {
+        return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+    if (len != GSCHED_HDR_LEN + n * GSCHED_POINT_LEN) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+#ifdef CONFIG_MOTOR_GAIN_SCHED
+    struct gain_sched_table t = { .n = n };
+    for (uint8_t i = 0; i < n; i++) {
+        const uint8_t *p = &data[GSCHED_HDR_LEN + i * GSCHED_POINT_LEN];
+        t.pt[i].rpm       = sys_get_le16(&p[0]);
+        t.pt[i].ff_offset = (float)(int16_t)sys_get_le16(&p[2]) / 100.0f;
+        t.pt[i].kp        = (float)sys_get_le32(&p[4])  / 1e6f;
+        t.pt[i].ki        = (float)sys_get_le32(&p[8])  / 1e6f;
+        t.pt[i].ff_gain   = (float)sys_get_le32(&p[12]) / 1e6f;
+    }
+    if (gain_sched_load(&t)) {
+        LOG_WRN("Gain schedule rejected (%u points)", n);
+        return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+    return (ssize_t)len;
+#else
+    return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+#endif
+}
+
+/** Gain schedule characteristic read handler — rpm_pid's active table.
+ *  Layout, all LE:
+ *   [0] version  [1] n points (0 without CONFIG_MOTOR_GAIN_SCHED)  [2..3] reserved
+ *   then n points of 16 bytes, sorted by speed:
+ *    [0..1] rpm : uint16   [2..3] ff_offset : int16, 0.01 %
+ *    [4..7] kp  [8..11] ki  [12..15] ff_gain : uint32, x1e6
+ */
+static ssize_t read_gain_sched(struct bt_conn *conn,
+                               const struct bt_gatt_attr *attr,
+                               void *buf, uint16_t len, uint16_t offset)
+{
+    uint8_t rec[GSCHED_HDR_LEN + GSCHED_MAX_POINTS * GSCHED_POINT_LEN] = { 0 };
+    uint8_t n = 0;
+
+    rec[0] = GSCHED_VERSION;
+#ifdef CONFIG_MOTOR_GAIN_SCHED
+    struct gain_sched_table t;
+    gain_sched_get(&t);
+
+    n = t.n;
+    for (uint8_t i = 0; i < n; i++) {
+        uint8_t *p = &rec[GSCHED_HDR_LEN + i * GSCHED_POINT_LEN];
+        sys_put_le16((uint16_t)t.pt[i].rpm,                             &p[0]);
+        sys_put_le16((uint16_t)(int16_t)(t.pt[i].ff_offset * 100.0f),   &p[2]);
+        sys_put_le32((uint32_t)(t.pt[i].kp      * 1e6f + 0.5f),         &p[4]);
+        sys_put_le32((uint32_t)(t.pt[i].ki      * 1e6f + 0.5f),         &p[8]);
+        sys_put_le32((uint32_t)(t.pt[i].ff_gain * 1e6f + 0.5f),         &p[12]);
+    }
+#endif
+    rec[1] = n;
+
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, rec,
+                             GSCHED_HDR_LEN + n * GSCHED_POINT_LEN);
+}
+
+/** Diagnostics characteristic read handler — profiler counters.
+ *  The value is rebuilt on every read; a client reading it in several
+ *  blob requests may see counters move between them.
+ */
+static uint8_t diag_buf[DIAG_LEN];  // BT RX thread only — keeps DIAG_LEN bytes off its stack
+
+static ssize_t read_diag(struct bt_conn *conn,
+                         const struct bt_gatt_attr *attr,
+                         void *buf, uint16_t len, uint16_t offset)
+{
+    diag_buf[0] = DIAG_VERSION;
+    diag_buf[1] = IS_ENABLED(CONFIG_MOTOR_PROF) ? PROF_PROBE_COUNT : 0;
+    diag_buf[2] = PROF_HIST_BUCKETS;
+    diag_buf[3] = 0;
+    sys_put_le32(prof_cycles_per_sec(), &diag_buf[4]);
+
+    for (uint8_t p = 0; p < PROF_PROBE_COUNT; p++) {
+        struct prof_stats s;
+        prof_snapshot(p, &s);
+
+        uint8_t *rec = &diag_buf[DIAG_HDR_LEN + p * DIAG_PROBE_LEN];
+        sys_put_le32(s.count, &rec[0]);
+        sys_put_le32(s.min,   &rec[4]);
+        sys_put_le32(s.count ? (uint32_t)(s.sum / s.count) : 0, &rec[8]);
+        sys_put_le32(s.max,   &rec[12]);
+        for (int b = 0; b < PROF_HIST_BUCKETS; b++) {
+            sys_put_le32(s.hist[b], &rec[16 + 4 * b]);
+        }
+    }
+
+    uint16_t total = DIAG_HDR_LEN +
+                     (IS_ENABLED(CONFIG_MOTOR_PROF) ? PROF_PROBE_COUNT : 0) *
+                     DIAG_PROBE_LEN;
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, diag_buf, total);
+}
+
+/** Autotune characteristic read handler — last experiment's result.
+ *  Record layout, all LE (scaled to integers):
+ *   [0] version  [1] status  [2] error  [3] relay cycles averaged
+ *   [4]  operating point, rpm       [8]  u0, 0.01 %
+ *  [12]  K, rpm/% x1000            [16]  T, us
+ *  [20]  L, us                     [24]  Tu, us
+ *  [28]  relay amplitude, rpm x10  [32]  Ku, %/rpm x1e6
+ *  [36]  kp x1e6                   [40]  ki x1e6
+ *  [44]  ff_gain x1e6              [48]  ff_offset, 0.01 %
+ *  Without CONFIG_MOTOR_AUTOTUNE only the version byte is set.
+ */
+static void pack_autotune(uint8_t out[AUTOTUNE_LEN])
+{
+    memset(out, 0, AUTOTUNE_LEN);
+    out[0] = AUTOTUNE_VERSION;
+
+#ifdef CONFIG_MOTOR_AUTOTUNE
+    struct autotune_result r;
+    autotune_get_result(&r);
+
+    out[1] = r.status;
+    out[2] = r.error;
+    out[3] = r.cycles;
+    sys_put_le32((uint32_t)r.rpm,                              &out[4]);
+    sys_put_le32((uint32_t)(int32_t)(r.u0_pct    * 100.0f),    &out[8]);
+    sys_put_le32((uint32_t)(int32_t)(r.k_rpm_pct * 1000.0f),   &out[12]);
+    sys_put_le32((uint32_t)(int32_t)(r.tau_s     * 1e6f),      &out[16]);
+    sys_put_le32((uint32_t)(int32_t)(r.dead_s    * 1e6f),      &out[20]);
+    sys_put_le32((uint32_t)(int32_t)(r.tu_s      * 1e6f),      &out[24]);
+    sys_put_le32((uint32_t)(int32_t)(r.amp_rpm   * 10.0f),     &out[28]);
+    sys_put_le32((uint32_t)(int32_t)(r.ku        * 1e6f),      &out[32]);
+    sys_put_le32((uint32_t)(int32_t)(r.kp        * 1e6f),      &out[36]);
+    sys_put_le32((uint32_t)(int32_t)(r.ki        * 1e6f),      &out[40]);
+    sys_put_le32((uint32_t)(int32_t)(r.ff_gain   * 1e6f),      &out[44]);
+    sys_put_le32((uint32_t)(int32_t)(r.ff_offset * 100.0f),    &out[48]);
+#endif
+}
+
+static ssize_t read_autotune(struct bt_conn *conn,
+                             const struct bt_gatt_attr *attr,
+                             void *buf, uint16_t len, uint16_t offset)
+{
+    uint8_t rec[AUTOTUNE_LEN];
+    pack_autotune(rec);
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, rec, sizeof(rec));
+}
+
 /* ========================================================================= *
  * CCC CALLBACK                                                              *
  * ========================================================================= */
@@ -175,6 +723,35 @@ static void motor_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t valu
             motor_ctx.notification_enabled ? "enabled" : "disabled");
 }
 
+static void stream_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    motor_ctx.stream_enabled = (value == BT_GATT_CCC_NOTIFY);
+    telemetry_stream_enable(motor_ctx.stream_enabled);
+    LOG_INF("Telemetry v2 stream %s",
+            motor_ctx.stream_enabled ? "enabled" : "disabled");
+}
+
+static void trace_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    motor_ctx.trace_enabled = (value == BT_GATT_CCC_NOTIFY);
+    LOG_INF("Trace notifications %s",
+            motor_ctx.trace_enabled ? "enabled" : "disabled");
+}
+
+static void autotune_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    motor_ctx.autotune_enabled = (value == BT_GATT_CCC_NOTIFY);
+    LOG_INF("Autotune notifications %s",
+            motor_ctx.autotune_enabled ? "enabled" : "disabled");
+}
+
+static void params_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    motor_ctx.params_enabled = (value == BT_GATT_CCC_NOTIFY);
+    LOG_INF("Params notifications %s",
+            motor_ctx.params_enabled ? "enabled" : "disabled");
+}
+
 
 /* ========================================================================= *
  * GATT SERVICE DEFINITION                                                   *
@@ -188,6 +765,22 @@ static void motor_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t valu
  *  [5] Telemetry characteristic declaration                                *
  *  [6] Telemetry characteristic value    <- bt_gatt_notify target          *
  *  [7] Telemetry CCC descriptor                                            *
+ *  [8] Telemetry v2 characteristic declaration                             *
+ *  [9] Telemetry v2 characteristic value <- motor_notify_stream()          *
+ * [10] Telemetry v2 CCC descriptor                                         *
+ * [11] Trace characteristic declaration                                    *
+ * [12] Trace characteristic value        <- write_trace(), dump notify     *
+ * [13] Trace CCC descriptor                                                *
+ * [14] Diagnostics characteristic declaration                              *
+ * [15] Diagnostics characteristic value  <- read_diag()                    *
+ * [16] Autotune characteristic declaration                                 *
+ * [17] Autotune characteristic value     <- read_autotune(), result notify *
+ * [18] Autotune CCC descriptor                                             *
+ * [19] Gain schedule characteristic declaration                            *
+ * [20] Gain schedule characteristic value <- read/write_gain_sched()       *
+ * [21] Params characteristic declaration                                   *
+ * [22] Params characteristic value       <- read/write_params(), notify    *
+ * [23] Params CCC descriptor                                               *
  * ========================================================================= */
 BT_GATT_SERVICE_DEFINE(motor_svc,
     BT_GATT_PRIMARY_SERVICE(&motor_srv_uuid),
@@ -208,6 +801,48 @@ BT_GATT_SERVICE_DEFINE(motor_svc,
                            NULL, NULL, NULL),
 
     BT_GATT_CCC(motor_ccc_cfg_changed,
+                BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+
+    BT_GATT_CHARACTERISTIC(&motor_tel2_char_uuid.uuid,
+                           BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_NONE,
+                           NULL, NULL, NULL),
+
+    BT_GATT_CCC(stream_ccc_cfg_changed,
+                BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+
+    BT_GATT_CHARACTERISTIC(&motor_trace_char_uuid.uuid,
+                           BT_GATT_CHRC_WRITE | BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_WRITE,
+                           NULL, write_trace, NULL),
+
+    BT_GATT_CCC(trace_ccc_cfg_changed,
+                BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+
+    BT_GATT_CHARACTERISTIC(&motor_diag_char_uuid.uuid,
+                           BT_GATT_CHRC_READ,
+                           BT_GATT_PERM_READ,
+                           read_diag, NULL, NULL),
+
+    BT_GATT_CHARACTERISTIC(&motor_autotune_char_uuid.uuid,
+                           BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_READ,
+                           read_autotune, NULL, NULL),
+
+    BT_GATT_CCC(autotune_ccc_cfg_changed,
+                BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+
+    BT_GATT_CHARACTERISTIC(&motor_gsched_char_uuid.uuid,
+                           BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+                           BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+                           read_gain_sched, write_gain_sched, NULL),
+
+    BT_GATT_CHARACTERISTIC(&motor_params_char_uuid.uuid,
+                           BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE | BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+                           read_params, write_params, NULL),
+
+    BT_GATT_CCC(params_ccc_cfg_changed,
                 BT_GATT_PERM_READ | BT_GATT_PERM_WRITE)
 );
 
@@ -218,9 +853,12 @@ BT_GATT_SERVICE_DEFINE(motor_svc,
  * ========================================================================= */
 static inline void pack_telemetry(uint8_t out[9])
 {
-    out[0] = motor_get_full_status();
-    sys_put_le32((uint32_t)motor_get_speed(), &out[1]);
-    sys_put_le32((uint32_t)motor_get_position(),       &out[5]);
+    struct motor_stats snap;
+    motor_get_snapshot(&snap);   // one consistent record, no lock taken
+
+    out[0] = snap.motor_status;
+    sys_put_le32((uint32_t)snap.current_speed,    &out[1]);
+    sys_put_le32((uint32_t)snap.current_position, &out[5]);
 }
 
 void motor_notify_telemetry(void)
@@ -229,6 +867,8 @@ void motor_notify_telemetry(void)
         return;
     }
 
+    PROF_BEGIN(t0);
+
     uint8_t telemetry_data[9];
     pack_telemetry(telemetry_data);
 
@@ -240,8 +880,263 @@ void motor_notify_telemetry(void)
         // check and the notify call; anything else is worth logging.
         LOG_WRN("Telemetry notify failed (err %d)", err);
     }
+
+    PROF_END(PROF_NOTIFY_TEL, t0);
+}
+
+/* ========================================================================= *
+ * TELEMETRY V2 STREAM                                                       *
+ * Frame layout (all LE):                                                   *
+ *   [0]     version = 0x02                                                 *
+ *   [1]     n = sample count                                               *
+ *   [2..3]  seq of the first sample; the n samples are consecutive        *
+ *   [4..7]  t0 = uptime ms of the first sample                             *
+ *   n × 10B [dt_ms from t0: u16][raw: i16][filtered: i16][target: i16]     *
+ *           [duty: u16, 0.01 %]                                            *
+ * A frame is cut short at any sequence gap, so the client can find every  *
+ * dropped sample from (seq, n) alone.                                      *
+ * ========================================================================= */
+static uint32_t stream_dropped;     // samples whose notify failed, since boot
+
+/** Samples waiting to go out. */
+static uint32_t stream_backlog(void)
+{
+    return telemetry_pending();
+}
+
+/** Drop everything queued while nobody is subscribed. */
+static void stream_reset(void)
+{
+    telemetry_flush();
+}
+
+/** Samples per frame that fit the negotiated ATT MTU (≥ 1). */
+static uint16_t stream_frame_capacity(struct bt_conn *conn)
+{
+    uint16_t mtu = conn ? bt_gatt_get_mtu(conn) : 23;
+    int cap = ((int)mtu - 3 - STREAM_HDR_LEN) / STREAM_SAMPLE_LEN;
+    if (cap < 1)                  cap = 1;
+    if (cap > STREAM_MAX_SAMPLES) cap = STREAM_MAX_SAMPLES;
+    return (uint16_t)cap;
+}
+
+/** Send the oldest queued samples as one frame. They stay in the ring until
+ *  the notification is queued: out of TX buffers, they go again next tick;
+ *  any other failure drops them, counted in stream_dropped.
+ *  @return false if nothing left the ring.
+ */
+static bool motor_notify_stream(struct bt_conn *conn)
+{
+    static uint8_t frame[STREAM_HDR_LEN + STREAM_MAX_SAMPLES * STREAM_SAMPLE_LEN];
+
+    struct telemetry_sample s;
+    if (!telemetry_peek(0, &s)) {
+        return false;
+    }
+
+    uint16_t cap   = stream_frame_capacity(conn);
+    uint16_t seq0  = s.seq;
+    uint32_t t0    = s.t_ms;
+    uint8_t  n     = 0;
+
+    while (1) {
+        uint8_t *p = &frame[STREAM_HDR_LEN + n * STREAM_SAMPLE_LEN];
+        sys_put_le16((uint16_t)(s.t_ms - t0),     &p[0]);
+        sys_put_le16((uint16_t)s.raw_rpm,         &p[2]);
+        sys_put_le16((uint16_t)s.filtered_rpm,    &p[4]);
+        sys_put_le16((uint16_t)s.target_rpm,      &p[6]);
+        sys_put_le16(s.duty_cpct,                 &p[8]);
+        n++;
+
+        if (n >= cap || !telemetry_peek(n, &s)) {
+            break;
+        }
+        if (s.seq != (uint16_t)(seq0 + n)) {
+            break;                  // gap — starts the next frame
+        }
+    }
+
+    frame[0] = STREAM_VERSION;
+    frame[1] = n;
+    sys_put_le16(seq0, &frame[2]);
+    sys_put_le32(t0,   &frame[4]);
+
+    /* attrs[9] = telemetry v2 characteristic value — see table above */
+    int err = bt_gatt_notify(conn, &motor_svc.attrs[9], frame,
+                             STREAM_HDR_LEN + n * STREAM_SAMPLE_LEN);
+    if (err == -ENOMEM) {
+        return false;
+    }
+    telemetry_consume(n);
+    if (err) {
+        stream_dropped += n;
+        if (err != -ENOTCONN) {
+            LOG_WRN("Telemetry v2 notify failed (err %d), %u samples dropped",
+                    err, stream_dropped);
+        }
+    }
+    return true;
 }
 
+/* ========================================================================= *
+ * TRACE DUMP                                                                *
+ * Chunk layout (all LE):                                                   *
+ *   [0..1]  index of the first entry in this chunk                        *
+ *   [2..3]  total entries in the frozen buffer                             *
+ *   n × 8B  [ts_us: u32][event: u8][arg: u8][val: u16]                     *
+ * Entries are oldest-first. An empty buffer is reported as one chunk      *
+ * with total = 0. The buffer stays frozen until TRACE_CMD_REARM.          *
+ * ========================================================================= */
+static void trace_dump_step(struct bt_conn *conn)
+{
+    static uint8_t chunk[TRACE_HDR_LEN + TRACE_CHUNK_MAX * TRACE_ENTRY_LEN];
+    static struct trace_entry e[TRACE_CHUNK_MAX];
+
+    if (!trace_dump_active) {
+        return;
+    }
+    if (!motor_ctx.trace_enabled || !conn) {
+        trace_dump_active = false;
+        return;
+    }
+
+    uint16_t mtu = bt_gatt_get_mtu(conn);
+    int cap = ((int)mtu - 3 - TRACE_HDR_LEN) / TRACE_ENTRY_LEN;
+    if (cap < 1)               cap = 1;
+    if (cap > TRACE_CHUNK_MAX) cap = TRACE_CHUNK_MAX;
+
+    uint16_t total = trace_count();
+
+    for (int burst = 0; burst < TRACE_DUMP_BURST; burst++) {
+        uint16_t first = trace_dump_next;
+        uint16_t n     = trace_read(first, e, (uint16_t)cap);
+
+        sys_put_le16(first, &chunk[0]);
+        sys_put_le16(total, &chunk[2]);
+        for (uint16_t i = 0; i < n; i++) {
+            uint8_t *p = &chunk[TRACE_HDR_LEN + i * TRACE_ENTRY_LEN];
+            sys_put_le32(e[i].ts_us, &p[0]);
+            p[4] = e[i].event;
+            p[5] = e[i].arg;
+            sys_put_le16(e[i].val,   &p[6]);
+        }
+
+        /* attrs[12] = trace characteristic value — see table above */
+        int err = bt_gatt_notify(conn, &motor_svc.attrs[12], chunk,
+                                 TRACE_HDR_LEN + n * TRACE_ENTRY_LEN);
+        if (err == -ENOMEM) {
+            return;                 // TX buffers full — resume next tick
+        }
+        if (err) {
+            LOG_WRN("Trace dump aborted (err %d)", err);
+            trace_dump_active = false;
+            return;
+        }
+
+        trace_dump_next = first + n;
+        if (trace_dump_next >= total) {
+            LOG_INF("Trace dump complete (%u entries)", total);
+            trace_dump_active = false;
+            return;
+        }
+    }
+}
+
+/* ========================================================================= *
+ * AUTOTUNE NOTIFICATION                                                     *
+ * One record each time an experiment starts or finishes (the result's run *
+ * counter moves). Same layout as read_autotune().                          *
+ * ========================================================================= */
+static void autotune_notify_step(struct bt_conn *conn)
+{
+#ifdef CONFIG_MOTOR_AUTOTUNE
+    static uint16_t last_run;
+
+    struct autotune_result r;
+    autotune_get_result(&r);
+    if (r.run == last_run) {
+        return;
+    }
+    if (!motor_ctx.autotune_enabled || !conn) {
+        last_run = r.run;
+        return;
+    }
+
+    uint8_t rec[AUTOTUNE_LEN];
+    pack_autotune(rec);
+
+    /* attrs[17] = autotune characteristic value — see table above */
+    int err = bt_gatt_notify(conn, &motor_svc.attrs[17], rec, sizeof(rec));
+    if (err == -ENOMEM) {
+        return;                     // TX buffers full — retry next tick
+    }
+    if (err) {
+        LOG_WRN("Autotune notify failed (err %d)", err);
+    }
+    last_run = r.run;
+#endif
+}
+
+/* ========================================================================= *
+ * PARAMS NOTIFICATION                                                       *
+ * Each new response, once. Same layout as read_params().                  *
+ * ========================================================================= */
+static void params_notify_step(struct bt_conn *conn)
+{
+    static uint16_t last_count;
+
+    uint8_t  rec[PARAMS_RSP_MAX];
+    uint16_t n, count;
+
+    k_spinlock_key_t key = k_spin_lock(&params_rsp_lock);
+    count = params_rsp_count;
+    n     = params_rsp_len;
+    memcpy(rec, params_rsp, n);
+    k_spin_unlock(&params_rsp_lock, key);
+
+    if (count == last_count) {
+        return;
+    }
+    if (!motor_ctx.params_enabled || !conn) {
+        last_count = count;
+        return;
+    }
+
+    /* attrs[22] = params characteristic value — see table above */
+    int err = bt_gatt_notify(conn, &motor_svc.attrs[22], rec, n);
+    if (err == -ENOMEM) {
+        return;                     // TX buffers full — retry next tick
+    }
+    if (err) {
+        LOG_WRN("Params notify failed (err %d)", err);
+    }
+    last_count = count;
+}
+
+/* ========================================================================= *
+ * MTU / DATA LENGTH                                                         *
+ * ========================================================================= */
+static void mtu_exchanged(struct bt_conn *conn, uint8_t err,
+                          struct bt_gatt_exchange_params *params)
+{
+    LOG_INF("MTU exchange %s — ATT MTU %u",
+            err ? "failed" : "done", bt_gatt_get_mtu(conn));
+}
+
+static struct bt_gatt_exchange_params mtu_params = {
+    .func = mtu_exchanged,
+};
+
+static void att_mtu_updated(struct bt_conn *conn, uint16_t tx, uint16_t rx)
+{
+    LOG_INF("ATT MTU updated: tx=%u rx=%u → %u samples per v2 frame",
+            tx, rx, stream_frame_capacity(conn));
+}
+
+static struct bt_gatt_cb gatt_callbacks = {
+    .att_mtu_updated = att_mtu_updated,
+};
+
 /* ========================================================================= *
  * BLUETOOTH INIT & ADVERTISING                                              *
  * ========================================================================= */
@@ -254,6 +1149,12 @@ void bt_ready(int err)
 
     motor_ctx.heartbeat_val      = 0;
     motor_ctx.notification_enabled = false;
+    motor_ctx.stream_enabled       = false;
+    motor_ctx.trace_enabled        = false;
+    motor_ctx.autotune_enabled     = false;
+    motor_ctx.params_enabled       = false;
+
+    bt_gatt_cb_register(&gatt_callbacks);
 
     LOG_INF("Bluetooth initialised");
 
@@ -301,20 +1202,57 @@ static void connected(struct bt_conn *conn, uint8_t err)
     }
     LOG_INF("BLE connected");
     first_heartbeat = true;   // Reset sync check for new connection
+
+    k_spinlock_key_t key = k_spin_lock(&conn_lock);
+    motor_ctx.conn = bt_conn_ref(conn);
+    k_spin_unlock(&conn_lock, key);
+
+    // Ask for the largest MTU and LL payload so v2 frames batch many samples
+    int rc = bt_gatt_exchange_mtu(conn, &mtu_params);
+    if (rc) {
+        LOG_WRN("MTU exchange request failed (err %d)", rc);
+    }
+    rc = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+    if (rc) {
+        LOG_WRN("Data length update request failed (err %d)", rc);
+    }
+}
+
+static void le_data_len_updated(struct bt_conn *conn,
+                                struct bt_conn_le_data_len_info *info)
+{
+    LOG_INF("Data length: tx=%uB/%uus rx=%uB/%uus",
+            info->tx_max_len, info->tx_max_time,
+            info->rx_max_len, info->rx_max_time);
 }
 
 static void disconnected(struct bt_conn *conn, uint8_t reason)
 {
     LOG_INF("BLE disconnected (reason %u)", reason);
     motor_ctx.notification_enabled = false;
+    motor_ctx.stream_enabled       = false;
+    motor_ctx.trace_enabled        = false;
+    motor_ctx.autotune_enabled     = false;
+    motor_ctx.params_enabled       = false;
+    telemetry_stream_enable(false);
+
+    // The telemetry thread keeps its own ref until the end of its tick
+    k_spinlock_key_t key = k_spin_lock(&conn_lock);
+    struct bt_conn *old = motor_ctx.conn;
+    motor_ctx.conn = NULL;
+    k_spin_unlock(&conn_lock, key);
+    if (old) {
+        bt_conn_unref(old);
+    }
     first_heartbeat = true;   // Reset for next connection
     watchdog_stop();
     motor_set_target_speed(0);
 }
 
 struct bt_conn_cb conn_callbacks = {
-    .connected    = connected,
-    .disconnected = disconnected,
+    .connected           = connected,
+    .disconnected        = disconnected,
+    .le_data_len_updated = le_data_len_updated,
 };
 
 /* ========================================================================= *
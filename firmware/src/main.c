@@ -13,12 +13,20 @@
 #include "watchdog.h"
 #include "motor.h"
 #include "bldc_driver.h"
+#include "bldc_hall.h"
 #include "motor_control.h"
+#include "prof.h"
+#include "pid.h"
+#include "params.h"
 
 #ifdef CONFIG_MOTOR_SIM
 #include "motor_sim.h"
 #endif
 
+#ifdef CONFIG_MOTOR_SIM_VIRTUAL_TIME
+#include "posix_board_if.h"
+#endif
+
 LOG_MODULE_REGISTER(main, LOG_LEVEL_INF);
 
 
@@ -26,6 +34,32 @@ int main(void)
 {
     LOG_INF("Starting BLDC Hardware Motor Control Application");    
 
+    // Start the cycle counter before any probed path can run
+    prof_init();
+
+    #if defined(CONFIG_MOTOR_PID_SELFTEST) && !defined(CONFIG_MOTOR_SIM_VIRTUAL_TIME)
+        // Before any control thread exists; the sim runner does its own
+        if (pid_q_selftest() != 0) {
+            LOG_ERR("pid_q_compute disagrees with pid_compute");
+        }
+    #endif
+
+    #if defined(CONFIG_MOTOR_HALL_SELFTEST) && !defined(CONFIG_MOTOR_SIM_VIRTUAL_TIME)
+        if (bldc_hall_selftest() != 0) {
+            LOG_ERR("hall self-test failed");
+        }
+    #endif
+
+    #if defined(CONFIG_MOTOR_VAULT_BENCH) && !defined(CONFIG_MOTOR_SIM_VIRTUAL_TIME)
+        // Wipes the vault, so before motor_boot()
+        if (motor_vault_bench() != 0) {
+            LOG_ERR("stats vault read back a different record");
+        }
+    #endif
+
+    // Runtime parameters (defaults, then flash) before anything reads them
+    params_init();
+
     // Initialize the Motor Data Structures (Safe API Vault)
     motor_boot(); 
 
@@ -44,6 +78,11 @@ int main(void)
         motor_sim_init();
     #endif
 
+    #ifdef CONFIG_MOTOR_SIM_VIRTUAL_TIME
+        // Scenarios drive plant + controller directly; no BLE, no watchdog
+        posix_exit(sim_runner_run() ? 1 : 0);
+    #endif
+
     // Initialize Bluetooth
     int err = bt_enable(bt_ready);
     if (err) {
@@ -1,12 +1,73 @@
 #include "motor.h"
-#include <zephyr/kernel.h> // REQUIRED for k_mutex
+#include "bldc_driver.h"
+#include "seqcount.h"
+#include "trace.h"
+#include <zephyr/kernel.h> // REQUIRED for k_spinlock
 #include <string.h>
 #include <stdbool.h>
 
+/* ========================================================================= *
+ * MOTOR STATS VAULT                                                         *
+ * ========================================================================= *
+ * Writers (PID thread, BLE callbacks, watchdog) are serialised by a        *
+ * spinlock held only for the handful of stores they make; the sequence     *
+ * counter lets readers copy the whole record without taking any lock and  *
+ * retry if a write raced them. Readers therefore never block the control   *
+ * thread and always see speed/position/status from the same update.       */
 static struct motor_stats m_stats;
-static struct k_mutex m_stats_lock;
+static struct k_spinlock  m_stats_lock;
+static seqcount_t         m_stats_seq = SEQCOUNT_INIT;
+
+#ifdef CONFIG_MOTOR_VAULT_STATS
+static struct motor_vault_stats m_vault_stats;
+static uint32_t                 m_vault_write_start;
+#endif
+
+#ifdef CONFIG_MOTOR_ESTOP_BREAK
+static struct motor_estop_stats m_estop_stats;   // WRITTEN INSIDE THE ESTOP'S WRITE SECTION
+#endif
+
+/* PRIVATE HELPERS (ASSUME THAT THE CALLER IS INSIDE A WRITE SECTION)*/
+
+static k_spinlock_key_t _motor_write_begin(void){
+    k_spinlock_key_t key = k_spin_lock(&m_stats_lock);
+#ifdef CONFIG_MOTOR_VAULT_STATS
+    m_vault_stats.writes++;
+    m_vault_write_start = k_cycle_get_32();
+#endif
+    seqcount_write_begin(&m_stats_seq);
+    return key;
+}
 
-/* PRIVATE HELPERS (ASSUME THAT THE CALLER ALREADY LOCKED THE MUTEX)*/
+static void _motor_write_end(k_spinlock_key_t key){
+    seqcount_write_end(&m_stats_seq);
+#ifdef CONFIG_MOTOR_VAULT_STATS
+    m_vault_stats.write_cycles += k_cycle_get_32() - m_vault_write_start;
+#endif
+    k_spin_unlock(&m_stats_lock, key);
+}
+
+/** @brief COPY THE WHOLE RECORD WITHOUT LOCKING - RETRY IF A WRITER RACED US */
+static void _motor_read(struct motor_stats *out){
+#ifdef CONFIG_MOTOR_VAULT_STATS
+    uint32_t start = k_cycle_get_32();
+    uint32_t tries = 0;
+#endif
+    uint32_t seq;
+    do {
+#ifdef CONFIG_MOTOR_VAULT_STATS
+        tries++;
+#endif
+        seq  = seqcount_read_begin(&m_stats_seq);
+        *out = m_stats;
+    } while (seqcount_read_retry(&m_stats_seq, seq));
+#ifdef CONFIG_MOTOR_VAULT_STATS
+    // BEST-EFFORT COUNTERS: READERS RUN CONCURRENTLY SO AN INCREMENT MAY BE LOST
+    m_vault_stats.reads++;
+    m_vault_stats.read_retries += tries - 1;
+    m_vault_stats.read_cycles  += k_cycle_get_32() - start;
+#endif
+}
 
 /** @brief SET OR CLEAR SPECIFIC DIAGONISTIC FLAGS */
 static void _motor_set_flag_unlocked(uint8_t flag, bool active){
@@ -30,12 +91,11 @@ static void _motor_set_target_state(uint8_t new_state){
 /* PUBLIC API */
 
 void motor_boot(void){
-    k_mutex_init(&m_stats_lock);
     motor_init();
 }
 
 void motor_init(void){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
+    k_spinlock_key_t key = _motor_write_begin();
 
     memset(&m_stats, 0, sizeof(m_stats)); // WIPE ALL THE DATA TO ZERO (EVEN PRE-EXISTING DATA)
     _motor_set_state(MOTOR_STATE_STOPPED);
@@ -44,66 +104,119 @@ void motor_init(void){
     _motor_set_flag_unlocked(MOTOR_FLAG_OVERHEAT,  false);
     _motor_set_flag_unlocked(MOTOR_FLAG_STALL,     false);
 
-    k_mutex_unlock(&m_stats_lock);
+    _motor_write_end(key);
 }
 
 /* --- ACTUAL MOTOR STATUS SETTERS (CALLED BY MOTOR THREAD) --- */
 
 void motor_set_speed(int32_t rpm){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
+    k_spinlock_key_t key = _motor_write_begin();
     m_stats.current_speed = rpm;    // SHOULD BE CORRECT VALUE SINCE PASSED DIRECTLY FROM MOTOR LOGIC
     _motor_set_state(MOTOR_STATE_RUNNING_SPEED);
 
-    k_mutex_unlock(&m_stats_lock);
+    _motor_write_end(key);
 }
 
 void motor_set_filtered_speed(int32_t rpm){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
+    k_spinlock_key_t key = _motor_write_begin();
     m_stats.filtered_speed = rpm;
-    k_mutex_unlock(&m_stats_lock);
+    _motor_write_end(key);
 }
 
 void motor_set_position(int32_t degrees){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
+    k_spinlock_key_t key = _motor_write_begin();
     m_stats.current_position = degrees; // SHOULD BE CORRECT VALUE SINCE PASSED DIRECTLY FROM MOTOR LOGIC
     _motor_set_state(MOTOR_STATE_RUNNING_POS);
 
-    k_mutex_unlock(&m_stats_lock);
+    _motor_write_end(key);
+}
+
+void motor_publish_feedback(uint8_t state, int32_t raw_rpm, int32_t filtered_rpm, int32_t degrees){
+    k_spinlock_key_t key = _motor_write_begin();
+    m_stats.current_speed    = raw_rpm;
+    m_stats.filtered_speed   = filtered_rpm;
+    m_stats.current_position = degrees;
+    /* KEEP THE ESTOP motor_trigger_estop() SET SINCE THE LOOP'S SNAPSHOT - THE LOOP ENTERS IT NEXT TICK */
+    _motor_set_state((m_stats.target_state == MOTOR_STATE_ESTOP) ? MOTOR_STATE_ESTOP : state);
+    _motor_write_end(key);
 }
 
 void motor_set_sync_warning(bool active){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
+    k_spinlock_key_t key = _motor_write_begin();
     _motor_set_flag_unlocked(MOTOR_FLAG_SYNC_BAD, active);
-    k_mutex_unlock(&m_stats_lock);
+    _motor_write_end(key);
 }
 
 void motor_set_overheat_warning(bool active){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
+    k_spinlock_key_t key = _motor_write_begin();
     _motor_set_flag_unlocked(MOTOR_FLAG_OVERHEAT, active);
-    k_mutex_unlock(&m_stats_lock);
+    _motor_write_end(key);
 }
 
 void motor_set_stall_warning(bool active){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
+    k_spinlock_key_t key = _motor_write_begin();
     _motor_set_flag_unlocked(MOTOR_FLAG_STALL, active);
-    k_mutex_unlock(&m_stats_lock);
+    _motor_write_end(key);
+
+}
 
+void motor_set_settled(bool active){
+    k_spinlock_key_t key = _motor_write_begin();
+    _motor_set_flag_unlocked(MOTOR_FLAG_POS_SETTLED, active);
+    _motor_write_end(key);
 }
 
 void motor_trigger_estop(){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
+#ifdef CONFIG_MOTOR_ESTOP_BREAK
+    uint32_t start = k_cycle_get_32();
+#endif
+
+    /* THE BREAK AND THE VAULT WRITE SHARE ONE WRITE SECTION: NO CONTEXT CAN SEE THE OUTPUTS OFF
+     * WITH THE OLD TARGET STILL IN THE VAULT, SO motor_release_outputs() CAN NOT UNDO AN ESTOP
+     * THE CONTROL THREAD HAS NOT READ YET */
+    k_spinlock_key_t key = _motor_write_begin();
+#ifdef CONFIG_MOTOR_ESTOP_BREAK
+    bldc_estop();                       // OUTPUTS OFF NOW - THE CONTROL THREAD CATCHES UP ON ITS NEXT TICK
+    uint32_t cycles = k_cycle_get_32() - start;
+    m_estop_stats.count++;
+    m_estop_stats.last_cycles = cycles;
+    if(cycles > m_estop_stats.max_cycles) m_estop_stats.max_cycles = cycles;
+#endif
     _motor_set_state(MOTOR_STATE_ESTOP);
     _motor_set_target_state(MOTOR_STATE_ESTOP);
     m_stats.target_speed = 0;
-    k_mutex_unlock(&m_stats_lock);
+    _motor_write_end(key);
+
+    trace_trigger(TRACE_TRIG_ESTOP);    // KEEP THE EDGES/DUTY THAT LED HERE
 }
 
+#ifdef CONFIG_MOTOR_ESTOP_BREAK
+bool motor_release_outputs(void){
+    bool released = false;
+
+    k_spinlock_key_t key = k_spin_lock(&m_stats_lock);
+    if(m_stats.target_state != MOTOR_STATE_ESTOP){
+        bldc_estop_release();
+        released = true;
+    }
+    k_spin_unlock(&m_stats_lock, key);
+
+    return released;
+}
+
+void motor_get_estop_stats(struct motor_estop_stats *out){
+    k_spinlock_key_t key = k_spin_lock(&m_stats_lock);
+    *out = m_estop_stats;
+    k_spin_unlock(&m_stats_lock, key);
+}
+#endif
+
 
 void motor_set_target_speed(int32_t rpm){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
     if(rpm > RPM_MAX) rpm = RPM_MAX;
     if(rpm < RPM_MIN) rpm = RPM_MIN;
 
+    k_spinlock_key_t key = _motor_write_begin();
     m_stats.target_speed = rpm;
 
     if(rpm != 0){
@@ -112,90 +225,114 @@ void motor_set_target_speed(int32_t rpm){
         _motor_set_target_state(MOTOR_STATE_STOPPED);
     }
 
-    k_mutex_unlock(&m_stats_lock);
+    _motor_write_end(key);
 
 }
 
+void motor_start_autotune(int32_t rpm){
+    if(rpm > RPM_MAX) rpm = RPM_MAX;
+    if(rpm < 1) rpm = 1;
+
+    k_spinlock_key_t key = _motor_write_begin();
+    m_stats.target_speed = rpm;
+    _motor_set_target_state(MOTOR_STATE_AUTOTUNE);
+    _motor_write_end(key);
+}
+
+bool motor_finish_autotune(void){
+    bool stopped = false;
+
+    k_spinlock_key_t key = _motor_write_begin();
+    if(m_stats.target_state == MOTOR_STATE_AUTOTUNE){    // AN ESTOP OR A NEW COMMAND SINCE STAYS
+        m_stats.target_speed = 0;
+        _motor_set_target_state(MOTOR_STATE_STOPPED);
+        stopped = true;
+    }
+    _motor_write_end(key);
+
+    return stopped;
+}
+
 void motor_set_target_position(int32_t degrees){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
+    k_spinlock_key_t key = _motor_write_begin();
 
-    m_stats.target_position = degrees % 360;
+    m_stats.target_position = ((degrees % 360) + 360) % 360;   // [0, 360) EVEN FOR NEGATIVE INPUT
     _motor_set_target_state(MOTOR_STATE_RUNNING_POS);
+    _motor_set_flag_unlocked(MOTOR_FLAG_POS_SETTLED, false);   // NEW MOVE - NOT SETTLED YET
 
-    k_mutex_unlock(&m_stats_lock);
+    _motor_write_end(key);
 }
 
 
 // GETTERS
+void motor_get_snapshot(struct motor_stats *out){
+    _motor_read(out);
+}
+
 uint8_t motor_get_full_status(void){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
-    uint8_t val = m_stats.motor_status;
-    k_mutex_unlock(&m_stats_lock);
-    return val;
+    struct motor_stats snap;
+    _motor_read(&snap);
+    return snap.motor_status;
 }
 
 bool motor_is_sync_bad(void){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
-    bool val = m_stats.motor_status & MOTOR_FLAG_SYNC_BAD;
-    k_mutex_unlock(&m_stats_lock);
-    return val;
+    return motor_get_full_status() & MOTOR_FLAG_SYNC_BAD;
 }
 
 bool motor_is_overheated(void){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
-    bool val = m_stats.motor_status & MOTOR_FLAG_OVERHEAT;
-    k_mutex_unlock(&m_stats_lock);
-    return val;
+    return motor_get_full_status() & MOTOR_FLAG_OVERHEAT;
 }
 
 bool motor_is_stall(void){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
-    bool val = m_stats.motor_status & MOTOR_FLAG_STALL;
-    k_mutex_unlock(&m_stats_lock);
-    return val;
+    return motor_get_full_status() & MOTOR_FLAG_STALL;
+}
+
+bool motor_is_settled(void){
+    return motor_get_full_status() & MOTOR_FLAG_POS_SETTLED;
 }
 
 
 int32_t motor_get_speed(void){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
-    int32_t val = m_stats.current_speed;
-    k_mutex_unlock(&m_stats_lock);
-    return val;
+    struct motor_stats snap;
+    _motor_read(&snap);
+    return snap.current_speed;
 }
 
 int32_t motor_get_filtered_speed(void){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
-    int32_t val = m_stats.filtered_speed;
-    k_mutex_unlock(&m_stats_lock);
-    return val;
+    struct motor_stats snap;
+    _motor_read(&snap);
+    return snap.filtered_speed;
 }
 
 
 int32_t motor_get_position(void){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
-    int32_t val = m_stats.current_position;
-    k_mutex_unlock(&m_stats_lock);
-    return val;
-
+    struct motor_stats snap;
+    _motor_read(&snap);
+    return snap.current_position;
 }
 
 uint8_t motor_get_target_state(void){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
-    uint8_t val = m_stats.target_state;
-    k_mutex_unlock(&m_stats_lock);
-    return val;
+    struct motor_stats snap;
+    _motor_read(&snap);
+    return snap.target_state;
 }
 
 int32_t motor_get_target_speed(void){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
-    int32_t val = m_stats.target_speed;
-    k_mutex_unlock(&m_stats_lock);
-    return val;
+    struct motor_stats snap;
+    _motor_read(&snap);
+    return snap.target_speed;
 }
 
 int32_t motor_get_target_position(void){
-    k_mutex_lock(&m_stats_lock, K_FOREVER);
-    int32_t val = m_stats.target_position;
-    k_mutex_unlock(&m_stats_lock);
-    return val;
-}
\ No newline at end of file
+    struct motor_stats snap;
+    _motor_read(&snap);
+    return snap.target_position;
+}
+
+#ifdef CONFIG_MOTOR_VAULT_STATS
+void motor_get_vault_stats(struct motor_vault_stats *out){
+    k_spinlock_key_t key = k_spin_lock(&m_stats_lock);
+    *out = m_vault_stats;
+    k_spin_unlock(&m_stats_lock, key);
+}
+#endif
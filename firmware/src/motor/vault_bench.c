@@ -0,0 +1,148 @@
+#include "motor.h"
+#include "bench_clock.h"
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <string.h>
+#include <stdbool.h>
+
+/* ========================================================================= *
+ * STATS VAULT BENCH (CONFIG_MOTOR_VAULT_BENCH)                              *
+ * ========================================================================= *
+ * Prices one control tick's vault traffic both ways, uncontended:          *
+ *                                                                           *
+ *   mutex  a copy of the vault as it was before the seqcount, one k_mutex *
+ *          round-trip per field: the PID tick's motor_set_speed(),         *
+ *          motor_set_filtered_speed(), motor_get_target_state() and        *
+ *          motor_get_target_speed(), then pack_telemetry()'s status, speed *
+ *          and position getters. 7 lock round-trips per tick.             *
+ *   seq    this vault: motor_publish_feedback() and motor_get_snapshot()  *
+ *          for the PID tick, one more snapshot for the telemetry packet.  *
+ *          1 spinlock section per tick, the reads take no lock.           *
+ *                                                                           *
+ * Each path also reads back what it wrote; a mismatch fails the bench.    *
+ * Uncontended is the floor for the mutex: a BLE reader holding it when    *
+ * the PID thread arrives adds two context switches on top.                *
+ * Timing from bench_clock_get(): CPU cycles on target, host ns on         *
+ * native_sim. On a host an uncontended lock is one atomic instruction, so *
+ * there the mutex vault can come out ahead; the target figure is the one  *
+ * that matters.                                                            */
+
+#define VAULTB_TICKS        2000
+#define VAULTB_MUTEX_LOCKS  7
+#define VAULTB_SEQ_WRITES   1
+#define VAULTB_SEQ_READS    2
+
+/* ── The old mutex vault, as far as one tick touches it ─────────────────── */
+
+static struct motor_stats b_stats;
+static struct k_mutex     b_lock;
+
+static void b_set_speed(int32_t rpm){
+    k_mutex_lock(&b_lock, K_FOREVER);
+    b_stats.current_speed = rpm;
+    b_stats.motor_status  = (b_stats.motor_status & MOTOR_FLAG_MASK) | MOTOR_STATE_RUNNING_SPEED;
+    k_mutex_unlock(&b_lock);
+}
+
+static void b_set_filtered_speed(int32_t rpm){
+    k_mutex_lock(&b_lock, K_FOREVER);
+    b_stats.filtered_speed = rpm;
+    k_mutex_unlock(&b_lock);
+}
+
+static uint8_t b_get_target_state(void){
+    k_mutex_lock(&b_lock, K_FOREVER);
+    uint8_t val = b_stats.target_state;
+    k_mutex_unlock(&b_lock);
+    return val;
+}
+
+static int32_t b_get_target_speed(void){
+    k_mutex_lock(&b_lock, K_FOREVER);
+    int32_t val = b_stats.target_speed;
+    k_mutex_unlock(&b_lock);
+    return val;
+}
+
+static uint8_t b_get_full_status(void){
+    k_mutex_lock(&b_lock, K_FOREVER);
+    uint8_t val = b_stats.motor_status;
+    k_mutex_unlock(&b_lock);
+    return val;
+}
+
+static int32_t b_get_speed(void){
+    k_mutex_lock(&b_lock, K_FOREVER);
+    int32_t val = b_stats.current_speed;
+    k_mutex_unlock(&b_lock);
+    return val;
+}
+
+static int32_t b_get_position(void){
+    k_mutex_lock(&b_lock, K_FOREVER);
+    int32_t val = b_stats.current_position;
+    k_mutex_unlock(&b_lock);
+    return val;
+}
+
+/* ── Bench ─────────────────────────────────────────────────────────────── */
+
+int motor_vault_bench(void)
+{
+    uint32_t bad = 0;
+
+    k_mutex_init(&b_lock);
+    memset(&b_stats, 0, sizeof(b_stats));
+    b_stats.target_state = MOTOR_STATE_RUNNING_SPEED;
+    b_stats.target_speed = 3000;
+
+    motor_init();
+    motor_set_target_speed(3000);
+
+    /* ── Mutex vault ───────────────────────────────────────────────────── */
+    uint32_t t0 = bench_clock_get();
+    for (int32_t n = 0; n < VAULTB_TICKS; n++) {
+        b_set_speed(n);
+        b_set_filtered_speed(n);
+        uint8_t state = b_get_target_state();
+        int32_t rpm   = b_get_target_speed();
+
+        uint8_t status = b_get_full_status();
+        int32_t speed  = b_get_speed();
+        (void)b_get_position();
+
+        bad += (state != MOTOR_STATE_RUNNING_SPEED || rpm != 3000 ||
+                (status & MOTOR_STATE_MASK) != MOTOR_STATE_RUNNING_SPEED ||
+                speed != n) ? 1 : 0;
+    }
+    uint32_t t1 = bench_clock_get();
+
+    /* ── Seqcount vault ────────────────────────────────────────────────── */
+    for (int32_t n = 0; n < VAULTB_TICKS; n++) {
+        struct motor_stats snap;
+        motor_publish_feedback(MOTOR_STATE_RUNNING_SPEED, n, n, n % 360);
+        motor_get_snapshot(&snap);
+
+        struct motor_stats tlm;
+        motor_get_snapshot(&tlm);
+
+        bad += (snap.target_state != MOTOR_STATE_RUNNING_SPEED ||
+                snap.target_speed != 3000 ||
+                (tlm.motor_status & MOTOR_STATE_MASK) != MOTOR_STATE_RUNNING_SPEED ||
+                tlm.current_speed != n) ? 1 : 0;
+    }
+    uint32_t t2 = bench_clock_get();
+
+    // LEAVE THE VAULT AS BOOT FOUND IT
+    motor_init();
+
+    bool pass = (bad == 0);
+    printk("VAULT {\"ticks\":%d,\"mutex_locks\":%d,\"mutex_" BENCH_CLOCK_UNIT "\":%u,"
+           "\"seq_writes\":%d,\"seq_reads\":%d,\"seq_" BENCH_CLOCK_UNIT "\":%u,"
+           "\"pass\":%s}\n",
+           VAULTB_TICKS, VAULTB_MUTEX_LOCKS, (t1 - t0) / VAULTB_TICKS,
+           VAULTB_SEQ_WRITES, VAULTB_SEQ_READS, (t2 - t1) / VAULTB_TICKS,
+           pass ? "true" : "false");
+
+    return pass ? 0 : -1;
+}
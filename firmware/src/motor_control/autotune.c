@@ -0,0 +1,314 @@
+#include "autotune.h"
+#include "seqcount.h"
+#include <math.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(autotune, LOG_LEVEL_INF);
+
+/* ========================================================================= *
+ * CONFIGURATION                                                             *
+ * ========================================================================= *
+ * d sets both the step and the relay amplitude: large enough that the     *
+ * limit cycle stands well clear of the hall estimate's jitter, small      *
+ * enough to stay inside the plant's affine range around the operating    *
+ * point. eps sits just above that jitter so noise cannot chatter the      *
+ * relay.                                                                   */
+#define AT_RELAY_PCT        3.0f        // d, % duty
+#define AT_HYST_RPM         15.0f       // eps
+#define AT_SETTLE_BAND_PCT  3           // of rpm, never below AT_SETTLE_BAND_MIN
+#define AT_SETTLE_BAND_MIN  20
+#define AT_SETTLE_S         0.5f        // continuous time in band before sampling
+#define AT_AVG_S            0.3f        // averaging window for u0 / w0 / w1
+#define AT_SETTLE_MAX_S     5.0f
+#define AT_STEP_S           1.0f        // open-loop step, averaging at the end
+#define AT_RELAY_SKIP       2           // cycles discarded while the cycle forms
+#define AT_RELAY_CYCLES     4           // cycles averaged
+#define AT_RELAY_MAX_S      4.0f
+
+#define AT_PI               3.14159265f
+
+enum at_phase {
+    AT_PHASE_SETTLE,
+    AT_PHASE_STEP,
+    AT_PHASE_RELAY,
+};
+
+/* ========================================================================= *
+ * STATE                                                                     *
+ * ========================================================================= */
+static uint8_t  at_status;          // enum autotune_status, PID thread only
+static uint8_t  at_phase;           // enum at_phase
+static int32_t  at_rpm;
+static float    at_t;               // time in the current phase, s
+static float    at_band_t;          // SETTLE: continuous time in band, s
+static float    at_sum_u, at_sum_w, at_sum_t;   // running means
+
+static float    at_u0, at_w0;
+
+static bool     at_high;            // RELAY: output at u0 + d
+static float    at_cycle_t;         // time since the last upward switch, s
+static float    at_cycle_max, at_cycle_min;
+static int      at_cycles;          // upward switches seen
+static float    at_sum_tu, at_sum_pp;
+
+static struct autotune_result at_work;        // PID thread's copy, filled in by the phases
+static struct autotune_result at_res;         // published copy, under at_res_seq
+static seqcount_t             at_res_seq = SEQCOUNT_INIT;
+
+/* ========================================================================= *
+ * HELPERS                                                                   *
+ * ========================================================================= */
+/** @brief Publish a result to readers on other threads. */
+static void at_publish(const struct autotune_result *r)
+{
+    seqcount_write_begin(&at_res_seq);
+    at_res = *r;
+    seqcount_write_end(&at_res_seq);
+}
+
+static void at_mean_reset(void)
+{
+    at_sum_u = 0.0f;
+    at_sum_w = 0.0f;
+    at_sum_t = 0.0f;
+}
+
+static void at_mean_add(float u, float w, float dt)
+{
+    at_sum_u += u * dt;
+    at_sum_w += w * dt;
+    at_sum_t += dt;
+}
+
+static void at_finish(uint8_t error)
+{
+    struct autotune_result *r = &at_work;
+    r->run++;
+    r->status = (error == AUTOTUNE_OK) ? AUTOTUNE_DONE : AUTOTUNE_FAILED;
+    r->error  = error;
+    at_status = r->status;
+    at_publish(r);
+
+    if (error == AUTOTUNE_OK) {
+        LOG_INF("Autotune @%d rpm: K=%.1f rpm/%%  T=%.3fs  L=%.3fs  "
+                "Ku=%.4f  Tu=%.3fs  -> kp=%.4f  ki=%.4f  ff=%.5f%+.2f",
+                r->rpm, (double)r->k_rpm_pct, (double)r->tau_s, (double)r->dead_s,
+                (double)r->ku, (double)r->tu_s, (double)r->kp, (double)r->ki,
+                (double)r->ff_gain, (double)r->ff_offset);
+    } else {
+        LOG_WRN("Autotune @%d rpm failed: error %u", r->rpm, error);
+    }
+}
+
+/** @brief FOPDT fit and SIMC PI from the STEP and RELAY measurements. */
+static void at_identify(void)
+{
+    struct autotune_result *r = &at_work;
+
+    float tu  = at_sum_tu / (float)AT_RELAY_CYCLES;
+    float amp = at_sum_pp / (2.0f * (float)AT_RELAY_CYCLES);
+
+    r->cycles  = AT_RELAY_CYCLES;
+    r->tu_s    = tu;
+    r->amp_rpm = amp;
+
+    if (amp <= AT_HYST_RPM) {
+        at_finish(AUTOTUNE_ERR_RELAY);
+        return;
+    }
+    r->ku = 4.0f * AT_RELAY_PCT /
+            (AT_PI * sqrtf(amp * amp - AT_HYST_RPM * AT_HYST_RPM));
+
+    /* |G(jωu)| = K / sqrt(1 + (ωu·T)²) = 1/Ku  and
+     * arg G(jωu) = −atan(ωu·T) − ωu·L = −π                              */
+    float kk = r->k_rpm_pct * r->ku;
+    if (kk <= 1.0f) {
+        at_finish(AUTOTUNE_ERR_MODEL);
+        return;
+    }
+    float wu = 2.0f * AT_PI / tu;
+    r->tau_s  = sqrtf(kk * kk - 1.0f) / wu;
+    r->dead_s = (AT_PI - atanf(wu * r->tau_s)) / wu;
+
+    /* SIMC PI, tau_c = L */
+    float tc = r->dead_s;
+    float ti = fminf(r->tau_s, 4.0f * (tc + r->dead_s));
+    r->kp = r->tau_s / (r->k_rpm_pct * (tc + r->dead_s));
+    r->ki = r->kp / ti;
+
+    r->ff_gain   = 1.0f / r->k_rpm_pct;
+    r->ff_offset = r->u0_pct - (float)r->rpm * r->ff_gain;
+
+    at_finish(AUTOTUNE_OK);
+}
+
+/* ========================================================================= *
+ * PHASES                                                                    *
+ * ========================================================================= */
+static void at_settle(int32_t speed, float duty, float dt)
+{
+    int32_t band = MAX(at_rpm * AT_SETTLE_BAND_PCT / 100, AT_SETTLE_BAND_MIN);
+    int32_t err  = speed - at_rpm;
+
+    if (err > band || err < -band) {
+        at_band_t = 0.0f;
+        at_mean_reset();
+    } else {
+        at_band_t += dt;
+        if (at_band_t > AT_SETTLE_S) {
+            at_mean_add(duty, (float)speed, dt);
+        }
+    }
+
+    if (at_sum_t >= AT_AVG_S) {
+        at_u0 = at_sum_u / at_sum_t;
+        at_w0 = at_sum_w / at_sum_t;
+        at_work.u0_pct = at_u0;
+        at_phase = AT_PHASE_STEP;
+        at_t     = 0.0f;
+        at_mean_reset();
+    } else if (at_t > AT_SETTLE_MAX_S) {
+        at_finish(AUTOTUNE_ERR_SETTLE);
+    }
+}
+
+static float at_step(int32_t speed, float dt)
+{
+    float u = at_u0 + AT_RELAY_PCT;
+
+    if (at_t > AT_STEP_S - AT_AVG_S) {
+        at_mean_add(u, (float)speed, dt);
+    }
+    if (at_t >= AT_STEP_S) {
+        float w1 = at_sum_w / at_sum_t;
+        at_work.k_rpm_pct = (w1 - at_w0) / AT_RELAY_PCT;
+        if (at_work.k_rpm_pct <= 0.0f) {
+            at_finish(AUTOTUNE_ERR_GAIN);
+            return at_u0;
+        }
+
+        // Speed is above rpm now, so the relay starts low
+        at_phase     = AT_PHASE_RELAY;
+        at_t         = 0.0f;
+        at_high      = false;
+        at_cycles    = 0;
+        at_sum_tu    = 0.0f;
+        at_sum_pp    = 0.0f;
+        at_cycle_t   = 0.0f;
+        at_cycle_max = (float)speed;
+        at_cycle_min = (float)speed;
+        return at_u0 - AT_RELAY_PCT;
+    }
+    return u;
+}
+
+static float at_relay(int32_t speed, float dt)
+{
+    float w = (float)speed;
+
+    at_cycle_t  += dt;
+    at_cycle_max = fmaxf(at_cycle_max, w);
+    at_cycle_min = fminf(at_cycle_min, w);
+
+    if (!at_high && w < (float)at_rpm - AT_HYST_RPM) {
+        /* Upward switch: one full cycle since the previous one */
+        at_high = true;
+        if (at_cycles > AT_RELAY_SKIP) {
+            at_sum_tu += at_cycle_t;
+            at_sum_pp += at_cycle_max - at_cycle_min;
+        }
+        at_cycles++;
+        at_cycle_t   = 0.0f;
+        at_cycle_max = w;
+        at_cycle_min = w;
+
+        if (at_cycles > AT_RELAY_SKIP + AT_RELAY_CYCLES) {
+            at_identify();
+            return at_u0;
+        }
+    } else if (at_high && w > (float)at_rpm + AT_HYST_RPM) {
+        at_high = false;
+    }
+
+    if (at_t > AT_RELAY_MAX_S) {
+        at_finish(AUTOTUNE_ERR_RELAY);
+        return at_u0;
+    }
+    return at_high ? at_u0 + AT_RELAY_PCT : at_u0 - AT_RELAY_PCT;
+}
+
+/* ========================================================================= *
+ * PUBLIC API                                                                *
+ * ========================================================================= */
+void autotune_start(int32_t rpm)
+{
+    uint16_t run = at_work.run;
+
+    memset(&at_work, 0, sizeof(at_work));
+    at_work.run    = run + 1;
+    at_work.status = AUTOTUNE_RUNNING;
+    at_work.rpm    = rpm;
+
+    at_status = AUTOTUNE_RUNNING;
+    at_phase  = AT_PHASE_SETTLE;
+    at_rpm    = rpm;
+    at_t      = 0.0f;
+    at_band_t = 0.0f;
+    at_mean_reset();
+
+    at_publish(&at_work);
+    LOG_INF("Autotune START — %d rpm, relay ±%.1f%%", rpm, (double)AT_RELAY_PCT);
+}
+
+void autotune_abort(void)
+{
+    if (at_status == AUTOTUNE_RUNNING) {
+        at_finish(AUTOTUNE_ERR_ABORTED);
+    }
+}
+
+bool autotune_pid_holds(void)
+{
+    return at_status != AUTOTUNE_RUNNING || at_phase == AT_PHASE_SETTLE;
+}
+
+float autotune_step(int32_t speed_rpm, float duty_pct, float dt)
+{
+    if (at_status != AUTOTUNE_RUNNING) {
+        return duty_pct;
+    }
+
+    at_t += dt;
+    switch (at_phase) {
+        case AT_PHASE_SETTLE:
+            at_settle(speed_rpm, duty_pct, dt);
+            return duty_pct;
+        case AT_PHASE_STEP:
+            return at_step(speed_rpm, dt);
+        default:
+            return at_relay(speed_rpm, dt);
+    }
+}
+
+uint8_t autotune_get_status(void)
+{
+    return at_status;
+}
+
+void autotune_get_result(struct autotune_result *out)
+{
+    uint32_t seq;
+    do {
+        seq = seqcount_read_begin(&at_res_seq);
+        *out = at_res;
+    } while (seqcount_read_retry(&at_res_seq, seq));
+}
+
+void autotune_reset(void)
+{
+    memset(&at_work, 0, sizeof(at_work));
+    at_status = AUTOTUNE_IDLE;
+    at_publish(&at_work);
+}
@@ -1,4 +1,11 @@
 #include "bldc_driver.h"
+#include "bldc_commutation.h"
+#include "bldc_hall.h"
+#include "prof.h"
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+#include "speed_fast.h"
+#endif
+#include "trace.h"
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/sys/atomic.h>
@@ -6,7 +13,12 @@
 #include <stm32_ll_tim.h>
 #include <stm32_ll_bus.h>
 #include <stm32_ll_rcc.h>
+#include <stm32_ll_gpio.h>
+#ifdef CONFIG_MOTOR_HALL_DIRECT_IRQ
+#include <stm32_ll_exti.h>
+#endif
 #include <zephyr/logging/log.h>
+#include <stddef.h>
 
 LOG_MODULE_REGISTER(bldc_driver, LOG_LEVEL_INF);
 
@@ -15,65 +27,55 @@ LOG_MODULE_REGISTER(bldc_driver, LOG_LEVEL_INF);
  * ========================================================================= */
 
 // STM32WB55 @ 64MHz, APB2 prescaler=1 → TIM1 = 64MHz
-#define TIM1_ARR            3200        // 64MHz / 3200 = 20kHz PWM
+#define TIM1_ARR            BLDC_TIM1_ARR   // 64MHz / 3200 = 20kHz PWM
 #define DEADTIME_TICKS      50          // 50/64MHz = 781ns
 
 /* ── Pole pairs ────────────────────────────────────────────────────────────
  * Motor spec says "8 poles" = 4 pole pairs (N+S = 1 pair).
  * edges_per_rev = POLE_PAIRS * 6 = 24
- * Confirmed: partner's RPM_CONSTANT_FILTERED=15,000,000 at 1MHz TIM2
- * corresponds to 24 edges/rev (4 pole pairs).                             */
-#define POLE_PAIRS          4
-#define EDGES_PER_REV       (POLE_PAIRS * 6)    // = 24
-
-/* ── TIM2 RPM timer ────────────────────────────────────────────────────────
- * TIM2 free-running at 1MHz (prescaler = 64-1 = 63 for 64MHz APB1).
- * Same approach as partner's working code — cleaner than CPU cycle counter.
- * dt measured in microseconds directly.
- *
- * RPM calculation with 6-sample circular buffer (smoothing):
- *   sum_6 = sum of 6 consecutive inter-edge times in µs
- *   RPM = (60 * 1,000,000 * 6) / (sum_6 * EDGES_PER_REV)
- *       = 360,000,000 / (sum_6 * 24)
- *       = 15,000,000 / sum_6
- *
- * Single-edge (instantaneous) formula:
- *   RPM = (60 * 1,000,000) / (dt_us * EDGES_PER_REV)
- *       = 60,000,000 / (dt_us * 24)
- *       = 2,500,000 / dt_us                                              */
-#define TIM2_PRESCALER      63          // 64MHz / (63+1) = 1MHz
-#define RPM_CONSTANT        2500000UL   // single-edge: 60e6 / EDGES_PER_REV
-#define RPM_CONSTANT_FILT   15000000UL  // 6-sample buffer: RPM_CONSTANT * 6
-#define RPM_HISTORY_SIZE    6
-#define RPM_TIMEOUT_US      2000000UL   // 2 seconds → rpm = 0 (stopped)
+ * POLE_PAIRS / EDGES_PER_REV live in bldc_driver.h (shared with the sim);
+ * RPM, debounce and softstart constants live with the edge logic in
+ * bldc_hall.c.                                                            */
 
-/* ── Debounce ──────────────────────────────────────────────────────────────
- * At 3000 RPM with 24 edges/rev: edge every 833µs → use 50µs debounce.
- * 5000µs for bench/hand testing.                                          */
-#define HALL_DEBOUNCE_US    50
+/* ── TIM2 time base ────────────────────────────────────────────────────────
+ * TIM2 free-running at 1MHz (prescaler = 64-1 = 63 for 64MHz APB1) is the
+ * bldc_hall_now_us() clock: hall dt, hall age and position interpolation. */
+#define TIM2_PRESCALER      63          // 64MHz / (63+1) = 1MHz
 
 /* ── Duty cycle constants ───────────────────────────────────────────────── */
 #define BOOTSTRAP_DUTY      ((TIM1_ARR * 95) / 100)   // 3040 counts
-#define SOFTSTART_DUTY      ((TIM1_ARR * 10) / 100)   //  320 counts — 10%
-#define SOFTSTART_STEP      ((TIM1_ARR *  1) / 100)   //   32 counts/edge — 1%
-#define SOFTSTART_END_PCT   15.0f                       // PID takes over above 15%
+
+/* ── Fast speed loop trigger ───────────────────────────────────────────────
+ * Below the hall EXTI lines, so an edge can preempt a speed-loop tick.   */
+#define TIM1_UP_IRQ_PRIO    2
+
+/* ── Direct hall interrupt ─────────────────────────────────────────────────
+ * Highest kernel-aware priority rather than a zero-latency IRQ: the edge
+ * core shares irq_lock() sections with thread-side commutation, the trace
+ * ring and the profiler, and a zero-latency ISR would run inside them.   */
+#define HALL_DIRECT_IRQ_PRIO 0
+
+/* ── Advanced commutation timer ────────────────────────────────────────────
+ * TIM2 CH3 compare, no pin. At the hall lines' priority: the advanced
+ * step and the edge that would otherwise make it must not preempt each
+ * other halfway through the edge core.                                   */
+#define TIM2_CC_IRQ_PRIO    0
 
 /* ========================================================================= *
  * COMMUTATION LOOKUP TABLES                                                 *
  * ========================================================================= *
- * Confirmed by observation: direct mapping (case==state) = CCW.
- * CCW sequence: 6→4→5→1→3→2→(repeat)
- *
- * Pin → TIM1 channel:
- *   PA8 /CH1  = U+   PB13/CH1N = U-
- *   PA9 /CH2  = V+   PB14/CH2N = V-
- *   PA10/CH3  = W+   PB15/CH3N = W-
- *
- * CW = swap + and - on every pair (reverse current direction):
- *   0x1→case6  0x2→case5  0x3→case4
- *   0x4→case3  0x5→case2  0x6→case1                                      */
-static const uint8_t cw_commutation[8]  = { 0, 6, 5, 4, 3, 2, 1, 0 };
-static const uint8_t ccw_commutation[8] = { 0, 1, 2, 3, 4, 5, 6, 0 };
+ * bldc_comm_table[][] lives in bldc_commutation.h (shared with the sim).   *
+ * Its CCER bits and CCR indexing must match the real TIM1 layout.         */
+BUILD_ASSERT(BLDC_CCER_HI(BLDC_PHASE_U) == TIM_CCER_CC1E &&
+             BLDC_CCER_LO(BLDC_PHASE_U) == TIM_CCER_CC1NE &&
+             BLDC_CCER_HI(BLDC_PHASE_V) == TIM_CCER_CC2E &&
+             BLDC_CCER_LO(BLDC_PHASE_V) == TIM_CCER_CC2NE &&
+             BLDC_CCER_HI(BLDC_PHASE_W) == TIM_CCER_CC3E &&
+             BLDC_CCER_LO(BLDC_PHASE_W) == TIM_CCER_CC3NE,
+             "bldc_comm_table CCER bits do not match TIM1");
+BUILD_ASSERT(offsetof(TIM_TypeDef, CCR2) == offsetof(TIM_TypeDef, CCR1) + 4 &&
+             offsetof(TIM_TypeDef, CCR3) == offsetof(TIM_TypeDef, CCR1) + 8,
+             "TIM1 CCR1..3 must be contiguous for table indexing");
 
 /* ========================================================================= *
  * GPIO DEFINITIONS                                                          *
@@ -82,28 +84,57 @@ static const struct gpio_dt_spec hall_u = GPIO_DT_SPEC_GET(DT_ALIAS(hall_u), gpi
 static const struct gpio_dt_spec hall_v = GPIO_DT_SPEC_GET(DT_ALIAS(hall_v), gpios);
 static const struct gpio_dt_spec hall_w = GPIO_DT_SPEC_GET(DT_ALIAS(hall_w), gpios);
 
+#define HALL_PORT(a)        ((GPIO_TypeDef *)DT_REG_ADDR(DT_GPIO_CTLR(DT_ALIAS(a), gpios)))
+#define HALL_PIN(a)         DT_GPIO_PIN(DT_ALIAS(a), gpios)
+#define HALL_SAME_PORT(a, b) \
+    DT_SAME_NODE(DT_GPIO_CTLR(DT_ALIAS(a), gpios), DT_GPIO_CTLR(DT_ALIAS(b), gpios))
+// bldc_read_hall_state() inverts the logical level; on the raw IDR bit that
+// is an XOR with 1 for an active-high pin and a pass-through for active-low
+#define HALL_XOR(a)         ((DT_GPIO_FLAGS(DT_ALIAS(a), gpios) & GPIO_ACTIVE_LOW) ? 0 : 1)
+
+/* ── Edge-to-commutation latency ───────────────────────────────────────────
+ * PA1 doubles as TIM2_CH2 (AF1). With hall W there, TIM2 captures every W
+ * edge in hardware on the same 1MHz clock as bldc_hall_now_us(), and the
+ * ISR compares it with the TIM2 count right after the commutation write.
+ * One edge in three is measured; EXTI still sees the pin in AF mode. The
+ * edges are asynchronous to TIM2, so the 1us steps average out.          */
+#define HALL_LATENCY_CAPTURE \
+    (IS_ENABLED(CONFIG_MOTOR_PROF) && \
+     DT_SAME_NODE(DT_GPIO_CTLR(DT_ALIAS(hall_w), gpios), DT_NODELABEL(gpioa)) && \
+     HALL_PIN(hall_w) == 1)
+#define HALL_CAPTURE_AF     LL_GPIO_AF_1
+
 /* ========================================================================= *
  * ISR / RUNTIME STATE                                                       *
  * ========================================================================= */
+#ifdef CONFIG_MOTOR_HALL_DIRECT_IRQ
+void hall_direct_isr(void);             // ISR_DIRECT_DECLARE, below
+
+#define HALL_EXTI_MASK      (BIT(HALL_PIN(hall_u)) | BIT(HALL_PIN(hall_v)) | \
+                             BIT(HALL_PIN(hall_w)))
+// EXTI0..4 each have their own vector, consecutive on the STM32WB
+#define HALL_EXTI_IRQN(a)   (EXTI0_IRQn + HALL_PIN(a))
+BUILD_ASSERT(HALL_PIN(hall_u) <= 4 && HALL_PIN(hall_v) <= 4 && HALL_PIN(hall_w) <= 4 &&
+             HALL_PIN(hall_u) != HALL_PIN(hall_v) && HALL_PIN(hall_u) != HALL_PIN(hall_w) &&
+             HALL_PIN(hall_v) != HALL_PIN(hall_w),
+             "direct hall IRQ needs the hall pins on distinct EXTI lines 0-4");
+#else
 static struct gpio_callback hall_u_cb;
 static struct gpio_callback hall_v_cb;
 static struct gpio_callback hall_w_cb;
 
-atomic_t g_motor_speed_atomic = ATOMIC_INIT(0);
-
-/* ── TIM2-based RPM measurement ─────────────────────────────────────────── */
-static volatile uint32_t rpm_history[RPM_HISTORY_SIZE];
-static volatile uint8_t  rpm_idx         = 0;
-static volatile uint32_t rpm_prev_ticks  = 0;
-static volatile uint32_t rpm_last_edge   = 0;  // TIM2 tick of last valid edge
-
-/* ── Motor control state ─────────────────────────────────────────────────── */
-static volatile int  current_direction_ccw = 0;
-static volatile bool motor_running         = false;
-static volatile int  softstart_pulse       = SOFTSTART_DUTY;
-
 static void hall_isr_callback(const struct device *dev,
                                struct gpio_callback *cb, uint32_t pins);
+#endif
+
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+static void tim2_cc_isr(const void *arg);
+#endif
+
+#if HALL_LATENCY_CAPTURE
+static volatile uint32_t hall_comm_us;      // TIM2 right after the last commutation
+static volatile uint32_t hall_comm_seq;     // bumped with it
+#endif
 
 /* ========================================================================= *
  * TIM2 INIT — free-running 1MHz counter                                   *
@@ -114,12 +145,66 @@ static void tim2_init(void)
 
     LL_TIM_SetPrescaler(TIM2, TIM2_PRESCALER);  // 64MHz / 64 = 1MHz
     LL_TIM_SetAutoReload(TIM2, 0xFFFFFFFF);     // 32-bit free-run
+#if HALL_LATENCY_CAPTURE
+    LL_TIM_IC_SetActiveInput(TIM2, LL_TIM_CHANNEL_CH2, LL_TIM_ACTIVEINPUT_DIRECTTI);
+    LL_TIM_IC_SetPrescaler(TIM2, LL_TIM_CHANNEL_CH2, LL_TIM_ICPSC_DIV1);
+    LL_TIM_IC_SetPolarity(TIM2, LL_TIM_CHANNEL_CH2, LL_TIM_IC_POLARITY_BOTHEDGE);
+    LL_TIM_CC_EnableChannel(TIM2, LL_TIM_CHANNEL_CH2);
+#endif
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+    // CH3 compare only sets CC3IF; the channel output stays disabled
+    LL_TIM_OC_SetMode(TIM2, LL_TIM_CHANNEL_CH3, LL_TIM_OCMODE_FROZEN);
+#endif
     LL_TIM_GenerateEvent_UPDATE(TIM2);          // latch prescaler
     LL_TIM_EnableCounter(TIM2);
 
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+    LL_TIM_ClearFlag_CC3(TIM2);
+    IRQ_CONNECT(TIM2_IRQn, TIM2_CC_IRQ_PRIO, tim2_cc_isr, NULL, 0);
+    irq_enable(TIM2_IRQn);
+#endif
+
     LOG_INF("TIM2 running at 1MHz for RPM measurement");
 }
 
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+/* ========================================================================= *
+ * FAST SPEED LOOP TRIGGER — TIM1 update, divided in software               *
+ * ========================================================================= *
+ * The update interrupt fires on every counter overflow (20kHz) and runs   *
+ * speed_fast_tick() on every SPEED_FAST_DIV-th. The repetition counter    *
+ * cannot do the division: each commutation issues UG, which reloads RCR, *
+ * so once edges come faster than the fast period it would never expire.  *
+ * URS = counter overflow only keeps those UG events off the interrupt;   *
+ * the period they cut short just stretches one tick by < 50us.           */
+static uint8_t tim1_up_div;
+
+static void tim1_up_isr(const void *arg)
+{
+    ARG_UNUSED(arg);
+
+    LL_TIM_ClearFlag_UPDATE(TIM1);
+    if (++tim1_up_div < SPEED_FAST_DIV) {
+        return;
+    }
+    tim1_up_div = 0;
+    speed_fast_tick();
+}
+
+static void tim1_fast_loop_init(void)
+{
+    LL_TIM_SetUpdateSource(TIM1, LL_TIM_UPDATESOURCE_COUNTER);
+    LL_TIM_ClearFlag_UPDATE(TIM1);
+
+    IRQ_CONNECT(TIM1_UP_TIM16_IRQn, TIM1_UP_IRQ_PRIO, tim1_up_isr, NULL, 0);
+    irq_enable(TIM1_UP_TIM16_IRQn);
+    LL_TIM_EnableIT_UPDATE(TIM1);
+
+    LOG_INF("Fast speed loop: TIM1 update / %u = %uHz", SPEED_FAST_DIV,
+            SPEED_FAST_RATE_HZ);
+}
+#endif
+
 /* ========================================================================= *
  * INITIALIZATION                                                            *
  * ========================================================================= */
@@ -137,6 +222,11 @@ int bldc_driver_init(void)
     gpio_pin_configure_dt(&hall_u, GPIO_INPUT | GPIO_PULL_UP);
     gpio_pin_configure_dt(&hall_v, GPIO_INPUT | GPIO_PULL_UP);
     gpio_pin_configure_dt(&hall_w, GPIO_INPUT | GPIO_PULL_UP);
+#if HALL_LATENCY_CAPTURE
+    // Input + pull-up as above, routed to TIM2_CH2 as well
+    LL_GPIO_SetAFPin_0_7(HALL_PORT(hall_w), BIT(HALL_PIN(hall_w)), HALL_CAPTURE_AF);
+    LL_GPIO_SetPinMode(HALL_PORT(hall_w), BIT(HALL_PIN(hall_w)), LL_GPIO_MODE_ALTERNATE);
+#endif
 
     int boot_state = bldc_read_hall_state();
     LOG_INF("Boot hall state: 0x%X  %s", boot_state,
@@ -145,11 +235,7 @@ int bldc_driver_init(void)
 
     /* ── TIM2 for RPM ───────────────────────────────────────────────────── */
     tim2_init();
-    rpm_prev_ticks = TIM2->CNT;
-    rpm_last_edge  = TIM2->CNT;
-    for (int i = 0; i < RPM_HISTORY_SIZE; i++) {
-        rpm_history[i] = 0;
-    }
+    bldc_hall_init(boot_state);
 
     /* ── TIM1 PWM ───────────────────────────────────────────────────────── */
     LL_APB2_GRP1_EnableClock(LL_APB2_GRP1_PERIPH_TIM1);
@@ -168,6 +254,17 @@ int bldc_driver_init(void)
     LL_TIM_SetOffStates(TIM1, LL_TIM_OSSI_ENABLE, LL_TIM_OSSR_ENABLE);
     LL_TIM_OC_SetDeadTime(TIM1, DEADTIME_TICKS);
 
+#ifdef CONFIG_MOTOR_ESTOP_BREAK
+    /* Break armed for the software trigger only: no BKIN pin is routed,
+     * so take it off the break input and make it active-high, leaving an
+     * idle line inactive. AOE stays clear — MOE only comes back through
+     * bldc_estop_release().                                             */
+    LL_TIM_DisableBreakInputSource(TIM1, LL_TIM_BREAK_INPUT_BKIN,
+                                   LL_TIM_BKIN_SOURCE_BKIN);
+    LL_TIM_ConfigBRK(TIM1, LL_TIM_BREAK_POLARITY_HIGH, LL_TIM_BREAK_FILTER_FDIV1);
+    LL_TIM_EnableBRK(TIM1);
+#endif
+
     TIM1->CCR1 = 0;
     TIM1->CCR2 = 0;
     TIM1->CCR3 = 0;
@@ -178,11 +275,26 @@ int bldc_driver_init(void)
 
     bldc_set_bootstrap();
 
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+    tim1_fast_loop_init();
+#endif
+
     /* ── Hall interrupts ────────────────────────────────────────────────── */
     gpio_pin_interrupt_configure_dt(&hall_u, GPIO_INT_EDGE_BOTH);
     gpio_pin_interrupt_configure_dt(&hall_v, GPIO_INT_EDGE_BOTH);
     gpio_pin_interrupt_configure_dt(&hall_w, GPIO_INT_EDGE_BOTH);
 
+#ifdef CONFIG_MOTOR_HALL_DIRECT_IRQ
+    /* The GPIO driver has routed and armed the EXTI lines; the vectors now
+     * go straight to hall_direct_isr() instead of its dispatcher.        */
+    IRQ_DIRECT_CONNECT(HALL_EXTI_IRQN(hall_u), HALL_DIRECT_IRQ_PRIO, hall_direct_isr, 0);
+    IRQ_DIRECT_CONNECT(HALL_EXTI_IRQN(hall_v), HALL_DIRECT_IRQ_PRIO, hall_direct_isr, 0);
+    IRQ_DIRECT_CONNECT(HALL_EXTI_IRQN(hall_w), HALL_DIRECT_IRQ_PRIO, hall_direct_isr, 0);
+    irq_enable(HALL_EXTI_IRQN(hall_u));
+    irq_enable(HALL_EXTI_IRQN(hall_v));
+    irq_enable(HALL_EXTI_IRQN(hall_w));
+    LOG_INF("Hall edges on direct EXTI vectors");
+#else
     gpio_init_callback(&hall_u_cb, hall_isr_callback, BIT(hall_u.pin));
     gpio_init_callback(&hall_v_cb, hall_isr_callback, BIT(hall_v.pin));
     gpio_init_callback(&hall_w_cb, hall_isr_callback, BIT(hall_w.pin));
@@ -190,6 +302,7 @@ int bldc_driver_init(void)
     gpio_add_callback_dt(&hall_u, &hall_u_cb);
     gpio_add_callback_dt(&hall_v, &hall_v_cb);
     gpio_add_callback_dt(&hall_w, &hall_w_cb);
+#endif
 
     LOG_INF("BLDC ready — 20kHz PWM  781ns dead-time  4PP  TIM2@1MHz");
     return 0;
@@ -200,13 +313,10 @@ int bldc_driver_init(void)
  * ========================================================================= */
 void bldc_set_bootstrap(void)
 {
-    motor_running   = false;
-    softstart_pulse = SOFTSTART_DUTY;
+    bldc_hall_stop();
 
     unsigned int key = irq_lock();
-    TIM1->CCER &= ~(TIM_CCER_CC1E  | TIM_CCER_CC1NE |
-                    TIM_CCER_CC2E  | TIM_CCER_CC2NE |
-                    TIM_CCER_CC3E  | TIM_CCER_CC3NE);
+    TIM1->CCER &= ~BLDC_CCER_ALL;
     TIM1->CCR1 = BOOTSTRAP_DUTY;
     TIM1->CCR2 = BOOTSTRAP_DUTY;
     TIM1->CCR3 = BOOTSTRAP_DUTY;
@@ -214,88 +324,187 @@ void bldc_set_bootstrap(void)
     LL_TIM_GenerateEvent_UPDATE(TIM1);
     irq_unlock(key);
 
-    atomic_set(&g_motor_speed_atomic, 0);
     LOG_INF("Bootstrap: low-sides active, high-sides off");
 }
 
+#ifdef CONFIG_MOTOR_ESTOP_BREAK
 /* ========================================================================= *
- * MOTOR START                                                               *
- * ========================================================================= */
-void bldc_set_running(void)
+ * EMERGENCY STOP                                                            *
+ * ========================================================================= *
+ * BG is a single write-only store, so there is no read-modify-write for  *
+ * an interrupted context to race. The break clears MOE asynchronously,   *
+ * and with OSSI set every channel goes to its idle level (low: both      *
+ * switches of each leg off) through the dead-time — the same path a      *
+ * hardware fault on BKIN would take. The read-back makes the return the  *
+ * point at which the timer has the outputs off; if the break were ever   *
+ * left unarmed, MOE is cleared by hand instead.                          */
+void bldc_estop(void)
 {
-    softstart_pulse = SOFTSTART_DUTY;
-    motor_running   = true;
-
-    // Seed TIM2 timestamp so hall_age doesn't false-timeout immediately
-    rpm_last_edge = TIM2->CNT;
-
-    uint8_t state = (uint8_t)bldc_read_hall_state();
-    if (state != 0 && state != 7) {
-        bldc_set_commutation_with_duty(state, softstart_pulse);
-        LOG_INF("Motor start: hall=0x%X duty=%d", state, softstart_pulse);
+    LL_TIM_GenerateEvent_BRK(TIM1);
+    if (LL_TIM_IsEnabledAllOutputs(TIM1)) {
+        LL_TIM_DisableAllOutputs(TIM1);
     }
 }
 
+void bldc_estop_release(void)
+{
+    LL_TIM_ClearFlag_BRK(TIM1);
+    LL_TIM_EnableAllOutputs(TIM1);
+}
+#endif
+
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
 /* ========================================================================= *
- * HALL SENSOR ISR                                                           *
- * ========================================================================= */
-static void hall_isr_callback(const struct device *dev,
-                               struct gpio_callback *cb, uint32_t pins)
+ * ACTIVE BRAKE                                                              *
+ * ========================================================================= *
+ * Same channels as bootstrap, with the braking share in place of its 5 %: *
+ * a low side conducts for ARR − CCR of the period, like the low phase of  *
+ * a commutation step at CCR = 0.                                           */
+void bldc_set_brake_with_duty(int pulse)
 {
-    uint32_t now_us = TIM2->CNT;
-    uint32_t dt_us  = now_us - rpm_prev_ticks;  // wraps correctly (uint32)
+    if (pulse > TIM1_ARR) pulse = TIM1_ARR;
+    if (pulse < 0)        pulse = 0;
 
-    if (dt_us < HALL_DEBOUNCE_US) return;
+    uint32_t ccr = (uint32_t)(TIM1_ARR - pulse);
 
-    rpm_prev_ticks = now_us;
-    rpm_last_edge  = now_us;
+    unsigned int key = irq_lock();
+    TIM1->CCR1 = ccr;
+    TIM1->CCR2 = ccr;
+    TIM1->CCR3 = ccr;
+    TIM1->CCER = (TIM1->CCER & ~BLDC_CCER_ALL) |
+                 TIM_CCER_CC1NE | TIM_CCER_CC2NE | TIM_CCER_CC3NE;
+    LL_TIM_GenerateEvent_UPDATE(TIM1);
+    irq_unlock(key);
 
-    uint8_t raw_step = (uint8_t)bldc_read_hall_state();
-    if (raw_step == 0 || raw_step == 7) return;
+    trace_record(TRACE_EV_BRAKE, bldc_get_direction() ? 0x08 : 0,
+                 (uint16_t)pulse);
+}
+#endif
 
-    if (!motor_running) {
-        atomic_set(&g_motor_speed_atomic, 0);
+/* ========================================================================= *
+ * TIME BASE / HALL SENSOR ISR                                               *
+ * ========================================================================= */
+uint32_t bldc_hall_now_us(void)
+{
+    return TIM2->CNT;
+}
+
+/** Latency of this ISR's commutation, if it commutated on a captured W edge.
+ *  Reading CCR2 clears the capture flag, so a W edge that was debounced or
+ *  came while the motor was stopped is dropped here, not measured later. */
+static inline void hall_latency_record(uint32_t entry_us, uint32_t comm_seq)
+{
+#if HALL_LATENCY_CAPTURE
+    if (!LL_TIM_IsActiveFlag_CC2(TIM2)) {
         return;
     }
-
-    /* ── Softstart ramp ─────────────────────────────────────────────────── */
-    if (softstart_pulse < bldc_percent_to_pulse(SOFTSTART_END_PCT)) {
-        softstart_pulse += SOFTSTART_STEP;
+    uint32_t edge_us = TIM2->CCR2;
+    // A capture after entry is the next edge, pending behind this one
+    if (hall_comm_seq != comm_seq && (int32_t)(entry_us - edge_us) >= 0) {
+        prof_record(PROF_HALL_LATENCY,
+                    (hall_comm_us - edge_us) * (SystemCoreClock / 1000000U));
     }
+#else
+    ARG_UNUSED(entry_us);
+    ARG_UNUSED(comm_seq);
+#endif
+}
 
-    /* ── Commutation ────────────────────────────────────────────────────── */
-    bldc_set_commutation_with_duty(raw_step, softstart_pulse);
-
-    /* ── RPM via TIM2 circular buffer ───────────────────────────────────── *
-     * Store this inter-edge time in the buffer. Average over 6 edges
-     * gives stable reading without lag. Matches partner's proven approach.*/
-    rpm_history[rpm_idx] = dt_us;
-    rpm_idx = (rpm_idx + 1) % RPM_HISTORY_SIZE;
+static inline uint32_t hall_comm_seq_now(void)
+{
+#if HALL_LATENCY_CAPTURE
+    return hall_comm_seq;
+#else
+    return 0;
+#endif
+}
 
-    uint32_t sum = 0;
-    for (int i = 0; i < RPM_HISTORY_SIZE; i++) {
-        sum += rpm_history[i];
+#ifdef CONFIG_MOTOR_HALL_DIRECT_IRQ
+/* ========================================================================= *
+ * DIRECT HALL ISR                                                           *
+ * ========================================================================= *
+ * Vectored straight from EXTI: no interrupt wrapper, no EXTI dispatch and *
+ * no callback-list walk. One IDR read per port gives the hall state, and  *
+ * the edge core commutates from it. A simultaneous edge on two lines is   *
+ * handled once; the second vector then finds no pending flag.             */
+ISR_DIRECT_DECLARE(hall_direct_isr)
+{
+    uint32_t now_us  = TIM2->CNT;
+    uint32_t pending = LL_EXTI_ReadFlag_0_31(HALL_EXTI_MASK);
+    if (!pending) {
+        return 0;
     }
+    LL_EXTI_ClearFlag_0_31(pending);    // before the read: a new edge re-pends
+
+    PROF_BEGIN(t0);
+    uint32_t idr_u = HALL_PORT(hall_u)->IDR;
+    uint32_t idr_v = HALL_SAME_PORT(hall_v, hall_u) ? idr_u : HALL_PORT(hall_v)->IDR;
+    uint32_t idr_w = HALL_SAME_PORT(hall_w, hall_u) ? idr_u :
+                     HALL_SAME_PORT(hall_w, hall_v) ? idr_v : HALL_PORT(hall_w)->IDR;
+    uint8_t  hall  = (uint8_t)(((((idr_u >> HALL_PIN(hall_u)) & 1U) ^ HALL_XOR(hall_u)) << 2) |
+                               ((((idr_v >> HALL_PIN(hall_v)) & 1U) ^ HALL_XOR(hall_v)) << 1) |
+                               (((idr_w >> HALL_PIN(hall_w)) & 1U) ^ HALL_XOR(hall_w)));
+
+    uint32_t seq = hall_comm_seq_now();
+    bldc_hall_edge_at(now_us, hall);
+    hall_latency_record(now_us, seq);
+    PROF_END(PROF_HALL_ISR, t0);
+
+    return 0;       // the edge core wakes no thread: skip the reschedule check
+}
+#else
+static void hall_isr_callback(const struct device *dev,
+                               struct gpio_callback *cb, uint32_t pins)
+{
+    PROF_BEGIN(t0);
+    uint32_t entry_us = TIM2->CNT;
+    uint32_t seq      = hall_comm_seq_now();
+    bldc_hall_edge();
+    hall_latency_record(entry_us, seq);
+    PROF_END(PROF_HALL_ISR, t0);
+}
+#endif
 
-    int32_t mech_rpm = 0;
-    if (sum > 0) {
-        // RPM = 15,000,000 / sum_6  (derived: 60e6 * 6 / (24 * sum_6))
-        mech_rpm = (int32_t)(RPM_CONSTANT_FILT / sum);
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+/* ========================================================================= *
+ * ADVANCED COMMUTATION TIMER — TIM2 CH3 compare                             *
+ * ========================================================================= *
+ * One shot: CC3IE is set while a time is pending and cleared when it      *
+ * fires or is cancelled. A time already reached when it is set is run     *
+ * in place, since the compare only matches on equality and would wait a  *
+ * full 71-minute wrap. bldc_hall_advance_fire() ignores a second call    *
+ * for the same step, so a match racing the direct call is harmless.       */
+static void tim2_cc_isr(const void *arg)
+{
+    ARG_UNUSED(arg);
+
+    LL_TIM_ClearFlag_CC3(TIM2);
+    if (!LL_TIM_IsEnabledIT_CC3(TIM2)) {
+        return;
     }
+    LL_TIM_DisableIT_CC3(TIM2);
+    bldc_hall_advance_fire();
+}
 
-    atomic_set(&g_motor_speed_atomic,
-               (atomic_val_t)(current_direction_ccw ? -mech_rpm : mech_rpm));
+void bldc_comm_timer_start(uint32_t at_us)
+{
+    LL_TIM_OC_SetCompareCH3(TIM2, at_us);
+    LL_TIM_ClearFlag_CC3(TIM2);
+    LL_TIM_EnableIT_CC3(TIM2);
+
+    if ((int32_t)(TIM2->CNT - at_us) >= 0) {
+        LL_TIM_DisableIT_CC3(TIM2);
+        LL_TIM_ClearFlag_CC3(TIM2);
+        bldc_hall_advance_fire();
+    }
 }
 
-/* ========================================================================= *
- * RPM TIMEOUT CHECK — call from motor_control.c instead of cycle count    *
- * ========================================================================= */
-bool bldc_is_rpm_timed_out(void)
+void bldc_comm_timer_cancel(void)
 {
-    uint32_t now = TIM2->CNT;
-    uint32_t age = now - rpm_last_edge;
-    return (age > RPM_TIMEOUT_US);
+    LL_TIM_DisableIT_CC3(TIM2);
+    LL_TIM_ClearFlag_CC3(TIM2);
 }
+#endif
 
 /* ========================================================================= *
  * SENSOR READ                                                               *
@@ -313,106 +522,41 @@ int bldc_read_hall_state(void)
  * ========================================================================= *
  * High-side CCR = pulse  → PWMs at requested duty
  * Low-side  CCR = 0      → complementary ON full cycle (solid return path)
- * IRQ lock protects the CCER read-modify-write from ISR preemption.       */
+ * The step is a precomputed table entry, so the critical section is two
+ * CCR stores, one CCER read-modify-write and the update event. CCRs are
+ * preloaded, so writing them before CCER cannot glitch the old step.     */
 void bldc_set_commutation_with_duty(uint8_t hall_state, int pulse)
 {
+    PROF_BEGIN(t0);
+
     if (pulse > TIM1_ARR) pulse = TIM1_ARR;
     if (pulse < 0)        pulse = 0;
 
-    uint8_t comm = current_direction_ccw
-                   ? ccw_commutation[hall_state]
-                   : cw_commutation[hall_state];
-
-    unsigned int key = irq_lock();
+    const struct bldc_comm_step *step =
+        &bldc_comm_table[bldc_get_direction() ? BLDC_DIR_CCW : BLDC_DIR_CW]
+                        [hall_state & 0x7];
 
-    TIM1->CCER &= ~(TIM_CCER_CC1E  | TIM_CCER_CC1NE |
-                    TIM_CCER_CC2E  | TIM_CCER_CC2NE |
-                    TIM_CCER_CC3E  | TIM_CCER_CC3NE);
-
-    switch (comm) {
-        case 1: // W+ V-
-            TIM1->CCR3 = (uint32_t)pulse;  TIM1->CCR2 = 0;
-            TIM1->CCER |= TIM_CCER_CC3E | TIM_CCER_CC2NE; break;
-        case 2: // V+ U-
-            TIM1->CCR2 = (uint32_t)pulse;  TIM1->CCR1 = 0;
-            TIM1->CCER |= TIM_CCER_CC2E | TIM_CCER_CC1NE; break;
-        case 3: // W+ U-
-            TIM1->CCR3 = (uint32_t)pulse;  TIM1->CCR1 = 0;
-            TIM1->CCER |= TIM_CCER_CC3E | TIM_CCER_CC1NE; break;
-        case 4: // U+ W-
-            TIM1->CCR1 = (uint32_t)pulse;  TIM1->CCR3 = 0;
-            TIM1->CCER |= TIM_CCER_CC1E | TIM_CCER_CC3NE; break;
-        case 5: // U+ V-
-            TIM1->CCR1 = (uint32_t)pulse;  TIM1->CCR2 = 0;
-            TIM1->CCER |= TIM_CCER_CC1E | TIM_CCER_CC2NE; break;
-        case 6: // V+ W-
-            TIM1->CCR2 = (uint32_t)pulse;  TIM1->CCR3 = 0;
-            TIM1->CCER |= TIM_CCER_CC2E | TIM_CCER_CC3NE; break;
-        default:
-            irq_unlock(key);
-            LOG_ERR("bldc: invalid comm %u for hall 0x%X", comm, hall_state);
-            return;
+    if (step->ccer == 0) {
+        LOG_ERR("bldc: invalid hall state 0x%X", hall_state);
+        return;
     }
 
+    volatile uint32_t *ccr = &TIM1->CCR1;
+
+    unsigned int key = irq_lock();
+    ccr[step->high] = (uint32_t)pulse;
+    ccr[step->low]  = 0;
+    TIM1->CCER = (TIM1->CCER & ~BLDC_CCER_ALL) | step->ccer;
     LL_TIM_GenerateEvent_UPDATE(TIM1);
+#if HALL_LATENCY_CAPTURE
+    hall_comm_us = TIM2->CNT;
+    hall_comm_seq++;
+#endif
     irq_unlock(key);
-}
-
-/* ========================================================================= *
- * PWM OUTPUT — called by PID thread                                        *
- * ========================================================================= */
-void bldc_set_pwm(int pulse)
-{
-    if (!motor_running) return;
-    if (softstart_pulse < bldc_percent_to_pulse(SOFTSTART_END_PCT)) return;
-
-    uint8_t state = (uint8_t)bldc_read_hall_state();
-    if (state != 0 && state != 7) {
-        bldc_set_commutation_with_duty(state, pulse);
-    }
 
-    if (pulse > softstart_pulse) {
-        softstart_pulse = pulse;
-    }
-}
+    trace_record(TRACE_EV_COMMUTATE,
+                 (hall_state & 0x7) | (bldc_get_direction() ? 0x08 : 0),
+                 (uint16_t)pulse);
 
-/* ========================================================================= *
- * LEGACY bldc_set_commutation                                              *
- * ========================================================================= */
-void bldc_set_commutation(uint8_t step)
-{
-    bldc_set_commutation_with_duty(bldc_read_hall_state(), softstart_pulse);
-    (void)step;
+    PROF_END(PROF_COMMUTATE, t0);
 }
-
-/* ========================================================================= *
- * CONVERSION / GETTERS / SETTERS                                            *
- * ========================================================================= */
-int bldc_percent_to_pulse(float pct)
-{
-    int pulse = (int)(pct * 32.0f);
-    if (pulse > TIM1_ARR) pulse = TIM1_ARR;
-    if (pulse < 0)        pulse = 0;
-    return pulse;
-}
-
-uint32_t bldc_get_last_cycle_count(void)
-{
-    // Legacy shim — returns TIM2 tick. Use bldc_get_rpm_age_ms() instead.
-    return rpm_last_edge;
-}
-
-/** @brief Return milliseconds since last valid hall edge using TIM2.
- *  Correct unit — do NOT use k_cyc_to_ms on the return value of
- *  bldc_get_last_cycle_count() which returns µs ticks not CPU cycles.
- */
-uint32_t bldc_get_rpm_age_ms(void)
-{
-    uint32_t age_us = TIM2->CNT - rpm_last_edge;  // wraps correctly uint32
-    return age_us / 1000U;
-}
-
-void bldc_set_direction(int ccw)
-{
-    current_direction_ccw = ccw;
-}
\ No newline at end of file
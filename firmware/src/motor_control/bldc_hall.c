@@ -0,0 +1,707 @@
+#include "bldc_hall.h"
+#include "bldc_driver.h"
+#include "seqcount.h"
+#include "trace.h"
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(bldc_hall, LOG_LEVEL_INF);
+
+/* ========================================================================= *
+ * CONSTANTS                                                                 *
+ * ========================================================================= */
+#define TIM1_ARR            BLDC_TIM1_ARR
+#define EDGES_PER_REV       BLDC_EDGES_PER_REV  // = 24
+
+/* ── RPM from the 1 MHz time base ──────────────────────────────────────────
+ * TIM2 free-running at 1MHz (prescaler = 64-1 = 63 for 64MHz APB1).
+ * Same approach as partner's working code — cleaner than CPU cycle counter.
+ * dt measured in microseconds directly.
+ *
+ * RPM calculation with an N-sample running sum (N = RPM_HISTORY_SIZE):
+ *   sum_N = sum of N consecutive inter-edge times in µs
+ *   RPM = (60 * 1,000,000 * N) / (sum_N * EDGES_PER_REV)
+ *       = (2,500,000 * N) / sum_N          (N=6 → 15,000,000 / sum_6)
+ *
+ * The sum is kept incrementally (add newest, subtract the slot it
+ * overwrites) so the ISR does one divide and no loop, whatever N is.
+ * bldc_rpm_window_push() in bldc_hall.h, shared with the hall self-test.
+ *
+ * Single-edge (instantaneous) formula:
+ *   RPM = (60 * 1,000,000) / (dt_us * EDGES_PER_REV)
+ *       = 60,000,000 / (dt_us * 24)
+ *       = 2,500,000 / dt_us                                              */
+#define RPM_CONSTANT        BLDC_RPM_CONSTANT
+#define RPM_HISTORY_SIZE    BLDC_RPM_WINDOW
+#define RPM_CONSTANT_FILT   (RPM_CONSTANT * RPM_HISTORY_SIZE)
+#define RPM_TIMEOUT_US      BLDC_RPM_TIMEOUT_US
+
+#ifdef CONFIG_MOTOR_HALL_COMP
+/* ── Per-sector interval compensation ──────────────────────────────────────
+ * Hall placement error makes the six sectors unequal: at constant speed
+ * each inter-edge interval is off by its sector's share of the error, the
+ * same every electrical revolution. With a learned table loaded each dt
+ * is scaled by its sector's weight (mean sector / this sector, Q16), and
+ * the estimate only needs the last HALL_COMP_WINDOW intervals instead of
+ * a whole revolution to average the error out. The calibration sums
+ * below give the thread the raw per-sector means to learn it from. A
+ * sector's sum is at most the time spent collecting, and hall_comp.c
+ * stops within HC_COLLECT_MAX_S (10 s = 10^7 µs, well inside 32 bits). */
+#define HALL_COMP_WINDOW    CONFIG_MOTOR_HALL_COMP_WINDOW
+#define HALL_COMP_ONE       65536U
+#define HALL_CAL_MAX_EDGES  60000U      // per sector, keeps the uint16_t counts from wrapping
+BUILD_ASSERT(HALL_COMP_WINDOW <= RPM_HISTORY_SIZE,
+             "the compensated window is the newest part of the RPM history");
+#endif
+
+/* ── Debounce and softstart ─────────────────────────────────────────────────
+ * Runtime parameters (PARAM_HALL_DEBOUNCE_US, PARAM_SOFTSTART_*), pushed
+ * by the PID thread through bldc_hall_set_tuning(). At 3000 RPM with 24
+ * edges/rev an edge comes every 833µs → 50µs debounce; 5000µs for
+ * bench/hand testing. Softstart defaults: 10 % start, +1 % per edge, PID
+ * takes over above 15 %. The writer holds a spinlock, which masks the
+ * hall IRQ, so the ISR reads the set without one and never sees half of
+ * an update.                                                             */
+static struct {
+    uint32_t debounce_us;
+    int      ss_duty;       // pulse counts
+    int      ss_step;       // pulse counts per edge
+    int      ss_end;        // pulse counts
+} hall_tuning = {
+    .debounce_us = 50,
+    .ss_duty     = (TIM1_ARR * 10) / 100,   //  320 counts
+    .ss_step     = (TIM1_ARR *  1) / 100,   //   32 counts/edge
+    .ss_end      = (TIM1_ARR * 15) / 100,   //  480 counts
+};
+static struct k_spinlock hall_tuning_lock;
+
+#ifdef CONFIG_MOTOR_HALL_COMP
+// Written under hall_tuning_lock like the tuning above
+static uint32_t hall_comp_q16[6] = {
+    HALL_COMP_ONE, HALL_COMP_ONE, HALL_COMP_ONE,
+    HALL_COMP_ONE, HALL_COMP_ONE, HALL_COMP_ONE,
+};
+static bool     hall_comp_on = false;   // any weight != 1: short window
+#endif
+
+/* ========================================================================= *
+ * ISR / RUNTIME STATE                                                       *
+ * ========================================================================= */
+atomic_t g_motor_speed_atomic = ATOMIC_INIT(0);
+
+/* ── RPM measurement ─────────────────────────────────────────────────────── */
+static struct bldc_rpm_window rpm_win;       // hall ISR, or under hall_tuning_lock
+static volatile uint32_t rpm_prev_ticks  = 0;
+static volatile uint32_t rpm_last_edge   = 0;  // µs tick of last valid edge
+#ifdef CONFIG_MOTOR_HALL_COMP
+static volatile uint32_t rpm_sum_short   = 0;  // newest HALL_COMP_WINDOW of rpm_win.hist[]
+
+/* ── Calibration sums ──────────────────────────────────────────────────── *
+ * Raw intervals per sector, driven edges in the commanded direction only. *
+ * Cleared and enabled by bldc_hall_cal_start(), copied under the lock.   */
+static bool     hall_cal_on = false;
+static uint32_t hall_cal_sum[6];
+static uint16_t hall_cal_n[6];
+#endif
+
+/* ── Hall-edge position tracking ─────────────────────────────────────────── *
+ * Written only by the hall ISR, read by threads through hall_pos_seq so   *
+ * the count, timestamp and interval are always from the same edge.       *
+ * Sector index follows the CCW hall sequence 6→4→5→1→3→2: a step of +1    *
+ * sector is CCW rotation (-1 edge), a step of -1 sector is CW (+1 edge). */
+static const uint8_t hall_sector[8] = { 0xFF, 3, 5, 4, 1, 2, 0, 0xFF };
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+static const uint8_t sector_hall[6] = { 6, 4, 5, 1, 3, 2 };
+#endif
+
+static struct {
+    int32_t  edges;       // signed multi-turn edge count (+ = CW)
+    uint32_t edge_time;   // µs tick of the last counted edge
+    uint32_t edge_dt;     // µs between the last two counted edges
+    int8_t   dir;         // direction of the last counted edge (+1/-1)
+} hall_pos;
+static seqcount_t hall_pos_seq = SEQCOUNT_INIT;
+static uint8_t    hall_prev_sector = 0xFF;
+
+/* ── Motor control state ─────────────────────────────────────────────────── */
+static volatile int  current_direction_ccw = 0;
+static volatile bool motor_running         = false;
+static volatile int  softstart_pulse       = 0;      // pulse applied on every edge
+static volatile bool softstart_done        = false;  // PID owns softstart_pulse once set
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+static volatile bool hall_braking          = false;  // low sides on, edges only measure
+static volatile bool rpm_ccw               = false;  // measured direction the speed is signed by
+#endif
+
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+/* ── Phase advance ───────────────────────────────────────────────────────── *
+ * Each edge predicts the next one from the edge interval and schedules   *
+ * the following step (1 − advance/60°) of that interval later, on the    *
+ * driver's compare timer. When the edge arrives its commutation is then  *
+ * a no-op. The interval is the larger of the last one and the window     *
+ * average: hall placement error averages out over the window, and while *
+ * slowing down the step comes late (less advance), never early.          *
+ * The PID thread writes hall_adv_q16; the rest is the hall ISR's and the *
+ * compare ISR's, which run at the same priority.                          */
+static volatile uint32_t hall_adv_q16 = 0;     // advance, Q16 fraction of a sector
+static volatile bool     hall_adv_armed = false;
+static volatile bool     hall_adv_fired = false;   // bridge is on hall_adv_next
+static volatile uint8_t  hall_adv_next;
+#endif
+
+/* ========================================================================= *
+ * INIT / RUN STATE                                                          *
+ * ========================================================================= */
+void bldc_hall_init(int boot_hall)
+{
+    uint32_t now = bldc_hall_now_us();
+
+    rpm_prev_ticks = now;
+    rpm_last_edge  = now;
+    bldc_rpm_window_reset(&rpm_win);
+#ifdef CONFIG_MOTOR_HALL_COMP
+    rpm_sum_short = 0;
+    hall_cal_on   = false;
+#endif
+
+    seqcount_write_begin(&hall_pos_seq);
+    hall_pos.edges     = 0;
+    hall_pos.edge_time = now;
+    hall_pos.edge_dt   = 0;
+    hall_pos.dir       = 0;
+    seqcount_write_end(&hall_pos_seq);
+    hall_prev_sector = hall_sector[boot_hall & 0x7];
+
+    current_direction_ccw = 0;
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+    rpm_ccw = false;
+#endif
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+    hall_adv_q16 = 0;
+#endif
+    bldc_hall_stop();
+}
+
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+static inline void hall_advance_cancel(void)
+{
+    if (hall_adv_armed) {
+        hall_adv_armed = false;
+        bldc_comm_timer_cancel();
+    }
+    hall_adv_fired = false;
+}
+#endif
+
+void bldc_hall_stop(void)
+{
+    motor_running   = false;
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+    hall_braking    = false;
+#endif
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+    hall_advance_cancel();
+#endif
+    softstart_pulse = hall_tuning.ss_duty;
+    softstart_done  = false;
+    atomic_set(&g_motor_speed_atomic, 0);
+}
+
+void bldc_hall_set_tuning(uint32_t debounce_us, int softstart_duty,
+                          int softstart_step, int softstart_end)
+{
+    k_spinlock_key_t key = k_spin_lock(&hall_tuning_lock);
+    hall_tuning.debounce_us = debounce_us;
+    hall_tuning.ss_duty     = softstart_duty;
+    hall_tuning.ss_step     = softstart_step;
+    hall_tuning.ss_end      = softstart_end;
+    k_spin_unlock(&hall_tuning_lock, key);
+}
+
+#ifdef CONFIG_MOTOR_HALL_COMP
+void bldc_hall_set_comp(const float weight[6])
+{
+    uint32_t q16[6];
+    bool     on = false;
+
+    for (int s = 0; s < 6; s++) {
+        q16[s] = (uint32_t)(weight[s] * (float)HALL_COMP_ONE + 0.5f);
+        on |= (q16[s] != HALL_COMP_ONE);
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&hall_tuning_lock);
+    for (int s = 0; s < 6; s++) {
+        hall_comp_q16[s] = q16[s];
+    }
+    if (on != hall_comp_on) {
+        // The short sum is only kept up to date while it is in use
+        rpm_sum_short = 0;
+        for (int k = 1; k <= HALL_COMP_WINDOW; k++) {
+            rpm_sum_short += rpm_win.hist[(rpm_win.idx + RPM_HISTORY_SIZE - k) % RPM_HISTORY_SIZE];
+        }
+        hall_comp_on = on;
+    }
+    k_spin_unlock(&hall_tuning_lock, key);
+}
+
+void bldc_hall_cal_start(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&hall_tuning_lock);
+    for (int s = 0; s < 6; s++) {
+        hall_cal_sum[s] = 0;
+        hall_cal_n[s]   = 0;
+    }
+    hall_cal_on = true;
+    k_spin_unlock(&hall_tuning_lock, key);
+}
+
+void bldc_hall_cal_read(uint32_t sum_us[6], uint16_t n[6])
+{
+    k_spinlock_key_t key = k_spin_lock(&hall_tuning_lock);
+    for (int s = 0; s < 6; s++) {
+        sum_us[s] = hall_cal_sum[s];
+        n[s]      = hall_cal_n[s];
+    }
+    k_spin_unlock(&hall_tuning_lock, key);
+}
+
+void bldc_hall_cal_stop(void)
+{
+    hall_cal_on = false;
+}
+#endif
+
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+void bldc_hall_set_advance(int32_t cdeg_e)
+{
+    if (cdeg_e < 0)    cdeg_e = 0;
+    if (cdeg_e > 3000) cdeg_e = 3000;
+    hall_adv_q16 = ((uint32_t)cdeg_e << 16) / 6000U;
+}
+#endif
+
+/* ========================================================================= *
+ * MOTOR START                                                               *
+ * ========================================================================= */
+static void hall_start(int pulse, bool ramp)
+{
+    softstart_pulse = pulse;
+    softstart_done  = !ramp;
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+    hall_braking    = false;
+#endif
+    motor_running   = true;
+
+    // Seed the timestamp so hall_age doesn't false-timeout immediately
+    rpm_last_edge = bldc_hall_now_us();
+
+    uint8_t state = (uint8_t)bldc_read_hall_state();
+    if (state != 0 && state != 7) {
+        bldc_set_commutation_with_duty(state, softstart_pulse);
+        LOG_INF("Motor start: hall=0x%X duty=%d", state, softstart_pulse);
+    }
+}
+
+void bldc_set_running(void)
+{
+    hall_start(hall_tuning.ss_duty, true);
+}
+
+void bldc_set_running_direct(void)
+{
+    hall_start(0, false);
+}
+
+/* ========================================================================= *
+ * HALL EDGE                                                                 *
+ * ========================================================================= */
+/** Count the sectors the hall state moved since the last accepted edge.
+ *  An edge dropped by the debounce, or a state the ISR never saw, shows
+ *  up here as a skip of two or three sectors, and the count follows the
+ *  hall state rather than the number of interrupts, so it never drifts.
+ *  Three sectors is the opposite state and could be either way round; it
+ *  is taken as the way the shaft last turned (the driven way before any
+ *  edge).
+ *  @return The direction of a single-sector edge (+1 = CW); 0 for the
+ *          same state or a skip, whose interval spans several sectors. */
+static inline int8_t hall_track_position(uint8_t hall, uint32_t now_us,
+                                         uint32_t dt_us)
+{
+    uint8_t sector = hall_sector[hall];
+    uint8_t prev   = hall_prev_sector;
+    hall_prev_sector = sector;
+    if (prev == 0xFF) {
+        return 0;           // no valid reference yet (bad boot state)
+    }
+    uint8_t delta = (uint8_t)((sector + 6U - prev) % 6U);
+    if (delta == 0) {
+        return 0;           // same state
+    }
+
+    // One sector backwards in the CCW sequence = CW
+    int8_t steps = (delta > 3) ? (int8_t)(6 - delta) : -(int8_t)delta;
+    if (delta == 3) {
+        bool ccw = (hall_pos.dir != 0) ? (hall_pos.dir < 0) : current_direction_ccw;
+        steps = ccw ? -3 : 3;
+    }
+    int8_t   dir = (steps > 0) ? 1 : -1;
+    uint32_t n   = (uint32_t)((steps > 0) ? steps : -steps);
+
+    seqcount_write_begin(&hall_pos_seq);
+    hall_pos.edges    += steps;
+    hall_pos.edge_time = now_us;
+    hall_pos.edge_dt   = ((dt_us > RPM_TIMEOUT_US) ? RPM_TIMEOUT_US : dt_us) / n;
+    hall_pos.dir       = dir;
+    seqcount_write_end(&hall_pos_seq);
+    return (n == 1) ? dir : 0;
+}
+
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+/** Arm the step after @p hall, ahead of the edge predicted from @p dt_us.
+ *  Only while the shaft turns the commanded way: coasting backwards or
+ *  a skipped sector gives no prediction.                                */
+static inline void hall_advance_schedule(uint8_t hall, int8_t dir,
+                                         uint32_t now_us, uint32_t dt_us)
+{
+    uint32_t adv = hall_adv_q16;
+    if (adv == 0 || !softstart_done || dir != (current_direction_ccw ? -1 : 1)) {
+        return;
+    }
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+    if (hall_braking) {
+        return;
+    }
+#endif
+
+    uint32_t interval = rpm_win.sum / RPM_HISTORY_SIZE;
+    if (interval < dt_us) {
+        interval = dt_us;
+    }
+    uint32_t delay = (uint32_t)(((uint64_t)interval * (65536U - adv)) >> 16);
+
+    uint8_t sector = hall_sector[hall];
+    hall_adv_next  = sector_hall[(dir > 0) ? (sector + 5U) % 6U : (sector + 1U) % 6U];
+    hall_adv_armed = true;
+    bldc_comm_timer_start(now_us + delay);
+}
+
+void bldc_hall_advance_fire(void)
+{
+    if (!hall_adv_armed) {
+        return;
+    }
+    hall_adv_armed = false;
+    if (!motor_running) {
+        return;
+    }
+    hall_adv_fired = true;
+    bldc_set_commutation_with_duty(hall_adv_next, softstart_pulse);
+}
+#endif
+
+void bldc_hall_edge(void)
+{
+    bldc_hall_edge_at(bldc_hall_now_us(), (uint8_t)bldc_read_hall_state());
+}
+
+void bldc_hall_edge_at(uint32_t now_us, uint8_t raw_step)
+{
+    uint32_t dt_us = now_us - rpm_prev_ticks;   // wraps correctly (uint32)
+
+    if (dt_us < hall_tuning.debounce_us) return;
+
+    rpm_prev_ticks = now_us;
+    rpm_last_edge  = now_us;
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+    hall_advance_cancel();
+#endif
+
+    trace_record(TRACE_EV_HALL_EDGE, raw_step,
+                 (dt_us > UINT16_MAX) ? UINT16_MAX : (uint16_t)dt_us);
+    if (raw_step == 0 || raw_step == 7) return;
+
+    /* ── Position: count every edge, motor driven or coasting ───────────── */
+    uint8_t span = hall_prev_sector;    // the sector this interval was spent in
+    int8_t  dir  = hall_track_position(raw_step, now_us, dt_us);
+
+    if (!motor_running) {
+        atomic_set(&g_motor_speed_atomic, 0);
+        return;
+    }
+
+    /* ── Softstart ramp ─────────────────────────────────────────────────── */
+    if (!softstart_done) {
+        softstart_pulse += hall_tuning.ss_step;
+        softstart_done   = (softstart_pulse >= hall_tuning.ss_end);
+    }
+
+    /* ── Commutation ────────────────────────────────────────────────────── */
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+    if (!hall_braking) {
+        bldc_set_commutation_with_duty(raw_step, softstart_pulse);
+    }
+#else
+    bldc_set_commutation_with_duty(raw_step, softstart_pulse);
+#endif
+
+    /* ── RPM via running sum ────────────────────────────────────────────── *
+     * Replace the oldest inter-edge time with this one and adjust the sum
+     * by the difference — O(1) regardless of window length. dt is capped
+     * at the stopped timeout so a long pause cannot overflow the sum.    */
+    uint32_t sample = (dt_us > RPM_TIMEOUT_US) ? RPM_TIMEOUT_US : dt_us;
+#ifdef CONFIG_MOTOR_HALL_COMP
+    if (dir != 0) {
+        if (hall_cal_on && softstart_done &&
+            dir == (current_direction_ccw ? -1 : 1) &&
+            hall_cal_n[span] < HALL_CAL_MAX_EDGES) {
+            hall_cal_sum[span] += sample;
+            hall_cal_n[span]++;
+        }
+        if (hall_comp_on) {
+            sample = (uint32_t)(((uint64_t)sample * hall_comp_q16[span]) >> 16);
+        }
+    }
+    if (hall_comp_on) {
+        uint8_t out = (uint8_t)((rpm_win.idx + RPM_HISTORY_SIZE - HALL_COMP_WINDOW) %
+                                RPM_HISTORY_SIZE);
+        rpm_sum_short += sample - rpm_win.hist[out];
+    }
+#endif
+    bldc_rpm_window_push(&rpm_win, sample);
+
+    uint32_t sum_us  = rpm_win.sum;
+    uint32_t rpm_num = RPM_CONSTANT_FILT;
+#ifdef CONFIG_MOTOR_HALL_COMP
+    if (hall_comp_on) {
+        sum_us  = rpm_sum_short;
+        rpm_num = RPM_CONSTANT * HALL_COMP_WINDOW;
+    }
+#endif
+    int32_t mech_rpm = bldc_rpm_from_sum(rpm_num, sum_us);
+
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+    /* Signed by the way the shaft turns, not the way it is driven: through
+     * a reversal or a brake the loop must see it still going the old way. */
+    if (dir != 0) {
+        rpm_ccw = (dir < 0);
+    }
+    atomic_set(&g_motor_speed_atomic, (atomic_val_t)(rpm_ccw ? -mech_rpm : mech_rpm));
+#else
+    atomic_set(&g_motor_speed_atomic,
+               (atomic_val_t)(current_direction_ccw ? -mech_rpm : mech_rpm));
+#endif
+
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+    hall_advance_schedule(raw_step, dir, now_us, dt_us);
+#else
+    ARG_UNUSED(dir);
+#endif
+}
+
+/* ========================================================================= *
+ * RPM TIMEOUT CHECK — call from motor_control.c instead of cycle count    *
+ * ========================================================================= */
+bool bldc_is_rpm_timed_out(void)
+{
+    uint32_t age = bldc_hall_now_us() - rpm_last_edge;
+    return (age > RPM_TIMEOUT_US);
+}
+
+/* ========================================================================= *
+ * PWM OUTPUT — called by PID thread                                        *
+ * ========================================================================= */
+void bldc_set_pwm(int pulse)
+{
+    if (!motor_running) return;
+    if (!softstart_done) return;
+
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+    hall_braking = false;       // edges commutate again from here
+#endif
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+    // Stay on an advanced step until its edge; the lock keeps it from firing in between
+    unsigned int key = irq_lock();
+    uint8_t state = hall_adv_fired ? hall_adv_next : (uint8_t)bldc_read_hall_state();
+#else
+    uint8_t state = (uint8_t)bldc_read_hall_state();
+#endif
+    if (state != 0 && state != 7) {
+        bldc_set_commutation_with_duty(state, pulse);
+    }
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+    irq_unlock(key);
+#endif
+
+    /* Edges keep applying the latest command — it may go down as well as
+     * up (position hold, deceleration), not just the highest ever seen. */
+    softstart_pulse = pulse;
+}
+
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+/* ========================================================================= *
+ * ACTIVE BRAKE — called by PID thread or the fast speed loop               *
+ * ========================================================================= *
+ * The bootstrap pattern with a braking share: all three low sides on for  *
+ * pulse/ARR of each period, the high sides off. Edges keep the position   *
+ * and speed going but no longer commutate; the next bldc_set_pwm() puts  *
+ * the bridge back on the sector's step. Like bldc_set_pwm(), a no-op     *
+ * until softstart has handed over.                                         */
+void bldc_set_brake(int pulse)
+{
+    if (!motor_running) return;
+    if (!softstart_done) return;
+
+    unsigned int key = irq_lock();
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+    hall_advance_cancel();      // a step fired after this would drive again
+#endif
+    hall_braking = true;
+    bldc_set_brake_with_duty(pulse);
+    irq_unlock(key);
+
+    softstart_pulse = 0;        // bldc_set_pwm() sets the drive pulse again
+}
+#endif
+
+/* ========================================================================= *
+ * LEGACY bldc_set_commutation                                              *
+ * ========================================================================= */
+void bldc_set_commutation(uint8_t step)
+{
+    bldc_set_commutation_with_duty(bldc_read_hall_state(), softstart_pulse);
+    (void)step;
+}
+
+/* ========================================================================= *
+ * CONVERSION / GETTERS / SETTERS                                            *
+ * ========================================================================= */
+bool bldc_softstart_done(void)
+{
+    return softstart_done;
+}
+
+int bldc_get_pulse(void)
+{
+    return softstart_pulse;
+}
+
+int bldc_percent_to_pulse(float pct)
+{
+    int pulse = (int)(pct * 32.0f);
+    if (pulse > TIM1_ARR) pulse = TIM1_ARR;
+    if (pulse < 0)        pulse = 0;
+    return pulse;
+}
+
+uint32_t bldc_get_last_cycle_count(void)
+{
+    // Legacy shim — returns the µs tick. Use bldc_get_rpm_age_ms() instead.
+    return rpm_last_edge;
+}
+
+/** @brief Return milliseconds since last valid hall edge.
+ *  Correct unit — do NOT use k_cyc_to_ms on the return value of
+ *  bldc_get_last_cycle_count() which returns µs ticks not CPU cycles.
+ */
+uint32_t bldc_get_rpm_age_ms(void)
+{
+    uint32_t age_us = bldc_hall_now_us() - rpm_last_edge;  // wraps correctly uint32
+    return age_us / 1000U;
+}
+
+void bldc_set_direction(int ccw)
+{
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+    // An armed step was predicted for the old direction's table
+    unsigned int key = irq_lock();
+    hall_advance_cancel();
+    current_direction_ccw = ccw;
+    irq_unlock(key);
+#else
+    current_direction_ccw = ccw;
+#endif
+}
+
+int bldc_get_direction(void)
+{
+    return current_direction_ccw;
+}
+
+/* ========================================================================= *
+ * POSITION                                                                  *
+ * ========================================================================= */
+int32_t bldc_get_edge_count(void)
+{
+    uint32_t seq;
+    int32_t  edges;
+    do {
+        seq   = seqcount_read_begin(&hall_pos_seq);
+        edges = hall_pos.edges;
+    } while (seqcount_read_retry(&hall_pos_seq, seq));
+    return edges;
+}
+
+void bldc_get_edge_snapshot(struct bldc_edge_snapshot *out)
+{
+    uint32_t seq;
+    do {
+        seq          = seqcount_read_begin(&hall_pos_seq);
+        out->edges   = hall_pos.edges;
+        out->time_us = hall_pos.edge_time;
+        out->dt_us   = hall_pos.edge_dt;
+        out->dir     = hall_pos.dir;
+    } while (seqcount_read_retry(&hall_pos_seq, seq));
+}
+
+/** The edge count puts the rotor in the sector from edges × 15° up to the
+ *  next edge, whichever way it turns: a CW edge enters that sector at its
+ *  low end, a CCW edge at its high end. Inside it the angle is
+ *  interpolated from the time since the last edge and the previous edge
+ *  interval, assuming constant speed, and capped just short of the far
+ *  end so it never runs ahead of the hall sensors. Once the next edge is
+ *  overdue the shaft is slowing or stopped; over one more interval the
+ *  estimate then falls back to the sector midpoint, which is all the
+ *  halls can say about a stopped shaft (±7.5°).                         */
+int32_t bldc_get_position_cdeg(void)
+{
+    uint32_t seq;
+    int32_t  edges;
+    uint32_t edge_time, edge_dt;
+    int8_t   dir;
+    do {
+        seq       = seqcount_read_begin(&hall_pos_seq);
+        edges     = hall_pos.edges;
+        edge_time = hall_pos.edge_time;
+        edge_dt   = hall_pos.edge_dt;
+        dir       = hall_pos.dir;
+    } while (seqcount_read_retry(&hall_pos_seq, seq));
+
+    int32_t sector_edge = edges % EDGES_PER_REV;
+    if (sector_edge < 0) {
+        sector_edge += EDGES_PER_REV;
+    }
+    int32_t frac = BLDC_CDEG_PER_EDGE / 2;      // from the edge entered
+
+    if (dir != 0 && edge_dt > 0) {
+        uint32_t since = bldc_hall_now_us() - edge_time;
+        if (since <= edge_dt) {
+            frac = (int32_t)((since * BLDC_CDEG_PER_EDGE) / edge_dt);
+            if (frac >= BLDC_CDEG_PER_EDGE) {
+                frac = BLDC_CDEG_PER_EDGE - 1;
+            }
+        } else if (since < 2U * edge_dt) {
+            frac = BLDC_CDEG_PER_EDGE - 1 - (int32_t)(((since - edge_dt) *
+                   (BLDC_CDEG_PER_EDGE / 2)) / edge_dt);
+        }
+    }
+    int32_t cdeg = sector_edge * BLDC_CDEG_PER_EDGE +
+                   ((dir < 0) ? BLDC_CDEG_PER_EDGE - frac : frac);
+
+    if (cdeg < 0) {
+        cdeg += 36000;
+    } else if (cdeg >= 36000) {
+        cdeg -= 36000;
+    }
+    return cdeg;
+}
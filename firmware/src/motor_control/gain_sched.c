@@ -0,0 +1,254 @@
+#include "gain_sched.h"
+#include "motor.h"
+#include "seqcount.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#ifdef CONFIG_MOTOR_PARAMS_PERSIST
+#include <zephyr/settings/settings.h>
+#endif
+
+LOG_MODULE_REGISTER(gain_sched, LOG_LEVEL_INF);
+
+/* ========================================================================= *
+ * CONFIGURATION                                                             *
+ * ========================================================================= *
+ * The speed has to move GAIN_SCHED_RPM_STEP before the gains are looked   *
+ * up again, so hall jitter at a steady speed does not re-apply them every *
+ * tick (each apply rescales the integral).                                */
+#define GAIN_SCHED_RPM_STEP     20.0f
+#define GAIN_SCHED_MERGE_PCT    10
+#define GAIN_SCHED_KEY          "motor/gsched/table"
+
+/* ========================================================================= *
+ * STATE                                                                     *
+ * ========================================================================= */
+static struct gain_sched_table gs_active;           // PID thread only
+static float                   gs_last_rpm;
+static bool                    gs_dirty;            // re-apply on the next update
+
+static struct gain_sched_table gs_pending;          // under gs_lock
+static volatile bool           gs_pending_valid;
+static struct k_spinlock       gs_lock;
+
+static struct gain_sched_table gs_pub;              // published copy, under gs_pub_seq
+static seqcount_t              gs_pub_seq = SEQCOUNT_INIT;
+
+#ifdef CONFIG_MOTOR_PARAMS_PERSIST
+static struct gain_sched_table gs_saved;            // settings load at boot, then read-only
+static bool                    gs_saved_valid;
+#endif
+
+/* ========================================================================= *
+ * HELPERS                                                                   *
+ * ========================================================================= */
+static void gs_publish(void)
+{
+    seqcount_write_begin(&gs_pub_seq);
+    gs_pub = gs_active;
+    seqcount_write_end(&gs_pub_seq);
+    gs_dirty = true;
+}
+
+static bool gs_point_valid(const struct gain_sched_point *p)
+{
+    return p->rpm > 0 && p->rpm <= RPM_MAX &&
+           p->kp >= 0.0f && p->ki > 0.0f && p->ff_gain >= 0.0f;
+}
+
+static bool gs_table_valid(const struct gain_sched_table *t)
+{
+    if (t->n < 1 || t->n > GAIN_SCHED_MAX_POINTS) {
+        return false;
+    }
+    for (uint8_t i = 0; i < t->n; i++) {
+        if (!gs_point_valid(&t->pt[i]) ||
+            (i > 0 && t->pt[i].rpm <= t->pt[i - 1].rpm)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void gs_interpolate(float rpm, struct gain_sched_point *out)
+{
+    const struct gain_sched_point *pt = gs_active.pt;
+    uint8_t n = gs_active.n;
+
+    if (rpm <= (float)pt[0].rpm) {
+        *out = pt[0];
+        return;
+    }
+    if (rpm >= (float)pt[n - 1].rpm) {
+        *out = pt[n - 1];
+        return;
+    }
+
+    uint8_t i = 1;
+    while ((float)pt[i].rpm < rpm) {
+        i++;
+    }
+    const struct gain_sched_point *a = &pt[i - 1];
+    const struct gain_sched_point *b = &pt[i];
+    float f = (rpm - (float)a->rpm) / (float)(b->rpm - a->rpm);
+
+    out->rpm       = (int32_t)rpm;
+    out->kp        = a->kp        + f * (b->kp        - a->kp);
+    out->ki        = a->ki        + f * (b->ki        - a->ki);
+    out->ff_gain   = a->ff_gain   + f * (b->ff_gain   - a->ff_gain);
+    out->ff_offset = a->ff_offset + f * (b->ff_offset - a->ff_offset);
+}
+
+/* ========================================================================= *
+ * PERSISTENCE                                                               *
+ * ========================================================================= *
+ * One record, the whole table, next to the parameters: params_init()'s   *
+ * settings load fills gs_saved before the PID thread starts, and every    *
+ * gain_sched_reset() after that starts from it instead of the defaults.  */
+#ifdef CONFIG_MOTOR_PARAMS_PERSIST
+static int gs_h_set(const char *name, size_t len,
+                    settings_read_cb read_cb, void *cb_arg)
+{
+    const char *next;
+    if (!settings_name_steq(name, "table", &next) || next) {
+        return -ENOENT;
+    }
+
+    struct gain_sched_table t;
+    if (len != sizeof(t) || read_cb(cb_arg, &t, sizeof(t)) != sizeof(t) ||
+        !gs_table_valid(&t)) {
+        LOG_WRN("Saved gain schedule ignored");
+        return 0;
+    }
+    gs_saved       = t;         // boot, before the PID thread
+    gs_saved_valid = true;
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(motor_gsched, "motor/gsched", NULL, gs_h_set,
+                               NULL, NULL);
+#endif
+
+/* ========================================================================= *
+ * PUBLIC API                                                                *
+ * ========================================================================= */
+void gain_sched_reset(const struct gain_sched_table *defaults)
+{
+    k_spinlock_key_t key = k_spin_lock(&gs_lock);
+    gs_pending_valid = false;
+    k_spin_unlock(&gs_lock, key);
+
+#ifdef CONFIG_MOTOR_PARAMS_PERSIST
+    gs_active   = gs_saved_valid ? gs_saved : *defaults;
+#else
+    gs_active   = *defaults;
+#endif
+    gs_last_rpm = 0.0f;
+    gs_publish();
+}
+
+int gain_sched_load(const struct gain_sched_table *t)
+{
+    if (!gs_table_valid(t)) {
+        return -EINVAL;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&gs_lock);
+    gs_pending       = *t;
+    gs_pending_valid = true;
+    k_spin_unlock(&gs_lock, key);
+    return 0;
+}
+
+void gain_sched_set_point(const struct gain_sched_point *p)
+{
+    struct gain_sched_table *t = &gs_active;
+
+    if (!gs_point_valid(p)) {
+        LOG_WRN("Schedule point @%d rpm rejected", p->rpm);
+        return;
+    }
+
+    // Nearest point by speed, and where p would go in order
+    uint8_t near = 0, pos = 0;
+    for (uint8_t i = 0; i < t->n; i++) {
+        if (abs(t->pt[i].rpm - p->rpm) < abs(t->pt[near].rpm - p->rpm)) {
+            near = i;
+        }
+        if (t->pt[i].rpm < p->rpm) {
+            pos = i + 1;
+        }
+    }
+
+    if (abs(t->pt[near].rpm - p->rpm) * 100 <= p->rpm * GAIN_SCHED_MERGE_PCT ||
+        t->n == GAIN_SCHED_MAX_POINTS) {
+        /* Replacing the nearest keeps the order: no other point lies
+         * between it and p.                                           */
+        t->pt[near] = *p;
+    } else {
+        memmove(&t->pt[pos + 1], &t->pt[pos], (t->n - pos) * sizeof(t->pt[0]));
+        t->pt[pos] = *p;
+        t->n++;
+    }
+
+    LOG_INF("Schedule point @%d rpm: kp=%.4f  ki=%.4f  ff=%.5f%+.2f  (%u points)",
+            p->rpm, (double)p->kp, (double)p->ki, (double)p->ff_gain,
+            (double)p->ff_offset, t->n);
+    gs_publish();
+}
+
+bool gain_sched_update(float rpm, struct gain_sched_point *out)
+{
+    if (gs_pending_valid) {
+        k_spinlock_key_t key = k_spin_lock(&gs_lock);
+        if (gs_pending_valid) {
+            gs_active        = gs_pending;
+            gs_pending_valid = false;
+        }
+        k_spin_unlock(&gs_lock, key);
+        LOG_INF("Gain schedule loaded (%u points)", gs_active.n);
+        gs_publish();
+    }
+
+    if (rpm < 0.0f) {
+        rpm = -rpm;
+    }
+    float moved = rpm - gs_last_rpm;
+    if (!gs_dirty && moved < GAIN_SCHED_RPM_STEP && moved > -GAIN_SCHED_RPM_STEP) {
+        return false;
+    }
+
+    gs_dirty    = false;
+    gs_last_rpm = rpm;
+    gs_interpolate(rpm, out);
+    return true;
+}
+
+void gain_sched_get(struct gain_sched_table *out)
+{
+    uint32_t seq;
+    do {
+        seq  = seqcount_read_begin(&gs_pub_seq);
+        *out = gs_pub;
+    } while (seqcount_read_retry(&gs_pub_seq, seq));
+}
+
+int gain_sched_save(void)
+{
+#ifdef CONFIG_MOTOR_PARAMS_PERSIST
+    struct gain_sched_table t;
+    gain_sched_get(&t);
+
+    int err = settings_save_one(GAIN_SCHED_KEY, &t, sizeof(t));
+    if (err) {
+        LOG_ERR("Saving the gain schedule failed (err %d)", err);
+        return err;
+    }
+    LOG_INF("Gain schedule saved (%u points)", t.n);
+    return 0;
+#else
+    return -ENOTSUP;
+#endif
+}
@@ -0,0 +1,231 @@
+#include "hall_comp.h"
+#include "bldc_driver.h"
+#include "motor.h"
+#include "params.h"
+#include "seqcount.h"
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(hall_comp, LOG_LEVEL_INF);
+
+/* ========================================================================= *
+ * CONFIGURATION                                                             *
+ * ========================================================================= *
+ * HC_EDGES intervals per sector put the mean's jitter (hall timing and    *
+ * the speed loop's ripple) well under the 1 % a weight has to resolve:   *
+ * 1.5 s of collecting at 1000 rpm, 0.5 s at 3000.                         */
+#define HC_BAND_PCT         2           // of rpm, never below HC_BAND_MIN
+#define HC_BAND_MIN         10
+#define HC_SETTLE_S         0.5f        // continuous time in band before collecting
+#define HC_SETTLE_MAX_S     5.0f
+#define HC_EDGES            100         // per sector
+#define HC_COLLECT_MAX_S    10.0f
+
+enum hc_phase {
+    HC_PHASE_SETTLE,
+    HC_PHASE_COLLECT,
+};
+
+/* ========================================================================= *
+ * STATE                                                                     *
+ * ========================================================================= */
+static atomic_t hc_request = ATOMIC_INIT(0);    // rpm, 0 = none; any thread
+
+static uint8_t  hc_status;          // enum hall_comp_status, PID thread only
+static uint8_t  hc_phase;           // enum hc_phase
+static int32_t  hc_rpm;
+static bool     hc_in_speed;        // speed mode seen since the start
+static float    hc_t;               // time in the current phase, s
+static float    hc_band_t;          // SETTLE: continuous time in band, s
+
+static struct hall_comp_result hc_work;         // PID thread's copy
+static struct hall_comp_result hc_res;          // published copy, under hc_res_seq
+static seqcount_t              hc_res_seq = SEQCOUNT_INIT;
+
+#ifdef CONFIG_MOTOR_PARAMS_PERSIST
+static void hc_save_work_fn(struct k_work *work)
+{
+    ARG_UNUSED(work);
+    int err = params_save();
+    if (err) {
+        LOG_ERR("Hall weights not saved (err %d)", err);
+    }
+}
+
+static K_WORK_DEFINE(hc_save_work, hc_save_work_fn);
+#endif
+
+/* ========================================================================= *
+ * RUN                                                                       *
+ * ========================================================================= */
+static void hc_publish(const struct hall_comp_result *r)
+{
+    seqcount_write_begin(&hc_res_seq);
+    hc_res = *r;
+    seqcount_write_end(&hc_res_seq);
+}
+
+static void hc_finish(uint8_t error)
+{
+    bldc_hall_cal_stop();
+
+    hc_status      = error ? HALL_COMP_FAILED : HALL_COMP_DONE;
+    hc_work.status = hc_status;
+    hc_work.error  = error;
+    hc_work.run++;
+    hc_publish(&hc_work);
+
+    if (error) {
+        LOG_WRN("Hall calibration @%d rpm failed: error %u", hc_rpm, error);
+    } else {
+        LOG_INF("Hall weights @%d rpm, %u edges: %.4f %.4f %.4f %.4f %.4f %.4f",
+                hc_rpm, hc_work.edges,
+                (double)hc_work.weight[0], (double)hc_work.weight[1],
+                (double)hc_work.weight[2], (double)hc_work.weight[3],
+                (double)hc_work.weight[4], (double)hc_work.weight[5]);
+    }
+}
+
+static void hc_start(int32_t rpm)
+{
+    hc_status   = HALL_COMP_RUNNING;
+    hc_phase    = HC_PHASE_SETTLE;
+    hc_rpm      = rpm;
+    hc_in_speed = false;
+    hc_t        = 0.0f;
+    hc_band_t   = 0.0f;
+
+    hc_work.run++;
+    hc_work.status = HALL_COMP_RUNNING;
+    hc_work.error  = HALL_COMP_OK;
+    hc_work.rpm    = rpm;
+    hc_work.edges  = 0;
+    hc_publish(&hc_work);
+}
+
+/** Weights from the sector means; stage them as parameters. */
+static uint8_t hc_learn(const uint32_t sum_us[6], const uint16_t n[6])
+{
+    float mean[6];
+    float avg = 0.0f;
+
+    for (int s = 0; s < 6; s++) {
+        mean[s] = (float)sum_us[s] / (float)n[s];
+        avg    += mean[s] / 6.0f;
+    }
+
+    struct param_entry e[6];
+    for (int s = 0; s < 6; s++) {
+        hc_work.weight[s] = avg / mean[s];
+        e[s].id  = PARAM_HALL_COMP_0 + s;
+        e[s].v.f = hc_work.weight[s];
+    }
+    if (params_set(e, 6) != 0) {
+        return HALL_COMP_ERR_RANGE;
+    }
+#ifdef CONFIG_MOTOR_PARAMS_PERSIST
+    k_work_submit(&hc_save_work);
+#endif
+    return HALL_COMP_OK;
+}
+
+static void hc_settle(bool in_band, float dt)
+{
+    hc_band_t = in_band ? hc_band_t + dt : 0.0f;
+    if (hc_band_t >= HC_SETTLE_S) {
+        bldc_hall_cal_start();
+        hc_phase = HC_PHASE_COLLECT;
+        hc_t     = 0.0f;
+    } else if (hc_t > HC_SETTLE_MAX_S) {
+        hc_finish(HALL_COMP_ERR_SETTLE);
+    }
+}
+
+static void hc_collect(bool in_band)
+{
+    if (!in_band) {
+        // A speed change weights sectors unevenly: start over
+        bldc_hall_cal_stop();
+        hc_phase  = HC_PHASE_SETTLE;
+        hc_band_t = 0.0f;
+        return;
+    }
+
+    uint32_t sum_us[6];
+    uint16_t n[6];
+    bldc_hall_cal_read(sum_us, n);
+
+    uint16_t fewest = n[0];
+    for (int s = 1; s < 6; s++) {
+        fewest = MIN(fewest, n[s]);
+    }
+    hc_work.edges = fewest;
+
+    if (fewest >= HC_EDGES) {
+        hc_finish(hc_learn(sum_us, n));
+    } else if (hc_t > HC_COLLECT_MAX_S) {
+        hc_finish(HALL_COMP_ERR_COLLECT);
+    }
+}
+
+/* ========================================================================= *
+ * PUBLIC API                                                                *
+ * ========================================================================= */
+void hall_comp_request(int32_t rpm)
+{
+    atomic_set(&hc_request, (atomic_val_t)rpm);
+}
+
+void hall_comp_reset(void)
+{
+    atomic_set(&hc_request, 0);
+    bldc_hall_cal_stop();
+    if (hc_status == HALL_COMP_RUNNING) {
+        hc_status      = HALL_COMP_IDLE;
+        hc_work.status = HALL_COMP_IDLE;
+        hc_publish(&hc_work);
+    }
+}
+
+void hall_comp_step(uint8_t state, int32_t target_rpm, float filtered_rpm,
+                    float dt)
+{
+    int32_t req = (int32_t)atomic_clear(&hc_request);
+    if (req != 0) {
+        hc_start(req);
+    }
+    if (hc_status != HALL_COMP_RUNNING) {
+        return;
+    }
+
+    if (state == MOTOR_STATE_RUNNING_SPEED) {
+        hc_in_speed = true;
+    }
+    if (target_rpm != hc_rpm ||
+        (hc_in_speed && state != MOTOR_STATE_RUNNING_SPEED)) {
+        hc_finish(HALL_COMP_ERR_ABORTED);
+        return;
+    }
+
+    float band = (float)MAX(hc_rpm * HC_BAND_PCT / 100, HC_BAND_MIN);
+    float err  = filtered_rpm - (float)hc_rpm;
+    bool  in_band = hc_in_speed && bldc_softstart_done() &&
+                    err <= band && err >= -band;
+
+    hc_t += dt;
+    if (hc_phase == HC_PHASE_SETTLE) {
+        hc_settle(in_band, dt);
+    } else {
+        hc_collect(in_band);
+    }
+}
+
+void hall_comp_get_result(struct hall_comp_result *out)
+{
+    uint32_t seq;
+    do {
+        seq  = seqcount_read_begin(&hc_res_seq);
+        *out = hc_res;
+    } while (seqcount_read_retry(&hc_res_seq, seq));
+}
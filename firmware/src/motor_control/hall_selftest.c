@@ -0,0 +1,356 @@
+#include "bldc_hall.h"
+#include "bldc_driver.h"
+#include "bldc_commutation.h"
+#include "bench_clock.h"
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+#include <stdbool.h>
+
+/* ========================================================================= *
+ * HALL SELF-TEST (CONFIG_MOTOR_HALL_SELFTEST)                               *
+ * ========================================================================= *
+ * RPM estimator: each edge sequence is replayed through the hall ISR's    *
+ * running sum (bldc_rpm_window_push() + bldc_rpm_from_sum()) and through  *
+ * the formula it replaced — store the interval, add up the whole window  *
+ * in a loop, divide — and every estimate must be identical. Both get the *
+ * interval capped at the stopped timeout, the one intended change.        *
+ *                                                                           *
+ * The sequences are inter-edge times recorded from the hall ISR: spin-up *
+ * from standstill (softstart, cogging pause), a reversal braking through  *
+ * zero, a 60 rpm crawl, and a 2.5 s stop, which exercises the cap. A long *
+ * pseudo-random sequence spanning debounce to timeout checks the running  *
+ * sum never drifts.                                                        *
+ *                                                                           *
+ * Cost: HALLT_BENCH_N edges of each over the sequence, timed with        *
+ * bench_clock_get() (cycles on target, host ns on native_sim) and         *
+ * reported per edge. Timing is too noisy on a host to assert on, so each  *
+ * side also counts the window slots it reads: the loop must read all      *
+ * BLDC_RPM_WINDOW of them per edge and the running sum exactly one.       *
+ *                                                                           *
+ * Commutation: every hall state 0-7 in both directions is applied to a    *
+ * mock of TIM1's CCR1-3 and CCER twice — once the way the drivers do it   *
+ * from bldc_comm_table, once through the per-case switch the table        *
+ * replaced, with the CCER bits spelled out from RM0434 — and the          *
+ * registers must come out the same. Hall 0 and 7 must be refused by both; *
+ * the switch also cleared CCER on the way, the table leaves the old step  *
+ * (the hall ISR drops both states before commutating anyway).             */
+
+#define HALLT_BENCH_N       2000
+#define HALLT_LCG_EDGES     100000
+
+/* ── Recorded inter-edge times, µs ──────────────────────────────────────── */
+
+static const uint32_t rec_spinup[] = {
+      18825,    6466,    4940,    4290,    3877,    3615,    3995,    4605,
+       5474,    7016,   10977,   22292,    7703,    5160,    4400,    4082,
+       3918,    3914,    3978,    4046,    4118,    4180,    4136,    4048,
+       3924,    3712,    3561,    3394,    3229,    3116,    3012,    2915,
+       2842,    2788,    2734,    2691,    2659,    2627,    2592,    2563,
+       2540,    2510,    2473,    2441,    2417,    2385,    2344,    2310,
+       2283,    2255,    2219,    2184,    2156,    2135,    2107,    2078,
+       2052,    2032,    2014,    1994,    1972,    1953,    1938,    1926,
+       1909,    1891,    1876,    1862,    1852,    1838,    1821,    1805,
+       1790,    1779,    1768,    1754,    1738,    1723,    1710,    1700,
+       1691,    1677,    1663,    1650,    1640,    1631,    1623,    1610,
+       1599,    1587,    1578,    1570,    1562,    1553,    1543,    1532,
+       1523,    1515,    1509,    1502,    1492,    1483,    1473,    1466,
+       1459,    1453,    1446,    1437,    1428,    1419,    1413,    1406,
+       1401,    1395,    1387,    1379,    1372,    1366,    1360,    1355,
+       1351,    1344,    1336,    1329,    1324,    1318,    1313,    1309,
+       1303,    1298,    1291,    1285,    1280,    1275,    1271,    1268,
+       1263,    1257,    1252,    1246,    1242,    1239,    1234,    1232,
+       1227,    1222,    1217,    1212,    1208,    1204,    1200,    1198,
+       1194,    1189,    1184,    1179,    1175,    1171,    1168,    1165,
+};
+
+static const uint32_t rec_reversal[] = {
+       2497,    2497,    2496,    2497,    2496,    2497,    2497,    2497,
+       2499,    2501,    2502,    2502,    2501,    2500,    2499,    2498,
+       2498,    2498,    2498,    2497,    2497,    2497,    2497,    2496,
+       2497,    2497,    2497,    2496,    2497,    2496,    2497,    2497,
+       2500,    2500,    2502,    2502,    2501,    2500,    2499,    2499,
+       2498,    2498,    2497,    2497,    2497,    2497,    2497,    2497,
+       2497,    2496,    2497,    2497,    2496,    2497,    2496,    2502,
+       2511,    2519,    2526,    2540,    2559,    2575,    2590,    2609,
+       2630,    2650,    2672,    2695,    2716,    2740,    2773,    2813,
+       2844,    2882,    2922,    2972,    3012,    3059,    3102,    3153,
+       3210,    3289,    3354,    3433,    3530,    3659,    3800,    3998,
+       4157,    4393,    4624,    4952,    5313,    5841,    6425,    7387,
+       7377,    7205,    8272,   10710,   63287,   20183,   14543,   10869,
+       8831,    7866,    7145,    6515,    5885,    5443,    5056,    4773,
+       4496,    4302,    4093,    3949,    3807,    3683,    3591,    3480,
+       3389,    3317,    3224,    3151,    3092,    3015,    2948,    2898,
+       2844,    2788,    2745,    2711,    2672,    2637,    2611,    2588,
+       2561,    2539,    2522,    2505,    2486,    2470,    2457,    2445,
+       2432,    2422,    2413,    2406,    2397,    2388,    2382,    2379,
+       2379,    2383,    2387,    2390,    2402,    2419,    2432,    2444,
+};
+
+static const uint32_t rec_low_speed[] = {
+      18825,    6466,    4940,    4290,    3877,    3615,    3995,    4605,
+       5474,    7016,   10977,   22725,    8667,    6160,    5579,    5446,
+       5576,    5766,    6494,    7614,    9229,   11920,   11133,    8087,
+       6734,    6393,    6515,    6819,    7555,    8646,    9546,    9228,
+       8118,    7698,    7745,    8097,    8508,    8612,    8398,    8271,
+       8244,    8300,    8383,    8442,    8459,    8428,    8347,    8304,
+       8305,    8331,    8358,    8370,    8375,    8375,    8357,    8339,
+       8340,    8361,    8371,    8374,    8356,    8338,    8341,    8361,
+       8371,    8375,    8376,    8361,    8331,    8310,    8340,    8338,
+       8331,    8328,    8326,    8332,    8356,    8368,    8353,    8336,
+       8330,    8328,    8326,    8327,    8347,    8365,    8362,    8341,
+       8332,    8328,    8327,    8326,    8336,    8354,    8340,    8331,
+       8328,    8326,    8326,    8332,    8357,    8368,    8352,    8336,
+       8330,    8328,    8326,    8327,    8347,    8366,    8361,    8341,
+       8332,    8328,    8327,    8326,    8337,    8347,    8309,    8290,
+};
+
+static const uint32_t rec_stop[] = {
+       1273,    1276,    1278,    1281,    1285,    1287,    1290,    1292,
+       1296,    1299,    1301,    1305,    1307,    1308,    1303,    1297,
+       1291,    1286,    1280,    1275, 2508195,    8982,    5233,    4395,
+       3922,    3589,    3438,    3797,    4315,    5025,    6227,    8671,
+      15291,   14349,    7367,    5272,    4381,    3947,    3777,    3717,
+};
+
+/* ── The estimator before the running sum ───────────────────────────────── */
+
+struct rpm_loop {
+    uint32_t hist[BLDC_RPM_WINDOW];
+    uint8_t  idx;
+    uint32_t reads;         // hist[] slots read
+};
+
+static int32_t rpm_loop_edge(struct rpm_loop *l, uint32_t sample)
+{
+    l->hist[l->idx] = sample;
+    if (++l->idx >= BLDC_RPM_WINDOW) {
+        l->idx = 0;
+    }
+
+    uint32_t sum = 0;
+    for (int i = 0; i < BLDC_RPM_WINDOW; i++) {
+        sum += l->hist[i];
+        l->reads++;
+    }
+
+    int32_t mech_rpm = 0;
+    if (sum > 0) {
+        mech_rpm = (int32_t)((BLDC_RPM_CONSTANT * BLDC_RPM_WINDOW) / sum);
+    }
+    return mech_rpm;
+}
+
+/* ── The hall ISR's estimator ───────────────────────────────────────────── */
+
+static int32_t rpm_sum_edge(struct bldc_rpm_window *w, uint32_t sample)
+{
+    bldc_rpm_window_push(w, sample);
+    return bldc_rpm_from_sum(BLDC_RPM_CONSTANT * BLDC_RPM_WINDOW, w->sum);
+}
+
+static inline uint32_t rpm_cap(uint32_t dt_us)
+{
+    return (dt_us > BLDC_RPM_TIMEOUT_US) ? BLDC_RPM_TIMEOUT_US : dt_us;
+}
+
+static uint32_t lcg_next(uint32_t *s)
+{
+    *s = *s * 1664525U + 1013904223U;
+    return *s >> 8;
+}
+
+/** Pseudo-random interval: mostly running speeds, now and then a stall. */
+static uint32_t lcg_dt(uint32_t *seed)
+{
+    uint32_t r = lcg_next(seed);
+    if ((r & 0xFF) == 0) {
+        return BLDC_RPM_TIMEOUT_US / 2 + lcg_next(seed) % BLDC_RPM_TIMEOUT_US;
+    }
+    return 50U + r % 40000U;
+}
+
+struct hallt_seq {
+    const char     *name;
+    const uint32_t *dt_us;          // NULL: HALLT_LCG_EDGES from the LCG
+    size_t          n;
+};
+
+static const struct hallt_seq hallt_seqs[] = {
+    { "spinup",    rec_spinup,    ARRAY_SIZE(rec_spinup)    },
+    { "reversal",  rec_reversal,  ARRAY_SIZE(rec_reversal)  },
+    { "low_speed", rec_low_speed, ARRAY_SIZE(rec_low_speed) },
+    { "stop",      rec_stop,      ARRAY_SIZE(rec_stop)      },
+    { "lcg",       NULL,          HALLT_LCG_EDGES           },
+};
+
+static int hallt_rpm(const struct hallt_seq *seq)
+{
+    struct bldc_rpm_window w;
+    struct rpm_loop        l = { 0 };
+    uint32_t seed       = 0x4A11C0DEU;
+    uint32_t mismatches = 0;
+    int32_t  max_rpm    = 0;
+
+    /* ── Equivalence ───────────────────────────────────────────────────── */
+    bldc_rpm_window_reset(&w);
+    for (size_t n = 0; n < seq->n; n++) {
+        uint32_t sample = rpm_cap(seq->dt_us ? seq->dt_us[n] : lcg_dt(&seed));
+        int32_t  rpm_l  = rpm_loop_edge(&l, sample);
+        int32_t  rpm_s  = rpm_sum_edge(&w, sample);
+
+        mismatches += (rpm_l != rpm_s) ? 1 : 0;
+        max_rpm     = MAX(max_rpm, rpm_s);
+    }
+
+    /* ── Cost per edge ─────────────────────────────────────────────────── */
+    volatile int32_t sink = 0;
+    size_t table_n = seq->dt_us ? seq->n : 0;
+
+    bldc_rpm_window_reset(&w);
+    l = (struct rpm_loop){ 0 };
+    seed = 0x4A11C0DEU;
+
+    uint32_t t0 = bench_clock_get();
+    for (int n = 0; n < HALLT_BENCH_N; n++) {
+        uint32_t dt = table_n ? seq->dt_us[n % table_n] : 1000U + (uint32_t)n;
+        sink = rpm_loop_edge(&l, rpm_cap(dt));
+    }
+    uint32_t t1 = bench_clock_get();
+    for (int n = 0; n < HALLT_BENCH_N; n++) {
+        uint32_t dt = table_n ? seq->dt_us[n % table_n] : 1000U + (uint32_t)n;
+        sink = rpm_sum_edge(&w, rpm_cap(dt));
+    }
+    uint32_t t2 = bench_clock_get();
+    ARG_UNUSED(sink);
+
+    bool pass = (mismatches == 0) &&
+                (l.reads == (uint32_t)HALLT_BENCH_N * BLDC_RPM_WINDOW) &&
+                (w.reads == HALLT_BENCH_N);
+    printk("HALLT {\"check\":\"rpm\",\"seq\":\"%s\",\"edges\":%u,\"window\":%d,"
+           "\"max_rpm\":%d,\"mismatches\":%u,\"loop_reads\":%u,\"sum_reads\":%u,"
+           "\"loop_" BENCH_CLOCK_UNIT "\":%u,\"sum_" BENCH_CLOCK_UNIT "\":%u,\"pass\":%s}\n",
+           seq->name, (unsigned int)seq->n, BLDC_RPM_WINDOW, max_rpm, mismatches,
+           l.reads / HALLT_BENCH_N, w.reads / HALLT_BENCH_N,
+           (t1 - t0) / HALLT_BENCH_N, (t2 - t1) / HALLT_BENCH_N,
+           pass ? "true" : "false");
+
+    return pass ? 0 : -1;
+}
+
+/* ── Commutation before the table ───────────────────────────────────────── */
+
+#define OLD_CC1E            (1U << 0)       // TIM1->CCER, RM0434
+#define OLD_CC1NE           (1U << 2)
+#define OLD_CC2E            (1U << 4)
+#define OLD_CC2NE           (1U << 6)
+#define OLD_CC3E            (1U << 8)
+#define OLD_CC3NE           (1U << 10)
+#define OLD_CC4E            (1U << 12)      // not a bridge output; must survive
+
+struct tim_mock {
+    uint32_t ccr[3];        // CCR1..CCR3
+    uint32_t ccer;
+};
+
+static const uint8_t old_cw_commutation[8]  = { 0, 6, 5, 4, 3, 2, 1, 0 };
+static const uint8_t old_ccw_commutation[8] = { 0, 1, 2, 3, 4, 5, 6, 0 };
+
+/** @return false if the hall state was refused. */
+static bool comm_switch(struct tim_mock *t, int ccw, uint8_t hall_state, uint32_t pulse)
+{
+    uint8_t comm = ccw ? old_ccw_commutation[hall_state]
+                       : old_cw_commutation[hall_state];
+
+    t->ccer &= ~(OLD_CC1E | OLD_CC1NE | OLD_CC2E | OLD_CC2NE | OLD_CC3E | OLD_CC3NE);
+
+    switch (comm) {
+        case 1: // W+ V-
+            t->ccr[2] = pulse;  t->ccr[1] = 0;
+            t->ccer |= OLD_CC3E | OLD_CC2NE; break;
+        case 2: // V+ U-
+            t->ccr[1] = pulse;  t->ccr[0] = 0;
+            t->ccer |= OLD_CC2E | OLD_CC1NE; break;
+        case 3: // W+ U-
+            t->ccr[2] = pulse;  t->ccr[0] = 0;
+            t->ccer |= OLD_CC3E | OLD_CC1NE; break;
+        case 4: // U+ W-
+            t->ccr[0] = pulse;  t->ccr[2] = 0;
+            t->ccer |= OLD_CC1E | OLD_CC3NE; break;
+        case 5: // U+ V-
+            t->ccr[0] = pulse;  t->ccr[1] = 0;
+            t->ccer |= OLD_CC1E | OLD_CC2NE; break;
+        case 6: // V+ W-
+            t->ccr[1] = pulse;  t->ccr[2] = 0;
+            t->ccer |= OLD_CC2E | OLD_CC3NE; break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+/** As bldc_set_commutation_with_duty() applies a step. */
+static bool comm_table(struct tim_mock *t, int ccw, uint8_t hall_state, uint32_t pulse)
+{
+    const struct bldc_comm_step *step =
+        &bldc_comm_table[ccw ? BLDC_DIR_CCW : BLDC_DIR_CW][hall_state & 0x7];
+
+    if (step->ccer == 0) {
+        return false;
+    }
+    t->ccr[step->high] = pulse;
+    t->ccr[step->low]  = 0;
+    t->ccer = (t->ccer & ~BLDC_CCER_ALL) | step->ccer;
+    return true;
+}
+
+static int hallt_comm(void)
+{
+    static const struct tim_mock before = {
+        .ccr  = { 0xA5A5U, 0x5A5AU, 0xC3C3U },
+        .ccer = OLD_CC4E | OLD_CC1E | OLD_CC1NE | OLD_CC2E | OLD_CC2NE | OLD_CC3E | OLD_CC3NE,
+    };
+    const uint32_t pulse = 1234U;
+    uint32_t states     = 0;
+    uint32_t mismatches = 0;
+
+    for (int ccw = 0; ccw <= 1; ccw++) {
+        for (uint8_t hall = 0; hall < 8; hall++) {
+            struct tim_mock a = before;
+            struct tim_mock b = before;
+            bool ok_a = comm_switch(&a, ccw, hall, pulse);
+            bool ok_b = comm_table(&b, ccw, hall, pulse);
+
+            bool same = (ok_a == ok_b);
+            if (same && ok_a) {
+                same = (a.ccer == b.ccer) && (a.ccr[0] == b.ccr[0]) &&
+                       (a.ccr[1] == b.ccr[1]) && (a.ccr[2] == b.ccr[2]);
+            }
+            if (!same) {
+                printk("HALLT comm mismatch: %s hall %u switch ccer 0x%03x "
+                       "table ccer 0x%03x\n", ccw ? "ccw" : "cw", hall,
+                       a.ccer, b.ccer);
+            }
+            mismatches += same ? 0 : 1;
+            states++;
+        }
+    }
+
+    bool pass = (mismatches == 0);
+    printk("HALLT {\"check\":\"comm\",\"states\":%u,\"mismatches\":%u,\"pass\":%s}\n",
+           states, mismatches, pass ? "true" : "false");
+
+    return pass ? 0 : -1;
+}
+
+int bldc_hall_selftest(void)
+{
+    int fails = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(hallt_seqs); i++) {
+        fails += hallt_rpm(&hallt_seqs[i]) ? 1 : 0;
+    }
+    fails += hallt_comm() ? 1 : 0;
+
+    return fails ? -1 : 0;
+}
@@ -0,0 +1,74 @@
+#include "motion_profile.h"
+#include <math.h>
+#include <stdbool.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(motion_profile, LOG_LEVEL_INF);
+
+/* ========================================================================= *
+ * INITIALISATION                                                            *
+ * ========================================================================= */
+void motion_profile_init(motion_profile_struct *prof, float accel, float decel,
+                         float jerk)
+{
+    prof->accel = accel;
+    prof->decel = decel;
+    prof->jerk  = jerk;
+    prof->vel   = 0.0f;
+    prof->acc   = 0.0f;
+
+    LOG_INF("Profile init: accel=%.0f  decel=%.0f  jerk=%.0f (%s)",
+            (double)accel, (double)decel, (double)jerk,
+            jerk > 0.0f ? "S-curve" : "trapezoid");
+}
+
+void motion_profile_reset(motion_profile_struct *prof, float vel)
+{
+    prof->vel = vel;
+    prof->acc = 0.0f;
+}
+
+/* ========================================================================= *
+ * STEP                                                                      *
+ * ========================================================================= */
+float motion_profile_step(motion_profile_struct *prof, float target, float dt)
+{
+    float err = target - prof->vel;
+    if (err == 0.0f) {
+        prof->acc = 0.0f;
+        return prof->vel;
+    }
+
+    /* Speeding up = moving away from zero in the direction we already go */
+    bool  speeding_up = (prof->vel >= 0.0f) ? (err > 0.0f) : (err < 0.0f);
+    float a_max       = speeding_up ? prof->accel : prof->decel;
+    float dir         = (err > 0.0f) ? 1.0f : -1.0f;
+
+    float a_goal;
+    if (prof->jerk > 0.0f) {
+        /* Largest acceleration that can still be ramped to zero at the jerk
+         * limit by the time the remaining error is used up: a = sqrt(2·j·e) */
+        float a_land = sqrtf(2.0f * prof->jerk * fabsf(err));
+        a_goal = dir * fminf(a_max, a_land);
+
+        float da = a_goal - prof->acc;
+        float dj = prof->jerk * dt;
+        if      (da >  dj) da =  dj;
+        else if (da < -dj) da = -dj;
+        prof->acc += da;
+    } else {
+        prof->acc = dir * a_max;
+    }
+
+    float step = prof->acc * dt;
+
+    /* Landing: never step past the target (also the trapezoid's last tick) */
+    if ((dir > 0.0f && step >= err) || (dir < 0.0f && step <= err)) {
+        prof->vel = target;
+        prof->acc = 0.0f;
+    } else {
+        prof->vel += step;
+    }
+
+    return prof->vel;
+}
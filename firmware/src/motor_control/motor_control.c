@@ -1,11 +1,33 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/sys/atomic.h>
+#include <math.h>
+#include <string.h>
 
 #include "motor_control.h"
 #include "motor.h"
 #include "bldc_driver.h"
 #include "pid.h"
+#include "motion_profile.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "prof.h"
+#include "params.h"
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+#include "speed_fast.h"
+#endif
+#ifdef CONFIG_MOTOR_AUTOTUNE
+#include "autotune.h"
+#endif
+#ifdef CONFIG_MOTOR_GAIN_SCHED
+#include "gain_sched.h"
+#endif
+#ifdef CONFIG_MOTOR_SPEED_OBSERVER
+#include "speed_obs.h"
+#endif
+#ifdef CONFIG_MOTOR_HALL_COMP
+#include "hall_comp.h"
+#endif
 
 LOG_MODULE_REGISTER(motor_control, LOG_LEVEL_INF);
 
@@ -15,128 +37,987 @@ LOG_MODULE_REGISTER(motor_control, LOG_LEVEL_INF);
 #define STACK_SIZE          2048
 #define PRIO_PID            5
 
-#define PID_PERIOD_MS       10
-#define DT                  0.01f
+/* ── Executive rates ───────────────────────────────────────────────────────
+ * A k_timer fires every CONTROL_PERIOD_US; each expiry runs one speed-loop
+ * tick. The supervisor and the telemetry sampler run every Nth tick.    */
+#define CONTROL_RATE_HZ     CONFIG_MOTOR_CONTROL_RATE_HZ
+#define CONTROL_PERIOD_US   (1000000U / CONTROL_RATE_HZ)
+#define SUPERVISOR_DIV      CONFIG_MOTOR_SUPERVISOR_DIV
+#define TELEMETRY_DIV       CONFIG_MOTOR_TELEMETRY_DIV
+#define DT_MAX              (4.0f * CONTROL_PERIOD_US / 1e6f)  // cap after a long stall
 
-#define HALL_TIMEOUT_MS     100U
+#define LOG_PERIOD_MS       1000U
 
-#define STALL_TIMEOUT_MS    5000U
-
-#define RPM_FILTER_ALPHA    0.3f
-#define LOG_EVERY_N_TICKS   100         // 1 second at 100Hz
-
-/* ── PID gains ───────────────────────────────────────────────────────────── */
-#define PID_KP              0.01f
-#define PID_KI              0.01f
-#define PID_INTEGRAL_LIMIT  500.0f
+/* ── PID gains ───────────────────────────────────────────────────────────── *
+ * The gains, like the timeouts and the RPM filter, are runtime parameters *
+ * with their defaults in params.c. Feedforward carries the duty: the sim  *
+ * plant's steady state is close to affine, ~0.3 % + 0.0165 %/rpm from 500 *
+ * to 5000 rpm, so the PI only trims the residual and the integral no      *
+ * longer has to hold the whole duty (at 500 × 0.01 it topped out at 5 %, *
+ * ~1300 rpm). Conditional integration, not back-calculation: a decel      *
+ * saturates at 0 % (a coast, or a full short with the four-quadrant       *
+ * output below) and back-calculation drags the integral down to −FF,      *
+ * which then undershoots the new target. The derivative is light and     *
+ * slow — the hall estimate is too coarse for more.                        */
 #define PID_OUT_MIN         0.0f
 #define PID_OUT_MAX         96.0f
 
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+/* ── Four-quadrant output ──────────────────────────────────────────────── *
+ * rpm_pid's output is the bridge voltage it wants, in % of the bus. At or *
+ * above the back-EMF the sector's drive step delivers it. Below it that   *
+ * step can only coast, since the high side's diode blocks the reversed    *
+ * current, so the low-side brake delivers it instead: shorted for the    *
+ * rest of the period, the windings see the back-EMF against the same     *
+ * average voltage and the current reverses. PID_OUT_MIN is then a full   *
+ * short, not a coast. The back-EMF is taken as a fraction of the         *
+ * feedforward slope, which also carries the resistive drop: without the *
+ * margin a slope a little high puts steady state on the coasting side.  *
+ * The commutation direction follows the setpoint's sign, flipping once  *
+ * the shaft is below REVERSE_RPM; until then the loop is asked for 0 in  *
+ * the old direction and brakes down to it. The brake's torque falls with *
+ * speed, so waiting for 50 rpm costs ~90 ms on the tail; at 200 rpm the  *
+ * new direction's drive step plugs the rest off against under a volt of *
+ * back-EMF. The speed profile then restarts from 0.                      *
+ *                                                                           *
+ * Position moves brake too when the observer supplies the speed. The    *
+ * 6-edge hall speed lags a move of tens of rpm so far that the brake    *
+ * stops the shaft short of a target it still thinks it is closing on,  *
+ * so without it position mode coasts down. Autotune keeps the plant it *
+ * identified.                                                           */
+#define EMF_FF_FRACTION     0.9f
+#define REVERSE_RPM         200
+#endif
+
+#ifdef CONFIG_MOTOR_GAIN_SCHED
+/* ── Default gain schedule ───────────────────────────────────────────────── *
+ * Tuned on the sim bench. Below ~600 rpm (position moves) the hall        *
+ * estimate lags ~35-50 ms, and kp above 0.03 keeps the position move from *
+ * settling; from 2000 rpm the lag is ~12 ms and kp 0.04 takes the        *
+ * step-down overshoot from 9 to 7 % and the load dip from 284 to 269 rpm. *
+ * ki stays at 0.1 throughout: with feedforward holding the duty, more ki  *
+ * mostly winds the integral down during the unpowered coast of a decel   *
+ * (the autotuner's SIMC ki of 0.3-0.7 undershoots the step-down by 20 %).*/
+static const struct gain_sched_table gain_sched_defaults = {
+    .n  = 2,
+    .pt = {
+        /*  rpm    kp      ki     ff_gain           ff_offset */
+        {   600, 0.03f,  0.1f,  0.0165f,  0.3f },
+        {  2000, 0.04f,  0.1f,  0.0165f,  0.3f },
+    },
+};
+#endif
+
+/* ── Motion profiles (setpoint shaping ahead of rpm_pid) ──────────────── *
+ * A step in target speed would saturate the PI at PID_OUT_MAX and wind   *
+ * the integral; shaping the setpoint keeps the error inside the range    *
+ * the PI can track. Jerk 0 = trapezoid.                                   */
+#define SPEED_PROFILE_ACCEL 6000.0f     // RPM/s   — 0→3000 RPM in 0.5s
+#define SPEED_PROFILE_DECEL 6000.0f     // RPM/s
+#define SPEED_PROFILE_JERK  60000.0f    // RPM/s²  — full accel reached in 0.1s
+#define POS_PROFILE_ACCEL   3000.0f     // RPM/s
+#define POS_PROFILE_DECEL   2000.0f     // RPM/s   — also caps approach speed (see below)
+#define POS_PROFILE_JERK    0.0f
+
+/* ── Position loop (outer, P → speed setpoint for rpm_pid) ─────────────── */
+#define POS_KP              3.0f        // RPM per degree of error
+#define POS_MAX_RPM         600         // speed cap during a position move
+#define POS_MIN_RPM         60          // floor outside the band — below this the motor won't turn
+#define POS_HOLD_BAND_CDEG  (BLDC_CDEG_PER_EDGE / 2)   // ±7.50°: stopped, the halls only know the sector
+#define POS_RELEASE_CDEG    BLDC_CDEG_PER_EDGE         // once settled, only move again a sector off
+#define POS_SETTLE_MS       200U        // continuous time inside the band to report settled
+#define POS_REVERSE_RPM     50          // flip commutation direction only below this speed
+
+#define PHASE_ADV_POINTS    4           // PARAM_ADV_RPM_0.. / PARAM_ADV_DEG_0..
+
+#ifndef CONFIG_MOTOR_SIM_VIRTUAL_TIME
 K_THREAD_STACK_DEFINE(pid_stack, STACK_SIZE);
 static struct k_thread pid_thread_data;
+#endif
+
+static void control_timer_expiry(struct k_timer *timer);
+K_TIMER_DEFINE(control_timer, control_timer_expiry, NULL);
+K_SEM_DEFINE(control_tick_sem, 0, 1);
 
 /* ========================================================================= *
  * INTERNAL STATE                                                            *
  * ========================================================================= */
+#ifdef CONFIG_MOTOR_PID_FIXED_POINT
+static pid_q_struct rpm_pid;
+#else
 static pid_struct   rpm_pid;
+#endif
+static motion_profile_struct rpm_profile;
 static float        filtered_rpm = 0.0f;
 static uint32_t     stall_ms     = 0;
 
+/* ── Runtime parameters, PID thread's copy ─────────────────────────────── */
+static uint32_t     hall_timeout_ms;
+static uint32_t     stall_timeout_ms;
+static float        rpm_filter_tau_s;
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+static float        adv_rpm[PHASE_ADV_POINTS];
+static float        adv_deg[PHASE_ADV_POINTS];
+#endif
+
+/* rpm_pid's kp, ki and feedforward: the set live now, and the params' set
+ * as last loaded. An autotune result replaces the live set and stands
+ * until one of those four params changes. */
+struct speed_gains {
+    float kp, ki, ff_gain, ff_offset;
+};
+static struct speed_gains spd_gains;
+#ifndef CONFIG_MOTOR_GAIN_SCHED
+static struct speed_gains spd_param_gains;
+static bool         spd_param_gains_valid = false;
+#endif
+
+static uint32_t     pos_settle_ms = 0;
+static bool         pos_settled   = false;
+static int          pos_dir_ccw   = 0;
+static bool         pos_holding   = false;
+static int32_t      pos_last_target = -1;
+
+static int          last_pulse    = -1;     // last CCR pulse sent, for the trace
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+static float        emf_pulse_per_rpm = 0.0f;   // back-EMF estimate, from speed_set_gains()
+static bool         brake_allowed     = false;  // brake below it in this mode
+#endif
+static uint32_t     log_ms        = 0;
+static uint8_t      last_state    = 0xFF;   // mode the loop last entered
+
+/* ── Executive ──────────────────────────────────────────────────────────── */
+static uint32_t     sup_div       = 0;
+static uint32_t     tel_div       = 0;
+static float        sup_dt        = 0.0f;   // time since the supervisor last ran
+
+/* Speed-loop outputs, read by the supervisor and the telemetry sampler */
+static struct {
+    int32_t raw_rpm;
+    int32_t target_rpm;
+    int32_t pos_cdeg;
+    float   duty;
+} loop_out;
+
+static struct motor_control_timing timing;
+
 extern atomic_t g_motor_speed_atomic;
 
-static void reset_control_state(void)
+/* ── Speed loop back end ───────────────────────────────────────────────────
+ * rpm_pid, run here once per tick, or — with CONFIG_MOTOR_FAST_SPEED_LOOP —
+ * the fixed-point PI in speed_fast.c, run from the PWM interrupt. In the
+ * fast case this thread only hands over the goal each tick and reports
+ * the pulse the interrupt last wrote.                                    */
+static void speed_reset(void)
 {
+#ifdef CONFIG_MOTOR_PID_FIXED_POINT
+    pid_q_reset(&rpm_pid);
+#else
     pid_reset(&rpm_pid);
-    filtered_rpm = 0.0f;
-    stall_ms     = 0;
+#endif
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+    speed_fast_reset();
+#endif
+}
+
+static void reset_control_state(void)
+{
+    speed_reset();
+    motion_profile_reset(&rpm_profile, 0.0f);
+    filtered_rpm  = 0.0f;
+    stall_ms      = 0;
+    pos_settle_ms = 0;
+}
+
+/** @brief Trace the bridge command only when it changes. */
+static void trace_pulse(int pulse)
+{
+    if (pulse != last_pulse) {
+        last_pulse = pulse;
+        trace_record(TRACE_EV_DUTY, 0, (uint16_t)pulse);
+    }
+}
+
+#ifndef CONFIG_MOTOR_FAST_SPEED_LOOP
+/** @brief Drive the bridge; trace the command only when it changes. */
+static void apply_pulse(int pulse)
+{
+    trace_pulse(pulse);
+    bldc_set_pwm(pulse);
+}
+
+/** @brief rpm_pid's output @p pulse at @p speed rpm in the commanded
+ *  direction: the drive step, or with CONFIG_MOTOR_FOUR_QUADRANT the brake
+ *  below the back-EMF. */
+static void apply_output(int pulse, int32_t speed)
+{
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+    if (brake_allowed && (float)pulse < emf_pulse_per_rpm * (float)speed) {
+        trace_pulse(pulse);
+        bldc_set_brake(BLDC_TIM1_ARR - pulse);
+        return;
+    }
+#else
+    ARG_UNUSED(speed);
+#endif
+    apply_pulse(pulse);
+}
+#endif
+
+/** @brief Close the speed loop on @p goal rpm (>= 0) in the commanded direction.
+ *  @return Duty in %, for telemetry. */
+static float speed_drive(int32_t goal, int32_t measured, float dt)
+{
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+    ARG_UNUSED(measured);
+    ARG_UNUSED(dt);
+    speed_fast_set_goal(goal);
+    int pulse = speed_fast_get_pulse();
+    trace_pulse(pulse);
+    return (float)pulse * 100.0f / (float)BLDC_TIM1_ARR;
+#elif defined(CONFIG_MOTOR_PID_FIXED_POINT)
+    int32_t out = pid_q_compute(&rpm_pid, goal, measured,
+                                (uint32_t)(dt * 1e6f + 0.5f));
+    apply_output((int)(((int64_t)out * BLDC_TIM1_ARR / 100) >> PID_Q15_SHIFT),
+                 measured);
+    return (float)out / (float)(1 << PID_Q15_SHIFT);
+#else
+    float duty = pid_compute(&rpm_pid, (float)goal, (float)measured, dt);
+    apply_output(bldc_percent_to_pulse(duty), measured);
+    return duty;
+#endif
+}
+
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+/** @brief Close the speed loop on a signed @p target rpm: pick the
+ *  commutation direction, then track |target| in it.
+ *  @return Duty in %, for telemetry. */
+static float speed_drive_signed(int32_t target, int32_t raw_rpm, float dt)
+{
+    int ccw = bldc_get_direction();
+
+    if (target != 0 && (target < 0) != ccw) {
+        if (filtered_rpm < (float)REVERSE_RPM &&
+            filtered_rpm > -(float)REVERSE_RPM) {
+            ccw = (target < 0);
+            bldc_set_direction(ccw);
+            speed_reset();
+            motion_profile_reset(&rpm_profile, 0.0f);   // ramp up from the stop
+            LOG_INF("Reversing to %s", ccw ? "CCW" : "CW");
+        }
+        target = 0;             // brake down in the old direction first
+    }
+
+    /* The hall speed is signed by the measured direction: in the
+     * commanded one it is negative until the shaft has turned round. */
+    int32_t goal  = ccw ? -target  : target;
+    int32_t speed = ccw ? -raw_rpm : raw_rpm;
+    return speed_drive(goal, speed, dt);
+}
+#endif
+
+/** @brief Park the shaft. With CONFIG_MOTOR_FOUR_QUADRANT all three low
+ *  sides go on and short the windings across the back-EMF; otherwise the
+ *  bridge drives 0 % on the sector's step, which leaves one low side on
+ *  and the shaft coasting. */
+static void speed_hold(void)
+{
+#if defined(CONFIG_MOTOR_FOUR_QUADRANT)
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+    speed_fast_stop();          // no fast tick may overwrite the brake
+#endif
+    trace_pulse(0);
+    bldc_set_brake(BLDC_TIM1_ARR);
+#elif defined(CONFIG_MOTOR_FAST_SPEED_LOOP)
+    speed_fast_set_goal(0);
+    trace_pulse(0);
+#else
+    apply_pulse(0);
+#endif
+}
+
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+/** @brief Brake below the back-EMF from here on (@p on), or only drive. */
+static void speed_allow_brake(bool on)
+{
+    brake_allowed = on;
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+    speed_fast_set_emf(on ? emf_pulse_per_rpm : 0.0f);
+#endif
+}
+#endif
+
+/** @brief Put new PI gains and feedforward live; the integral is rescaled. */
+static void speed_set_gains(float kp, float ki, float ff_gain, float ff_offset)
+{
+    spd_gains = (struct speed_gains){ kp, ki, ff_gain, ff_offset };
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+    emf_pulse_per_rpm = EMF_FF_FRACTION * ff_gain * (float)BLDC_TIM1_ARR / 100.0f;
+    speed_allow_brake(brake_allowed);
+#endif
+#ifdef CONFIG_MOTOR_PID_FIXED_POINT
+    pid_q_set_gains(&rpm_pid, PID_Q15(kp), PID_Q15(ki));
+    pid_q_set_feedforward(&rpm_pid, PID_Q31(ff_gain), PID_Q15(ff_offset));
+#else
+    pid_set_gains(&rpm_pid, kp, ki);
+    pid_set_feedforward(&rpm_pid, ff_gain, ff_offset);
+#endif
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+    speed_fast_set_gains(kp, ki, ff_gain, ff_offset,
+                         param_f32(PARAM_PID_INTEGRAL_LIMIT));
+#endif
+}
+
+/** @brief rpm_pid terms from the active parameters, on a running
+ *  controller. The derivative filter restarts only if kd or d_tau changed,
+ *  and kp, ki and feedforward are reloaded only if one of them changed, so
+ *  an unrelated parameter does not discard autotuned gains. With the gain
+ *  schedule, kp, ki and feedforward are the schedule's. */
+static void speed_load_params(void)
+{
+    float    kd     = param_f32(PARAM_PID_KD);
+    uint32_t tau_us = param_u32(PARAM_PID_D_TAU_US);
+    float    ilim   = param_f32(PARAM_PID_INTEGRAL_LIMIT);
+
+#ifdef CONFIG_MOTOR_PID_FIXED_POINT
+    pid_q_set_integral_limit(&rpm_pid, (int32_t)ilim);
+    if (rpm_pid.kd != PID_Q31(kd) || rpm_pid.d_tau_us != tau_us) {
+        pid_q_set_derivative(&rpm_pid, PID_Q31(kd), tau_us);
+    }
+#else
+    pid_set_integral_limit(&rpm_pid, ilim);
+    if (rpm_pid.kd != kd || rpm_pid.d_tau != (float)tau_us / 1e6f) {
+        pid_set_derivative(&rpm_pid, kd, (float)tau_us / 1e6f);
+    }
+#endif
+#ifndef CONFIG_MOTOR_GAIN_SCHED
+    struct speed_gains g = {
+        param_f32(PARAM_PID_KP),      param_f32(PARAM_PID_KI),
+        param_f32(PARAM_PID_FF_GAIN), param_f32(PARAM_PID_FF_OFFSET),
+    };
+    if (!spd_param_gains_valid || memcmp(&g, &spd_param_gains, sizeof(g)) != 0) {
+        spd_param_gains       = g;
+        spd_param_gains_valid = true;
+        speed_set_gains(g.kp, g.ki, g.ff_gain, g.ff_offset);
+    }
+#endif
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+    // The fast PI's integral clamp is in duty, so it scales with ki
+    speed_fast_set_gains(spd_gains.kp, spd_gains.ki, spd_gains.ff_gain,
+                         spd_gains.ff_offset, ilim);
+#endif
 }
 
+/** @brief Copy the active runtime parameters into the loop and the hall
+ *  core. At boot, at reset, and at the start of a tick after params_set(). */
+static void control_load_params(void)
+{
+    hall_timeout_ms  = param_u32(PARAM_HALL_TIMEOUT_MS);
+    stall_timeout_ms = param_u32(PARAM_STALL_TIMEOUT_MS);
+    rpm_filter_tau_s = (float)param_u32(PARAM_RPM_FILTER_TAU_US) / 1e6f;
+#ifdef CONFIG_MOTOR_SPEED_OBSERVER
+    speed_obs_set_timeout(hall_timeout_ms * 1000U);
+#endif
+
+    bldc_hall_set_tuning(param_u32(PARAM_HALL_DEBOUNCE_US),
+                         bldc_percent_to_pulse(param_f32(PARAM_SOFTSTART_DUTY_PCT)),
+                         bldc_percent_to_pulse(param_f32(PARAM_SOFTSTART_STEP_PCT)),
+                         bldc_percent_to_pulse(param_f32(PARAM_SOFTSTART_END_PCT)));
+    speed_load_params();
+
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+    for (int i = 0; i < PHASE_ADV_POINTS; i++) {
+        adv_rpm[i] = (float)param_u32(PARAM_ADV_RPM_0 + i);
+        adv_deg[i] = param_f32(PARAM_ADV_DEG_0 + i);
+    }
+#endif
+#ifdef CONFIG_MOTOR_HALL_COMP
+    float hall_w[6];
+    for (int s = 0; s < 6; s++) {
+        hall_w[s] = param_f32(PARAM_HALL_COMP_0 + s);
+    }
+    bldc_hall_set_comp(hall_w);
+#endif
+}
+
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+/** @brief Advance for |rpm| from the table, in electrical centidegrees:
+ *  linear between points, the end values beyond them. */
+static int32_t phase_advance_cdeg(float rpm)
+{
+    float w = (rpm < 0.0f) ? -rpm : rpm;
+    float deg;
+
+    if (w <= adv_rpm[0]) {
+        deg = adv_deg[0];
+    } else if (w >= adv_rpm[PHASE_ADV_POINTS - 1]) {
+        deg = adv_deg[PHASE_ADV_POINTS - 1];
+    } else {
+        int i = 1;
+        while (w > adv_rpm[i]) {
+            i++;
+        }
+        float f = (w - adv_rpm[i - 1]) / (adv_rpm[i] - adv_rpm[i - 1]);
+        deg = adv_deg[i - 1] + f * (adv_deg[i] - adv_deg[i - 1]);
+    }
+    return (int32_t)(deg * 100.0f + 0.5f);
+}
+#endif
+
+#ifdef CONFIG_MOTOR_AUTOTUNE
+/* ── Autotune ──────────────────────────────────────────────────────────────
+ * rpm_pid holds the operating point while autotune.c settles; the step and
+ * relay phases drive the bridge open loop. When the experiment ends, a
+ * result goes live and the motor is stopped either way. With the gain
+ * schedule the result becomes (or replaces) the table's point at that
+ * speed; without it, it replaces the fixed gains. Either way it lasts
+ * until motor_control_reset() (boot, or each sim scenario), unless a
+ * params SAVE stores the schedule with it.                              */
+static void speed_set_tuning(const struct autotune_result *r)
+{
+#ifdef CONFIG_MOTOR_GAIN_SCHED
+    struct gain_sched_point p = {
+        .rpm = r->rpm, .kp = r->kp, .ki = r->ki,
+        .ff_gain = r->ff_gain, .ff_offset = r->ff_offset,
+    };
+    gain_sched_set_point(&p);
+#else
+    speed_set_gains(r->kp, r->ki, r->ff_gain, r->ff_offset);
+#endif
+}
+
+static float autotune_drive(int32_t goal, int32_t measured, float dt)
+{
+    float duty;
+    if (autotune_pid_holds()) {
+        duty = speed_drive(goal, measured, dt);
+        autotune_step(measured, duty, dt);
+    } else {
+        duty = autotune_step(measured, 0.0f, dt);
+        apply_pulse(bldc_percent_to_pulse(duty));
+    }
+
+    uint8_t status = autotune_get_status();
+    if (status != AUTOTUNE_RUNNING) {
+        if (status == AUTOTUNE_DONE) {
+            struct autotune_result r;
+            autotune_get_result(&r);
+            speed_set_tuning(&r);
+        }
+        motor_finish_autotune();        // next tick parks; an estop or newer command stands
+    }
+    return duty;
+}
+#endif
+
 /* ========================================================================= *
- * PID CONTROL THREAD                                                        *
+ * POSITION LOOP                                                             *
+ * ========================================================================= *
+ * Outer proportional loop: angle error → signed speed setpoint for the    *
+ * existing rpm_pid. Error takes the shortest path round the circle        *
+ * (wrapped into [-180°, 180°], same as the sim). Inside the hold band the *
+ * setpoint is 0 and, after POS_SETTLE_MS in band, the move is reported    *
+ * settled; the band then widens to POS_RELEASE_CDEG so noise on the       *
+ * position estimate does not restart the move. The band is half a        *
+ * sector: a stopped shaft reads the midpoint of its sector, and every     *
+ * target lies within half a sector of one of those.                       */
+static int32_t position_error_cdeg(int32_t target_deg, int32_t pos_cdeg)
+{
+    int32_t err = target_deg * 100 - pos_cdeg;
+    if (err >  18000) err -= 36000;
+    if (err < -18000) err += 36000;
+    return err;
+}
+
+static int32_t position_speed_setpoint(int32_t target_deg, int32_t pos_cdeg,
+                                       uint32_t loop_dt_ms)
+{
+    int32_t err = position_error_cdeg(target_deg, pos_cdeg);
+
+    int32_t band = pos_settled ? POS_RELEASE_CDEG : POS_HOLD_BAND_CDEG;
+    if (err <= band && err >= -band) {
+        if (!pos_settled) {
+            pos_settle_ms += loop_dt_ms;
+            pos_settled    = (pos_settle_ms >= POS_SETTLE_MS);
+        }
+        return 0;
+    }
+
+    pos_settle_ms = 0;
+    pos_settled   = false;
+
+    /* Never faster than we can stop from in the remaining distance at the
+     * position decel limit: v = sqrt(2·a·d), with 1 RPM = 6 °/s.         */
+    float dist_deg = (float)((err < 0) ? -err : err) / 100.0f;
+    int32_t v_stop = (int32_t)sqrtf(POS_PROFILE_DECEL * dist_deg / 3.0f);
+    int32_t v_cap  = (v_stop < POS_MAX_RPM) ? v_stop : POS_MAX_RPM;
+
+    int32_t rpm = (int32_t)(POS_KP * (float)err / 100.0f);
+    if (rpm >  v_cap) rpm =  v_cap;
+    if (rpm < -v_cap) rpm = -v_cap;
+    if (rpm > 0 && rpm <  POS_MIN_RPM) rpm =  POS_MIN_RPM;
+    if (rpm < 0 && rpm > -POS_MIN_RPM) rpm = -POS_MIN_RPM;
+    return rpm;
+}
+
+#ifdef CONFIG_MOTOR_VAULT_STATS
+/** @brief Log vault lock round-trips and cycles per control tick since the last call. */
+static void log_vault_stats(void)
+{
+    static struct motor_vault_stats prev;
+    static uint32_t prev_ticks;
+    struct motor_vault_stats now;
+
+    motor_get_vault_stats(&now);
+    uint32_t ticks = timing.ticks - prev_ticks;
+    if (ticks == 0) {
+        ticks = 1;
+    }
+    LOG_INF("[VAULT] per tick: writes=%u.%02u  reads=%u.%02u  "
+            "write_cyc=%u  read_cyc=%u  retries=%u",
+            (now.writes - prev.writes) / ticks,
+            ((now.writes - prev.writes) % ticks) * 100 / ticks,
+            (now.reads - prev.reads) / ticks,
+            ((now.reads - prev.reads) % ticks) * 100 / ticks,
+            (now.write_cycles - prev.write_cycles) / ticks,
+            (now.read_cycles - prev.read_cycles) / ticks,
+            now.read_retries - prev.read_retries);
+    prev       = now;
+    prev_ticks = timing.ticks;
+}
+#endif
+
+/** @brief Mode-entry actions. Runs before this tick's setpoint is computed,
+ *  so the profile limits and loop state are already those of the new mode. */
+static void enter_mode(uint8_t target_state, const struct motor_stats *snap)
+{
+#ifdef CONFIG_MOTOR_AUTOTUNE
+    if (last_state == MOTOR_STATE_AUTOTUNE) {
+        autotune_abort();       // no-op if it already finished
+    }
+#endif
+    last_state = target_state;
+    last_pulse = -1;
+    trace_record(TRACE_EV_STATE, target_state,
+                 (uint16_t)((target_state == MOTOR_STATE_RUNNING_POS)
+                            ? snap->target_position : snap->target_speed));
+#ifdef CONFIG_MOTOR_ESTOP_BREAK
+    /* Any mode but estop re-arms the bridge an estop broke. If one has
+     * landed since this tick's snapshot the outputs stay off and the
+     * next tick enters ESTOP.                                          */
+    if (target_state != MOTOR_STATE_ESTOP && !motor_release_outputs()) {
+        LOG_WRN("Estop raced mode entry — outputs stay off");
+    }
+#endif
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+    speed_allow_brake(target_state == MOTOR_STATE_RUNNING_SPEED ||
+                      (target_state == MOTOR_STATE_RUNNING_POS &&
+                       IS_ENABLED(CONFIG_MOTOR_SPEED_OBSERVER)));
+#endif
+
+    if (target_state == MOTOR_STATE_RUNNING_SPEED) {
+        reset_control_state();  // clear integral before softstart
+        pos_dir_ccw = 0;
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+        bldc_set_direction(snap->target_speed < 0);     // softstart the right way
+#else
+        bldc_set_direction(0);
+#endif
+        motion_profile_init(&rpm_profile, SPEED_PROFILE_ACCEL,
+                            SPEED_PROFILE_DECEL, SPEED_PROFILE_JERK);
+        bldc_set_running();
+        LOG_INF("Motor START — softstart to 15%% then PID");
+
+    } else if (target_state == MOTOR_STATE_RUNNING_POS) {
+        reset_control_state();
+        pos_settled = false;
+        pos_holding = false;
+        motor_set_settled(false);
+        motion_profile_init(&rpm_profile, POS_PROFILE_ACCEL,
+                            POS_PROFILE_DECEL, POS_PROFILE_JERK);
+        pos_dir_ccw = (position_error_cdeg(snap->target_position,
+                                           bldc_get_position_cdeg()) < 0);
+        bldc_set_direction(pos_dir_ccw);
+        /* Softstart's ramp would carry a move of a few sectors past its
+         * target. The observer's speed is good from the first edge, so
+         * the PI can drive from there; the 6-edge hall speed needs the
+         * softstart edges to fill its window.                          */
+#ifdef CONFIG_MOTOR_SPEED_OBSERVER
+        bldc_set_running_direct();
+#else
+        bldc_set_running();
+#endif
+        LOG_INF("Position move START — target %d deg",
+                snap->target_position);
+
+#ifdef CONFIG_MOTOR_AUTOTUNE
+    } else if (target_state == MOTOR_STATE_AUTOTUNE) {
+        reset_control_state();
+        pos_dir_ccw = 0;
+        bldc_set_direction(0);
+        motion_profile_init(&rpm_profile, SPEED_PROFILE_ACCEL,
+                            SPEED_PROFILE_DECEL, SPEED_PROFILE_JERK);
+        bldc_set_running();
+        autotune_start(snap->target_speed);
+#endif
+
+    } else {
+        LOG_WRN("PID inactive — state=0x%02X "
+                "(0x00=stopped  0x03=estop  0x05=fault)",
+                target_state);
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+        speed_fast_stop();      // no fast tick may write the parked bridge
+#endif
+        bldc_set_bootstrap();
+        reset_control_state();
+#ifdef CONFIG_MOTOR_ESTOP_BREAK
+        if (target_state == MOTOR_STATE_ESTOP) {
+            struct motor_estop_stats es;
+            motor_get_estop_stats(&es);
+            LOG_WRN("ESTOP: outputs off %u ns after the command "
+                    "(worst %u ns over %u)",
+                    (uint32_t)k_cyc_to_ns_floor64(es.last_cycles),
+                    (uint32_t)k_cyc_to_ns_floor64(es.max_cycles), es.count);
+        }
+#endif
+        if (pos_settled) {
+            pos_settled = false;
+            motor_set_settled(false);
+        }
+    }
+}
+
+/* ========================================================================= *
+ * SUPERVISOR                                                                *
+ * ========================================================================= *
+ * Feedback validity and fault detection, every SUPERVISOR_DIV ticks: a    *
+ * hall signal older than hall_timeout_ms means the shaft has stopped, and *
+ * a running target with no movement for stall_timeout_ms is a stall.      *
+ * Runs before the speed loop of the same tick so the loop already sees    *
+ * the zeroed speed or the estop. Also owns the once-per-second log.       */
+static void control_supervise(float dt)
+{
+    uint32_t dt_ms      = (uint32_t)(dt * 1000.0f + 0.5f);
+    uint32_t elapsed_ms = bldc_get_rpm_age_ms();
+
+    if (elapsed_ms > hall_timeout_ms || bldc_is_rpm_timed_out()) {
+        atomic_set(&g_motor_speed_atomic, 0);
+    }
+
+    if (loop_out.target_rpm != 0 && loop_out.raw_rpm == 0 && elapsed_ms > 500) {
+        stall_ms += dt_ms;
+        if (stall_ms >= stall_timeout_ms) {
+            LOG_ERR("STALL: tgt=%d RPM, no movement for %ums",
+                    loop_out.target_rpm, stall_timeout_ms);
+            trace_trigger(TRACE_TRIG_STALL);
+            motor_trigger_estop();
+            motor_set_stall_warning(true);
+            reset_control_state();
+        }
+    } else {
+        stall_ms = 0;
+    }
+
+    log_ms += dt_ms;
+    if (log_ms >= LOG_PERIOD_MS) {
+        log_ms = 0;
+        LOG_INF("[PID] raw=%6d  filt=%6d  tgt=%6d  "
+                "age=%5ums  state=0x%02X  stall=%ums",
+                loop_out.raw_rpm, (int32_t)filtered_rpm, loop_out.target_rpm,
+                elapsed_ms, motor_get_full_status(), stall_ms);
+        if (last_state == MOTOR_STATE_RUNNING_POS) {
+            LOG_INF("[POS] pos=%5d.%02d  settled=%d",
+                    loop_out.pos_cdeg / 100, loop_out.pos_cdeg % 100,
+                    pos_settled);
+        }
+#ifdef CONFIG_MOTOR_SPEED_OBSERVER
+        struct speed_obs_result obs;
+        speed_obs_get(&obs);
+        LOG_INF("[OBS] rpm=%6d  pos=%5d.%02d  conf=%u%%",
+                obs.rpm, obs.pos_cdeg / 100, obs.pos_cdeg % 100,
+                obs.confidence);
+#endif
+        LOG_INF("[EXEC] %uHz  ticks=%u  overruns=%u  jitter_max=%uus  dt=%uus",
+                CONTROL_RATE_HZ, timing.ticks, timing.overruns,
+                timing.jitter_max_us, timing.dt_last_us);
+#ifdef CONFIG_MOTOR_VAULT_STATS
+        log_vault_stats();
+#endif
+    }
+}
+
+/* ========================================================================= *
+ * SPEED LOOP                                                                *
  * ========================================================================= */
-static void pid_control_thread(void *p1, void *p2, void *p3)
+static void control_speed_loop(float dt)
 {
-    LOG_INF("PID thread: %uHz  kp=%.3f  ki=%.4f  PP=%d  edges/rev=%d",
-            1000U / PID_PERIOD_MS,
-            (double)PID_KP, (double)PID_KI,
-            4, 24);
+    /* One lock-free snapshot per tick: targets and status all come from
+     * the same vault update instead of separate getter round-trips.   */
+    struct motor_stats snap;
+    motor_get_snapshot(&snap);
 
-    pid_init(&rpm_pid, PID_KP, PID_KI,
-             PID_INTEGRAL_LIMIT, PID_OUT_MIN, PID_OUT_MAX);
+#ifdef CONFIG_MOTOR_SPEED_OBSERVER
+    int32_t raw_rpm = speed_obs_step();
+#else
+    int32_t raw_rpm = (int32_t)atomic_get(&g_motor_speed_atomic);
+#endif
 
-    uint32_t log_tick   = 0;
-    uint8_t  last_state = 0xFF;
+    /* First-order filter set by a time constant, so its bandwidth does not
+     * move with the loop rate or a late tick (23.3 ms = the old alpha 0.3
+     * at 100 Hz) */
+    float alpha  = dt / (rpm_filter_tau_s + dt);
+    filtered_rpm = alpha * (float)raw_rpm + (1.0f - alpha) * filtered_rpm;
 
-    while (1) {
+#ifdef CONFIG_MOTOR_GAIN_SCHED
+    struct gain_sched_point gains;
+    if (gain_sched_update(filtered_rpm, &gains)) {
+        speed_set_gains(gains.kp, gains.ki, gains.ff_gain, gains.ff_offset);
+    }
+#endif
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+    bldc_hall_set_advance(phase_advance_cdeg(filtered_rpm));
+#endif
+
+    int32_t pos_cdeg     = bldc_get_position_cdeg();
+    uint8_t target_state = snap.target_state;
 
-        int32_t raw_rpm = (int32_t)atomic_get(&g_motor_speed_atomic);
+#ifdef CONFIG_MOTOR_HALL_COMP
+    hall_comp_step(target_state, snap.target_speed, filtered_rpm, dt);
+#endif
+
+    if (target_state != last_state) {
+        enter_mode(target_state, &snap);
+    }
+    motor_publish_feedback(last_state, raw_rpm, (int32_t)filtered_rpm,
+                           pos_cdeg / 100);
 
-        uint32_t elapsed_ms = bldc_get_rpm_age_ms();
-        if (elapsed_ms > HALL_TIMEOUT_MS || bldc_is_rpm_timed_out()) {
-            raw_rpm = 0;
-            atomic_set(&g_motor_speed_atomic, 0);
+    /* Speed setpoint for this tick: direct in speed mode, produced by
+     * the outer position loop in position mode.                       */
+    int32_t target_rpm = snap.target_speed;
+    if (target_state == MOTOR_STATE_RUNNING_SPEED ||
+        target_state == MOTOR_STATE_AUTOTUNE) {
+        target_rpm = (int32_t)motion_profile_step(&rpm_profile,
+                                                  (float)snap.target_speed,
+                                                  dt);
+    } else if (target_state == MOTOR_STATE_RUNNING_POS) {
+        if (snap.target_position != pos_last_target) {
+            pos_last_target = snap.target_position;   // new move
+            pos_settled     = false;
+            pos_settle_ms   = 0;
         }
+        bool was_settled = pos_settled;
+        target_rpm = (int32_t)motion_profile_step(&rpm_profile,
+            (float)position_speed_setpoint(snap.target_position, pos_cdeg,
+                                           (uint32_t)(dt * 1000.0f + 0.5f)),
+            dt);
+        if (pos_settled != was_settled) {
+            motor_set_settled(pos_settled);
+        }
+    }
+
+    float duty = 0.0f;      // commanded this tick, for telemetry
 
-        filtered_rpm = RPM_FILTER_ALPHA * (float)raw_rpm
-                     + (1.0f - RPM_FILTER_ALPHA) * filtered_rpm;
+    if (target_state == MOTOR_STATE_RUNNING_SPEED) {
 
-        motor_set_speed(raw_rpm);
-        motor_set_filtered_speed((int32_t)filtered_rpm);
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+        duty = speed_drive_signed(target_rpm, raw_rpm, dt);
+#else
+        duty = speed_drive(target_rpm, raw_rpm, dt);
+#endif
 
-        uint8_t target_state = motor_get_target_state();
-        int32_t target_rpm   = motor_get_target_speed();
+    } else if (target_state == MOTOR_STATE_RUNNING_POS) {
 
-        if (++log_tick >= LOG_EVERY_N_TICKS) {
-            log_tick = 0;
-            LOG_INF("[PID] raw=%6d  filt=%6d  tgt=%6d  "
-                    "age=%5ums  state=0x%02X  stall=%ums",
-                    raw_rpm, (int32_t)filtered_rpm, target_rpm,
-                    elapsed_ms, motor_get_full_status(), stall_ms);
+        /* Commutation direction follows the sign of the setpoint, but
+         * only flips once the shaft has (nearly) stopped; until then the
+         * target is 0 RPM and speed_hold() takes it down: the drive-only
+         * bridge lets it coast, with CONFIG_MOTOR_FOUR_QUADRANT the low
+         * sides brake it.                                               */
+        int want_ccw = (target_rpm < 0);
+        if (target_rpm != 0 && want_ccw != pos_dir_ccw) {
+            if (filtered_rpm < (float)POS_REVERSE_RPM &&
+                filtered_rpm > -(float)POS_REVERSE_RPM) {
+                pos_dir_ccw = want_ccw;
+                bldc_set_direction(pos_dir_ccw);
+                speed_reset();
+            } else {
+                target_rpm = 0;
+            }
         }
 
-        if (target_rpm != 0 && raw_rpm == 0 && elapsed_ms > 500) {
-            stall_ms += PID_PERIOD_MS;
-            if (stall_ms >= STALL_TIMEOUT_MS) {
-                LOG_ERR("STALL: tgt=%d RPM, no movement for %ums",
-                        target_rpm, STALL_TIMEOUT_MS);
-                motor_trigger_estop();
-                motor_set_stall_warning(true);
-                reset_control_state();
+        if (target_rpm == 0) {
+            if (!pos_holding) {
+                pos_holding = true;
+                speed_reset();
             }
+            speed_hold();
         } else {
-            stall_ms = 0;
+            pos_holding = false;
+            int32_t speed = (raw_rpm < 0) ? -raw_rpm : raw_rpm;
+            int32_t goal  = (target_rpm < 0) ? -target_rpm : target_rpm;
+            duty = speed_drive(goal, speed, dt);
         }
 
-        if (target_state == MOTOR_STATE_RUNNING_SPEED) {
+#ifdef CONFIG_MOTOR_AUTOTUNE
+    } else if (target_state == MOTOR_STATE_AUTOTUNE) {
 
-            if (last_state != MOTOR_STATE_RUNNING_SPEED) {
-                last_state = MOTOR_STATE_RUNNING_SPEED;
-                reset_control_state();  // clear integral before softstart
-                bldc_set_running();
-                LOG_INF("Motor START — softstart to 15%% then PID");
-            }
+        duty = autotune_drive(target_rpm, raw_rpm, dt);
+#endif
+    }
 
-            float duty = pid_compute(&rpm_pid,
-                                     (float)target_rpm,
-                                     (float) raw_rpm,
-                                     DT);
-            bldc_set_pwm(bldc_percent_to_pulse(duty));
+    loop_out.raw_rpm    = raw_rpm;
+    loop_out.target_rpm = target_rpm;
+    loop_out.pos_cdeg   = pos_cdeg;
+    loop_out.duty       = duty;
+}
 
-        } else {
+/* ========================================================================= *
+ * CONTROL TICK                                                              *
+ * ========================================================================= *
+ * One CONTROL_PERIOD_US executive tick. Called by the PID thread on every *
+ * control_timer expiry, or directly by the virtual-time simulation runner *
+ * so plant and controller advance in lock-step.                           */
+void motor_control_step(float dt)
+{
+    PROF_BEGIN(t_step);
 
-            if (last_state != target_state) {
-                last_state = target_state;
-                LOG_WRN("PID inactive — state=0x%02X "
-                        "(0x00=stopped  0x03=estop  0x05=fault)",
-                        target_state);
-                bldc_set_bootstrap();
-                reset_control_state();
-            }
+    if (params_apply()) {
+        control_load_params();      // a staged batch goes live together
+    }
+
+    sup_dt += dt;
+    if (++sup_div >= SUPERVISOR_DIV) {
+        sup_div = 0;
+        control_supervise(sup_dt);
+        sup_dt = 0.0f;
+    }
+
+    control_speed_loop(dt);
+
+    if (++tel_div >= TELEMETRY_DIV) {
+        tel_div = 0;
+        telemetry_push(loop_out.raw_rpm, (int32_t)filtered_rpm,
+                       loop_out.target_rpm, loop_out.duty);
+    }
+
+    timing.ticks++;
+    PROF_END(PROF_CONTROL, t_step);
+}
+
+void motor_control_reset(void)
+{
+    params_apply();
+#ifdef CONFIG_MOTOR_PID_FIXED_POINT
+    pid_q_init(&rpm_pid, PID_Q15(param_f32(PARAM_PID_KP)),
+               PID_Q15(param_f32(PARAM_PID_KI)),
+               (int32_t)param_f32(PARAM_PID_INTEGRAL_LIMIT),
+               PID_Q15(PID_OUT_MIN), PID_Q15(PID_OUT_MAX));
+    pid_q_set_antiwindup(&rpm_pid, PID_AW_CONDITIONAL, 0);
+#else
+    pid_init(&rpm_pid, param_f32(PARAM_PID_KP), param_f32(PARAM_PID_KI),
+             param_f32(PARAM_PID_INTEGRAL_LIMIT), PID_OUT_MIN, PID_OUT_MAX);
+    pid_set_antiwindup(&rpm_pid, PID_AW_CONDITIONAL, 0.0f);
+#endif
+#ifndef CONFIG_MOTOR_GAIN_SCHED
+    spd_param_gains_valid = false;  // the fresh rpm_pid has no feedforward yet
+#endif
+    control_load_params();
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+    speed_fast_stop();
+#endif
+#ifdef CONFIG_MOTOR_AUTOTUNE
+    autotune_reset();
+#endif
+#ifdef CONFIG_MOTOR_GAIN_SCHED
+    gain_sched_reset(&gain_sched_defaults);
+#endif
+#ifdef CONFIG_MOTOR_SPEED_OBSERVER
+    speed_obs_reset();
+#endif
+#ifdef CONFIG_MOTOR_HALL_COMP
+    hall_comp_reset();
+#endif
+    reset_control_state();
+    pos_settled     = false;
+    pos_dir_ccw     = 0;
+    pos_holding     = false;
+    pos_last_target = -1;
+    last_pulse      = -1;
+    log_ms          = 0;
+    last_state      = 0xFF;
+    sup_div         = 0;
+    tel_div         = 0;
+    sup_dt          = 0.0f;
+    memset(&loop_out, 0, sizeof(loop_out));
+    memset(&timing, 0, sizeof(timing));
+}
+
+void motor_control_get_timing(struct motor_control_timing *out)
+{
+    *out = timing;  // word-sized fields; a torn read only mixes adjacent ticks
+}
+
+/* ========================================================================= *
+ * PID CONTROL THREAD                                                        *
+ * ========================================================================= *
+ * Paced by control_timer, not by sleeping after the work: the period no   *
+ * longer stretches by the loop's own run time or its logging. dt is the   *
+ * measured time between wake-ups — the kernel tick may not divide the     *
+ * period exactly — and a tick that runs past the next expiry is counted   *
+ * as an overrun instead of silently shifting every later tick.            */
+static void control_timer_expiry(struct k_timer *timer)
+{
+    k_sem_give(&control_tick_sem);
+}
+
+#ifndef CONFIG_MOTOR_SIM_VIRTUAL_TIME
+static void pid_control_thread(void *p1, void *p2, void *p3)
+{
+    LOG_INF("PID thread: %uHz  kp=%.3f  ki=%.4f  kd=%.4f  ff=%.4f  PP=%d  edges/rev=%d  "
+            "supervisor=%uHz  telemetry=%uHz",
+            CONTROL_RATE_HZ,
+            (double)param_f32(PARAM_PID_KP), (double)param_f32(PARAM_PID_KI),
+            (double)param_f32(PARAM_PID_KD), (double)param_f32(PARAM_PID_FF_GAIN),
+            BLDC_POLE_PAIRS, BLDC_EDGES_PER_REV,
+            CONTROL_RATE_HZ / SUPERVISOR_DIV, CONTROL_RATE_HZ / TELEMETRY_DIV);
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+    LOG_INF("Speed PI runs in the TIM1 update IRQ at %uHz", SPEED_FAST_RATE_HZ);
+#endif
+
+    motor_control_reset();
+
+    const uint32_t hz = sys_clock_hw_cycles_per_sec();
+    uint32_t last_cyc = k_cycle_get_32();
+
+    k_timer_start(&control_timer, K_USEC(CONTROL_PERIOD_US),
+                  K_USEC(CONTROL_PERIOD_US));
+
+    while (1) {
+        k_sem_take(&control_tick_sem, K_FOREVER);
+
+        uint32_t now_cyc  = k_cycle_get_32();
+        uint32_t expiries = k_timer_status_get(&control_timer);
+        if (expiries > 1) {
+            timing.overruns += expiries - 1;
         }
 
-        k_msleep(PID_PERIOD_MS);
+        uint32_t dt_us = (uint32_t)(((uint64_t)(now_cyc - last_cyc) * 1000000U) / hz);
+        last_cyc = now_cyc;
+
+        uint32_t dev_us = (dt_us > CONTROL_PERIOD_US) ? dt_us - CONTROL_PERIOD_US
+                                                      : CONTROL_PERIOD_US - dt_us;
+        if (timing.ticks > 0 && dev_us > timing.jitter_max_us) {
+            timing.jitter_max_us = dev_us;
+        }
+        timing.dt_last_us = dt_us;
+
+        float dt = (float)dt_us / 1e6f;
+        if (dt > DT_MAX) {
+            dt = DT_MAX;
+        }
+        motor_control_step(dt);
     }
 }
+#endif
 
 /* ========================================================================= *
  * INITIALIZATION                                                            *
@@ -145,11 +1026,16 @@ int motor_control_init(void)
 {
     LOG_INF("Initializing motor control...");
 
+#ifdef CONFIG_MOTOR_SIM_VIRTUAL_TIME
+    /* No thread: the sim runner calls motor_control_step() on its clock */
+    motor_control_reset();
+#else
     k_thread_create(&pid_thread_data, pid_stack,
                     K_THREAD_STACK_SIZEOF(pid_stack),
                     pid_control_thread, NULL, NULL, NULL,
                     PRIO_PID, 0, K_NO_WAIT);
 
     k_thread_name_set(&pid_thread_data, "pid_ctrl");
+#endif
     return 0;
 }
\ No newline at end of file
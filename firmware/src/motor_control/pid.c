@@ -15,6 +15,15 @@ void pid_init(pid_struct *pid, float kp, float ki,
     pid->integral_limit = integral_limit;
     pid->out_min        = out_min;
     pid->out_max        = out_max;
+    pid->kd             = 0.0f;
+    pid->d_tau          = 0.0f;
+    pid->d_filt         = 0.0f;
+    pid->prev_measured  = 0.0f;
+    pid->d_primed       = false;
+    pid->ff_gain        = 0.0f;
+    pid->ff_offset      = 0.0f;
+    pid->aw_mode        = PID_AW_CLAMP;
+    pid->kaw            = 0.0f;
 
     LOG_INF("PID init: kp=%.4f  ki=%.5f  ilim=%.1f  out=[%.1f, %.1f]",
             (double)kp, (double)ki,
@@ -22,6 +31,44 @@ void pid_init(pid_struct *pid, float kp, float ki,
             (double)out_min, (double)out_max);
 }
 
+void pid_set_gains(pid_struct *pid, float kp, float ki)
+{
+    if (ki != 0.0f) {
+        pid->integral *= pid->ki / ki;
+    } else {
+        pid->integral = 0.0f;
+    }
+    pid->kp = kp;
+    pid->ki = ki;
+}
+
+void pid_set_integral_limit(pid_struct *pid, float integral_limit)
+{
+    pid->integral_limit = integral_limit;
+    if      (pid->integral >  integral_limit) pid->integral =  integral_limit;
+    else if (pid->integral < -integral_limit) pid->integral = -integral_limit;
+}
+
+void pid_set_derivative(pid_struct *pid, float kd, float tau_s)
+{
+    pid->kd       = kd;
+    pid->d_tau    = tau_s;
+    pid->d_filt   = 0.0f;
+    pid->d_primed = false;
+}
+
+void pid_set_feedforward(pid_struct *pid, float ff_gain, float ff_offset)
+{
+    pid->ff_gain   = ff_gain;
+    pid->ff_offset = ff_offset;
+}
+
+void pid_set_antiwindup(pid_struct *pid, enum pid_antiwindup mode, float kaw)
+{
+    pid->aw_mode = mode;
+    pid->kaw     = kaw;
+}
+
 /* ========================================================================= *
  * PID COMPUTE                                                               *
  * ========================================================================= */
@@ -34,18 +81,48 @@ float pid_compute(pid_struct *pid, float target, float measured, float dt)
     if      (pid->integral >  pid->integral_limit) pid->integral =  pid->integral_limit;
     else if (pid->integral < -pid->integral_limit) pid->integral = -pid->integral_limit;
 
+    /* Derivative on measurement through a first-order low-pass. The first
+     * call after init/reset only primes prev_measured.                 */
+    float d_term = 0.0f;
+    if (pid->kd != 0.0f && dt > 0.0f) {
+        if (pid->d_primed) {
+            float slope = (measured - pid->prev_measured) / dt;
+            pid->d_filt += (slope - pid->d_filt) * dt / (pid->d_tau + dt);
+        }
+        pid->prev_measured = measured;
+        pid->d_primed      = true;
+        d_term = -pid->kd * pid->d_filt;
+    }
+
+    float ff_term = 0.0f;
+    if (target > 0.0f)      ff_term = pid->ff_gain * target + pid->ff_offset;
+    else if (target < 0.0f) ff_term = pid->ff_gain * target - pid->ff_offset;
+
     float p_term  = pid->kp * error;
     float i_term  = pid->ki * pid->integral;
-    float raw_out = p_term + i_term;
+    float raw_out = ff_term + p_term + i_term + d_term;
 
     float output = raw_out;
     if      (output > pid->out_max) output = pid->out_max;
     else if (output < pid->out_min) output = pid->out_min;
 
+    /* Anti-windup beyond the integral_limit clamp, see pid.h */
+    if (output != raw_out) {
+        if (pid->aw_mode == PID_AW_CONDITIONAL) {
+            // Undo this step's accumulation if it pushed further into the rail
+            if ((output - raw_out) * error < 0.0f) {
+                pid->integral -= error * dt;
+            }
+        } else if (pid->aw_mode == PID_AW_BACK_CALC && pid->ki != 0.0f) {
+            pid->integral += pid->kaw * (output - raw_out) / pid->ki * dt;
+        }
+    }
+
     LOG_DBG("tgt=%6.0f  meas=%6.0f  err=%7.1f  "
-            "P=%7.2f  I=%7.2f  raw=%7.2f  out=%6.2f  integ=%7.2f",
+            "P=%7.2f  I=%7.2f  D=%7.2f  FF=%6.2f  raw=%7.2f  out=%6.2f  integ=%7.2f",
             (double)target,   (double)measured,  (double)error,
-            (double)p_term,   (double)i_term,    (double)raw_out,
+            (double)p_term,   (double)i_term,    (double)d_term,
+            (double)ff_term,  (double)raw_out,
             (double)output,   (double)pid->integral);
 
     return output;
@@ -57,5 +134,141 @@ float pid_compute(pid_struct *pid, float target, float measured, float dt)
 void pid_reset(pid_struct *pid)
 {
     pid->integral = 0.0f;
+    pid->d_filt   = 0.0f;
+    pid->d_primed = false;
     LOG_INF("PID reset — integral cleared");
+}
+
+/* ========================================================================= *
+ * FIXED-POINT PID                                                           *
+ * ========================================================================= */
+void pid_q_init(pid_q_struct *pid, int32_t kp_q15, int32_t ki_q15,
+                int32_t integral_limit, int32_t out_min_q15, int32_t out_max_q15)
+{
+    pid->kp             = kp_q15;
+    // ki per second → per µs, rounded, with PID_Q_KI_SHIFT extra bits
+    pid->ki_us          = (int32_t)((((int64_t)ki_q15 << PID_Q_KI_SHIFT) + 500000) / 1000000);
+    pid->integral       = 0;
+    pid->integral_limit = (int64_t)integral_limit * 1000000;
+    pid->out_min        = out_min_q15;
+    pid->out_max        = out_max_q15;
+    pid->kd             = 0;
+    pid->d_tau_us       = 0;
+    pid->d_filt         = 0;
+    pid->prev_measured  = 0;
+    pid->d_primed       = false;
+    pid->ff_gain        = 0;
+    pid->ff_offset      = 0;
+    pid->aw_mode        = PID_AW_CLAMP;
+    pid->aw_q16         = 0;
+
+    LOG_INF("PID-Q init: kp=%d ki=%d (Q15)  ilim=%d  out=[%d, %d] (Q15)",
+            kp_q15, ki_q15, integral_limit, out_min_q15, out_max_q15);
+}
+
+void pid_q_set_gains(pid_q_struct *pid, int32_t kp_q15, int32_t ki_q15)
+{
+    int32_t ki_us = (int32_t)((((int64_t)ki_q15 << PID_Q_KI_SHIFT) + 500000) / 1000000);
+
+    if (ki_us != 0) {
+        pid->integral = pid->integral * pid->ki_us / ki_us;
+        pid->aw_q16   = (int32_t)((int64_t)pid->aw_q16 * pid->ki_us / ki_us);   // kaw / ki
+    } else {
+        pid->integral = 0;
+    }
+    pid->kp    = kp_q15;
+    pid->ki_us = ki_us;
+}
+
+void pid_q_set_integral_limit(pid_q_struct *pid, int32_t integral_limit)
+{
+    pid->integral_limit = (int64_t)integral_limit * 1000000;
+    if      (pid->integral >  pid->integral_limit) pid->integral =  pid->integral_limit;
+    else if (pid->integral < -pid->integral_limit) pid->integral = -pid->integral_limit;
+}
+
+void pid_q_set_derivative(pid_q_struct *pid, int32_t kd_q31, uint32_t tau_us)
+{
+    pid->kd       = kd_q31;
+    pid->d_tau_us = tau_us;
+    pid->d_filt   = 0;
+    pid->d_primed = false;
+}
+
+void pid_q_set_feedforward(pid_q_struct *pid, int32_t ff_gain_q31,
+                           int32_t ff_offset_q15)
+{
+    pid->ff_gain   = ff_gain_q31;
+    pid->ff_offset = ff_offset_q15;
+}
+
+void pid_q_set_antiwindup(pid_q_struct *pid, enum pid_antiwindup mode,
+                          int32_t kaw_q15)
+{
+    // ki per second back in Q15 from ki_us; init rounded it from one
+    int64_t ki_q15 = ((int64_t)pid->ki_us * 1000000 + (1 << (PID_Q_KI_SHIFT - 1)))
+                     >> PID_Q_KI_SHIFT;
+
+    pid->aw_mode = mode;
+    pid->aw_q16  = (ki_q15 != 0) ? (int32_t)(((int64_t)kaw_q15 << 16) / ki_q15) : 0;
+}
+
+int32_t pid_q_compute(pid_q_struct *pid, int32_t target, int32_t measured,
+                      uint32_t dt_us)
+{
+    int32_t error = target - measured;
+
+    /* Integral accumulation with anti-windup clamp */
+    pid->integral += (int64_t)error * dt_us;
+    if      (pid->integral >  pid->integral_limit) pid->integral =  pid->integral_limit;
+    else if (pid->integral < -pid->integral_limit) pid->integral = -pid->integral_limit;
+
+    /* Derivative on measurement. The low-pass is folded into one divide:
+     * d += (Δm/dt − d)·dt/(tau + dt) = (Δm·1e6 − d·dt)/(tau + dt).     */
+    int64_t d_term = 0;
+    if (pid->kd != 0 && dt_us > 0) {
+        if (pid->d_primed) {
+            int64_t num = (int64_t)(measured - pid->prev_measured) * 1000000 -
+                          (int64_t)pid->d_filt * dt_us;
+            pid->d_filt += (int32_t)(num / (int64_t)(pid->d_tau_us + dt_us));
+        }
+        pid->prev_measured = measured;
+        pid->d_primed      = true;
+        d_term = -(((int64_t)pid->kd * pid->d_filt) >> 16);
+    }
+
+    int64_t ff_term = 0;
+    if (target != 0) {
+        ff_term = ((int64_t)pid->ff_gain * target) >> 16;
+        ff_term += (target > 0) ? pid->ff_offset : -pid->ff_offset;
+    }
+
+    int64_t p_term  = (int64_t)pid->kp * error;
+    int64_t i_term  = (pid->integral * pid->ki_us) >> PID_Q_KI_SHIFT;
+    int64_t raw_out = ff_term + p_term + i_term + d_term;
+
+    int64_t output = raw_out;
+    if      (output > pid->out_max) output = pid->out_max;
+    else if (output < pid->out_min) output = pid->out_min;
+
+    if (output != raw_out) {
+        int64_t excess = output - raw_out;       // Q15, sign opposite the push
+        if (pid->aw_mode == PID_AW_CONDITIONAL) {
+            if ((excess < 0) == (error > 0) && error != 0) {
+                pid->integral -= (int64_t)error * dt_us;
+            }
+        } else if (pid->aw_mode == PID_AW_BACK_CALC) {
+            // Q15 · Q16 → error in Q16, then · µs
+            pid->integral += (((excess * pid->aw_q16) >> PID_Q15_SHIFT) * dt_us) >> 16;
+        }
+    }
+
+    return (int32_t)output;
+}
+
+void pid_q_reset(pid_q_struct *pid)
+{
+    pid->integral = 0;
+    pid->d_filt   = 0;
+    pid->d_primed = false;
 }
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "pid.h"
+#include "bench_clock.h"
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+#include <stdbool.h>
+
+/* ========================================================================= *
+ * PID-Q SELF-TEST (CONFIG_MOTOR_PID_SELFTEST)                               *
+ * ========================================================================= *
+ * Equivalence: for each gain set both controllers get the same pseudo-     *
+ * random target / measurement / dt sequence (fixed-seed LCG), long enough  *
+ * to drive the integral into both clamps and the output onto both rails.  *
+ * The sets cover the plain clamped PI and the derivative / feedforward /  *
+ * anti-windup terms under both anti-windup schemes.                       *
+ * Every pid_q_compute() output must be within PIDQ_TOL_UPCT of the        *
+ * pid_compute() one. The bound is set by Q15 gain rounding: up to 2^-16   *
+ * absolute on kp, i.e. ~0.02 % duty at rpm_pid's 0.01 and 1500 rpm error. *
+ *                                                                           *
+ * Timing: PIDQ_BENCH_N calls of each over a small input table, counted    *
+ * with bench_clock_get() and reported per call: cycles on target, host ns *
+ * on native_sim.                                                           */
+
+#define PIDQ_STEPS          4000
+#define PIDQ_BENCH_N        2000
+#define PIDQ_BENCH_TABLE    32
+#define PIDQ_TOL_UPCT       50000       // 0.05 % duty (1.6 of 3200 counts), in µ%
+
+struct pidq_set {
+    const char *name;
+    float   kp, ki, integral_limit, out_min, out_max;
+    int32_t span_rpm;                   // targets in [0, span], noise ±span/4
+    float   kd, d_tau;                  // optional terms, 0 = off
+    float   ff_gain, ff_offset;
+    uint8_t aw_mode;
+    float   kaw;
+};
+
+static const struct pidq_set pidq_sets[] = {
+    { "pi_clamp",  0.01f, 0.01f, 500.0f,   0.0f,  96.0f, 6000 },
+    { "fast_gain", 0.05f, 0.1f,  960.0f,   0.0f,  96.0f, 6000 },
+    { "signed",    2.0f,  5.0f,   20.0f, -100.0f, 100.0f,  400 },
+    { "rpm_pid",   0.03f, 0.1f,  200.0f,   0.0f,  96.0f, 6000,
+      0.0002f, 0.05f, 0.0165f, 0.3f, PID_AW_CONDITIONAL, 0.0f },
+    { "back_calc", 0.03f, 0.1f,  200.0f,   0.0f,  96.0f, 6000,
+      0.0002f, 0.05f, 0.0165f, 0.3f, PID_AW_BACK_CALC,   5.0f },
+};
+
+static uint32_t lcg_next(uint32_t *s)
+{
+    *s = *s * 1664525U + 1013904223U;
+    return *s >> 8;
+}
+
+struct pidq_input {
+    int32_t  target;
+    int32_t  measured;
+    uint32_t dt_us;
+};
+
+static void pidq_gen(const struct pidq_set *set, uint32_t *seed,
+                     struct pidq_input *in)
+{
+    int32_t noise = set->span_rpm / 4;
+    in->target   = (int32_t)(lcg_next(seed) % (uint32_t)(set->span_rpm + 1));
+    in->measured = in->target +
+                   (int32_t)(lcg_next(seed) % (uint32_t)(2 * noise + 1)) - noise;
+    in->dt_us    = 8000U + lcg_next(seed) % 4001U;     // 10 ms ± 20 %
+}
+
+static void pidq_init_both(const struct pidq_set *set, pid_struct *f,
+                           pid_q_struct *q)
+{
+    pid_init(f, set->kp, set->ki, set->integral_limit, set->out_min,
+             set->out_max);
+    pid_q_init(q, PID_Q15(set->kp), PID_Q15(set->ki),
+               (int32_t)set->integral_limit, PID_Q15(set->out_min),
+               PID_Q15(set->out_max));
+
+    pid_set_derivative(f, set->kd, set->d_tau);
+    pid_set_feedforward(f, set->ff_gain, set->ff_offset);
+    pid_set_antiwindup(f, set->aw_mode, set->kaw);
+    pid_q_set_derivative(q, PID_Q31(set->kd), (uint32_t)(set->d_tau * 1e6f + 0.5f));
+    pid_q_set_feedforward(q, PID_Q31(set->ff_gain), PID_Q15(set->ff_offset));
+    pid_q_set_antiwindup(q, set->aw_mode, PID_Q15(set->kaw));
+}
+
+int pid_q_selftest(void)
+{
+    int fails = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(pidq_sets); i++) {
+        const struct pidq_set *set = &pidq_sets[i];
+        pid_struct   f;
+        pid_q_struct q;
+        uint32_t     seed = 0x5EED0000U + (uint32_t)i;
+        uint32_t     max_err_upct = 0;
+        uint32_t     rail_hits = 0;
+
+        /* ── Equivalence ───────────────────────────────────────────────── */
+        pidq_init_both(set, &f, &q);
+        for (int n = 0; n < PIDQ_STEPS; n++) {
+            struct pidq_input in;
+            pidq_gen(set, &seed, &in);
+
+            float   out_f = pid_compute(&f, (float)in.target, (float)in.measured,
+                                        (float)in.dt_us / 1e6f);
+            int32_t out_q = pid_q_compute(&q, in.target, in.measured, in.dt_us);
+
+            float err = out_f - (float)out_q / (float)(1 << PID_Q15_SHIFT);
+            uint32_t err_upct = (uint32_t)((err < 0.0f ? -err : err) * 1e6f);
+            max_err_upct = MAX(max_err_upct, err_upct);
+            if (out_q == q.out_min || out_q == q.out_max) {
+                rail_hits++;
+            }
+        }
+
+        /* ── Cycles per call ───────────────────────────────────────────── */
+        struct pidq_input table[PIDQ_BENCH_TABLE];
+        for (int n = 0; n < PIDQ_BENCH_TABLE; n++) {
+            pidq_gen(set, &seed, &table[n]);
+        }
+
+        pidq_init_both(set, &f, &q);
+        volatile float   sink_f = 0.0f;
+        volatile int32_t sink_q = 0;
+
+        uint32_t t0 = bench_clock_get();
+        for (int n = 0; n < PIDQ_BENCH_N; n++) {
+            const struct pidq_input *in = &table[n % PIDQ_BENCH_TABLE];
+            sink_f = pid_compute(&f, (float)in->target, (float)in->measured,
+                                 (float)in->dt_us / 1e6f);
+        }
+        uint32_t t1 = bench_clock_get();
+        for (int n = 0; n < PIDQ_BENCH_N; n++) {
+            const struct pidq_input *in = &table[n % PIDQ_BENCH_TABLE];
+            sink_q = pid_q_compute(&q, in->target, in->measured, in->dt_us);
+        }
+        uint32_t t2 = bench_clock_get();
+        ARG_UNUSED(sink_f);
+        ARG_UNUSED(sink_q);
+
+        bool pass = (max_err_upct <= PIDQ_TOL_UPCT) && rail_hits > 0;
+        fails += pass ? 0 : 1;
+
+        printk("PIDQ {\"set\":\"%s\",\"steps\":%d,\"max_err_upct\":%u,"
+               "\"tol_upct\":%d,\"rail_hits\":%u,"
+               "\"float_" BENCH_CLOCK_UNIT "\":%u,\"q_" BENCH_CLOCK_UNIT "\":%u,\"pass\":%s}\n",
+               set->name, PIDQ_STEPS, max_err_upct, PIDQ_TOL_UPCT, rail_hits,
+               (t1 - t0) / PIDQ_BENCH_N, (t2 - t1) / PIDQ_BENCH_N,
+               pass ? "true" : "false");
+    }
+
+    return fails ? -1 : 0;
+}
@@ -0,0 +1,181 @@
+#include "speed_fast.h"
+#include "bldc_driver.h"
+#include "prof.h"
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+/* ========================================================================= *
+ * GAINS                                                                     *
+ * ========================================================================= *
+ * rpm_pid's live continuous gains, feedforward and integral limit, handed *
+ * over by speed_set_gains(): the same PI, run ten to twenty times faster. *
+ * At 1 kHz the sample-and-hold lag is a tenth of the 100 Hz thread's.    *
+ * Above 1 kHz the hall estimator's window, not the update rate, is the   *
+ * dominant delay.                                                          *
+ *                                                                           *
+ * Fixed point: error in rpm, output and integrator in Q16 pulse counts.   *
+ * Feedforward is rpm_pid's: ff_gain × goal + ff_offset for a goal above   *
+ * 0, so the integrator only trims the error around it. The integrator is *
+ * clamped to ±ki × the integral limit, as rpm_pid's integral is, and to  *
+ * the output range, and like rpm_pid's it stops integrating into a       *
+ * saturated output (PID_AW_CONDITIONAL).                                  *
+ * With CONFIG_MOTOR_FOUR_QUADRANT and a back-EMF estimate set (speed     *
+ * mode), an output below it brakes instead, as rpm_pid's does (see      *
+ * motor_control.c), and a goal of 0 shorts the windings.                 */
+#define FAST_OUT_MAX_PCT    96          // same ceiling as rpm_pid
+
+#define Q16_ONE             65536
+#define PULSE_PER_PCT       (BLDC_TIM1_ARR / 100.0f)           // 32 counts per %
+#define OUT_MAX_Q16         ((int64_t)(BLDC_TIM1_ARR * FAST_OUT_MAX_PCT / 100) * Q16_ONE)
+#define IDLE                INT32_MIN
+
+/* Per-tick integer form of one gain set. */
+struct fast_gains {
+    int32_t kp_q16;         // Q16 pulses per rpm
+    int32_t ki_q16;         // Q16 pulses per rpm·tick
+    int32_t ff_q16;         // Q16 pulses per rpm of goal
+    int32_t ffo_q16;        // Q16 pulses, added to a goal above 0
+    int64_t ilim_q16;       // integrator bound, Q16 pulses
+};
+
+/* ========================================================================= *
+ * STATE                                                                     *
+ * ========================================================================= *
+ * Two gain sets: the thread fills the one the tick is not using, then     *
+ * flips fast_gains_idx. The tick preempts the thread, never the reverse, *
+ * so it always reads a complete set.                                      */
+static struct fast_gains fast_gains[2];
+static atomic_t     fast_gains_idx = ATOMIC_INIT(0);
+static atomic_t     fast_goal      = ATOMIC_INIT(IDLE);
+static atomic_t     fast_reset_req = ATOMIC_INIT(0);
+static int64_t      fast_integ;             // Q16 pulse counts, ISR only
+static volatile int fast_pulse;
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+static atomic_t     fast_emf_q16;           // back-EMF, Q16 pulse counts per rpm
+#endif
+
+/* ========================================================================= *
+ * THREAD SIDE                                                               *
+ * ========================================================================= */
+void speed_fast_set_goal(int32_t goal_rpm)
+{
+    atomic_set(&fast_goal, (atomic_val_t)((goal_rpm > 0) ? goal_rpm : 0));
+}
+
+void speed_fast_stop(void)
+{
+    atomic_set(&fast_goal, (atomic_val_t)IDLE);
+    atomic_set(&fast_reset_req, 1);
+}
+
+void speed_fast_reset(void)
+{
+    atomic_set(&fast_reset_req, 1);
+}
+
+int speed_fast_get_pulse(void)
+{
+    return fast_pulse;
+}
+
+void speed_fast_set_gains(float kp, float ki, float ff_gain, float ff_offset,
+                          float integral_limit)
+{
+    struct fast_gains *g = &fast_gains[!atomic_get(&fast_gains_idx)];
+    float ilim = ki * integral_limit * PULSE_PER_PCT;
+
+    g->kp_q16   = (int32_t)(kp * PULSE_PER_PCT * Q16_ONE + 0.5f);
+    g->ki_q16   = (int32_t)(ki * PULSE_PER_PCT * Q16_ONE *
+                            (SPEED_FAST_PERIOD_US / 1e6f) + 0.5f);
+    g->ff_q16   = (int32_t)(ff_gain * PULSE_PER_PCT * Q16_ONE + 0.5f);
+    g->ffo_q16  = (int32_t)(ff_offset * PULSE_PER_PCT * Q16_ONE);
+    g->ilim_q16 = (ilim * Q16_ONE < (float)OUT_MAX_Q16)
+                ? (int64_t)(ilim * Q16_ONE) : OUT_MAX_Q16;
+
+    atomic_set(&fast_gains_idx, !atomic_get(&fast_gains_idx));
+}
+
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+void speed_fast_set_emf(float pulse_per_rpm)
+{
+    atomic_set(&fast_emf_q16, (atomic_val_t)(pulse_per_rpm * Q16_ONE + 0.5f));
+}
+#endif
+
+/* ========================================================================= *
+ * FAST TICK                                                                 *
+ * ========================================================================= */
+void speed_fast_tick(void)
+{
+    PROF_BEGIN(t0);
+
+    if (atomic_clear(&fast_reset_req)) {
+        fast_integ = 0;
+    }
+
+    int32_t goal = (int32_t)atomic_get(&fast_goal);
+    if (goal == IDLE) {
+        fast_pulse = 0;
+        return;
+    }
+
+    const struct fast_gains *g = &fast_gains[atomic_get(&fast_gains_idx)];
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+    int32_t emf_q16 = (int32_t)atomic_get(&fast_emf_q16);
+#endif
+    int64_t ff = (goal > 0) ? (int64_t)g->ff_q16 * goal + g->ffo_q16 : 0;
+
+    if (!bldc_softstart_done()) {
+        // Softstart still owns the duty: track it for a bumpless hand-over
+        int64_t integ = (int64_t)bldc_get_pulse() * Q16_ONE - ff;
+        if (integ < -g->ilim_q16) integ = -g->ilim_q16;
+        if (integ >  g->ilim_q16) integ =  g->ilim_q16;
+        fast_integ = integ;
+        fast_pulse = bldc_get_pulse();
+        return;
+    }
+
+    /* The hall estimator signs speed by the commanded direction (with
+     * CONFIG_MOTOR_FOUR_QUADRANT the measured one), so the commanded-
+     * direction speed is just the sign flipped back.                  */
+    int32_t speed = (int32_t)atomic_get(&g_motor_speed_atomic);
+    if (bldc_get_direction()) {
+        speed = -speed;
+    }
+
+    int32_t pulse = 0;
+    if (goal == 0) {
+        fast_integ = 0;
+    } else {
+        int32_t err = goal - speed;
+
+        int64_t integ = fast_integ + (int64_t)g->ki_q16 * err;
+        if (integ < -g->ilim_q16) integ = -g->ilim_q16;
+        if (integ >  g->ilim_q16) integ =  g->ilim_q16;
+
+        int64_t out = (int64_t)g->kp_q16 * err + integ + ff;
+        if (out < 0) {
+            out = 0;
+            integ = (err < 0) ? fast_integ : integ;     // no deeper into the rail
+        } else if (out > OUT_MAX_Q16) {
+            out = OUT_MAX_Q16;
+            integ = (err > 0) ? fast_integ : integ;
+        }
+        fast_integ = integ;
+        pulse = (int32_t)(out >> 16);
+    }
+
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+    if (emf_q16 != 0 &&
+        (goal == 0 || ((int64_t)pulse << 16) < (int64_t)emf_q16 * speed)) {
+        bldc_set_brake(BLDC_TIM1_ARR - pulse);
+    } else {
+        bldc_set_pwm(pulse);
+    }
+#else
+    bldc_set_pwm(pulse);
+#endif
+    fast_pulse = pulse;
+
+    PROF_END(PROF_SPEED_FAST, t0);
+}
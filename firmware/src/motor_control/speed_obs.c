@@ -0,0 +1,215 @@
+#include "speed_obs.h"
+#include "bldc_driver.h"
+#include "bldc_hall.h"
+#include "seqcount.h"
+#include <zephyr/kernel.h>
+
+/* ========================================================================= *
+ * CONFIGURATION                                                             *
+ * ========================================================================= *
+ * ωn·T = SPEED_OBS_WN_T per update, i.e. the loop bandwidth is a fixed    *
+ * fraction of the edge rate (of the tick rate once several edges land in *
+ * one tick). SPEED_OBS_WN_MAX keeps it below where hall placement error  *
+ * (a few electrical degrees per sensor on a real motor) would show up as *
+ * speed ripple at six times the electrical frequency.                    */
+#define SPEED_OBS_ZETA          1.0f
+#define SPEED_OBS_WN_T          0.6f
+#define SPEED_OBS_WN_MAX        600.0f      // rad/s, ~95 Hz
+#define SPEED_OBS_FIT_ALPHA     0.25f       // per edge, |innovation| low-pass
+#define SPEED_OBS_THETA_MAX     0.999f      // edges; stay short of the next edge
+#define SPEED_OBS_RPM_PER_EPS   (60.0f / BLDC_EDGES_PER_REV)
+
+enum {
+    OBS_EMPTY,              // no edge yet
+    OBS_SEEDED,             // angle known, speed not (after reset or a stop)
+    OBS_TRACKING,
+};
+
+/* ========================================================================= *
+ * STATE                                                                     *
+ * ========================================================================= */
+static struct {
+    uint8_t  stage;
+    int32_t  edges;         // edge count the angle is relative to
+    uint32_t edge_time;     // µs, when that edge came
+    uint32_t interval_us;   // between the last two edges used
+    float    theta;         // θ̂ − edges at edge_time, in edges
+    float    omega;         // ω̂, edges/s, + = CW
+    float    fit;           // low-passed |innovation|, in edges
+} obs;                      // PID thread only
+
+static uint32_t obs_timeout_us = 100000;
+
+static struct speed_obs_result obs_pub;     // under obs_pub_seq
+static seqcount_t              obs_pub_seq = SEQCOUNT_INIT;
+
+/* ========================================================================= *
+ * UPDATE                                                                    *
+ * ========================================================================= */
+static void obs_anchor(const struct bldc_edge_snapshot *s)
+{
+    obs.edges     = s->edges;
+    obs.edge_time = s->time_us;
+    obs.theta     = 0.0f;
+}
+
+/** One correction at a new edge, T after the previous one used. */
+static void obs_edge(const struct bldc_edge_snapshot *s)
+{
+    uint32_t t_us  = s->time_us - obs.edge_time;
+    float    moved = (float)(s->edges - obs.edges);
+
+    if (obs.stage == OBS_EMPTY || t_us == 0 || t_us > obs_timeout_us) {
+        /* First edge, or the first after a stop: an angle, no speed yet —
+         * unless a second edge came in the same tick, whose interval is
+         * then a speed from after the stop.                              */
+        obs.fit = 0.0f;
+        obs_anchor(s);
+        if (obs.stage != OBS_EMPTY && (moved >= 2.0f || moved <= -2.0f) &&
+            s->dt_us <= obs_timeout_us) {
+            obs.stage       = OBS_TRACKING;
+            obs.omega       = (float)s->dir * 1e6f / (float)s->dt_us;
+            obs.interval_us = s->dt_us;
+        } else {
+            obs.stage = OBS_SEEDED;
+            obs.omega = 0.0f;
+        }
+        return;
+    }
+
+    float t = (float)t_us * 1e-6f;
+
+    if (obs.stage == OBS_SEEDED) {
+        // Second edge: two-point speed, innovation history starts here
+        obs.stage = OBS_TRACKING;
+        obs.omega = moved / t;
+        obs.fit   = 0.0f;
+    } else {
+        float wn_t = SPEED_OBS_WN_T;
+        if (wn_t > SPEED_OBS_WN_MAX * t) {
+            wn_t = SPEED_OBS_WN_MAX * t;
+        }
+        float k1 = 2.0f * SPEED_OBS_ZETA * wn_t;
+        if (k1 > 1.0f) {
+            k1 = 1.0f;
+        }
+        float k2 = wn_t * wn_t;
+
+        float e = moved - (obs.theta + obs.omega * t);
+        obs.theta  += obs.omega * t + k1 * e - moved;
+        obs.omega  += k2 * e / t;
+        obs.fit    += SPEED_OBS_FIT_ALPHA * ((e < 0.0f ? -e : e) - obs.fit);
+    }
+
+    obs.interval_us = t_us;
+    obs.edges       = s->edges;
+    obs.edge_time   = s->time_us;
+    if (obs.theta > SPEED_OBS_THETA_MAX) {
+        obs.theta = SPEED_OBS_THETA_MAX;
+    } else if (obs.theta < -SPEED_OBS_THETA_MAX) {
+        obs.theta = -SPEED_OBS_THETA_MAX;
+    }
+}
+
+/** Confidence: freshness × fit. Fresh while the next edge is not overdue,
+ *  then falling as interval/silence; fit is 1 − the typical innovation in
+ *  edges, so it drops when the shaft stops moving the way ω̂ predicts
+ *  (load step, hall fault, reversal).                                   */
+static uint8_t obs_confidence(uint32_t since_us)
+{
+    if (obs.stage != OBS_TRACKING) {
+        return 0;
+    }
+    float fresh = 1.0f;
+    if (since_us > obs.interval_us) {
+        fresh = (float)obs.interval_us / (float)since_us;
+    }
+    float fit = (obs.fit < 1.0f) ? 1.0f - obs.fit : 0.0f;
+    return (uint8_t)(100.0f * fresh * fit + 0.5f);
+}
+
+/* ========================================================================= *
+ * PUBLIC API                                                                *
+ * ========================================================================= */
+void speed_obs_reset(void)
+{
+    obs.stage = OBS_EMPTY;
+    obs.omega = 0.0f;
+    obs.theta = 0.0f;
+    obs.fit   = 0.0f;
+
+    seqcount_write_begin(&obs_pub_seq);
+    obs_pub.rpm        = 0;
+    obs_pub.pos_cdeg   = 0;
+    obs_pub.confidence = 0;
+    seqcount_write_end(&obs_pub_seq);
+}
+
+void speed_obs_set_timeout(uint32_t timeout_us)
+{
+    obs_timeout_us = timeout_us;
+}
+
+int32_t speed_obs_step(void)
+{
+    struct bldc_edge_snapshot s;
+    bldc_get_edge_snapshot(&s);
+
+    if (s.dir == 0) {
+        return 0;           // no edge since the hall core was initialised
+    }
+    if (obs.stage == OBS_EMPTY || s.time_us != obs.edge_time) {
+        obs_edge(&s);
+    }
+
+    uint32_t since_us = bldc_hall_now_us() - obs.edge_time;
+    float    since    = (float)since_us * 1e-6f;
+
+    if (since_us > obs_timeout_us) {
+        if (obs.stage == OBS_TRACKING) {
+            obs.stage = OBS_SEEDED;         // stopped: the next edges re-seed
+        }
+        obs.omega = 0.0f;
+    } else if (obs.omega * since > 1.0f) {
+        obs.omega = 1.0f / since;           // overdue: at most one edge in the silence
+    } else if (obs.omega * since < -1.0f) {
+        obs.omega = -1.0f / since;
+    }
+
+    float theta = obs.theta + obs.omega * since;
+    if (theta > SPEED_OBS_THETA_MAX) {
+        theta = SPEED_OBS_THETA_MAX;
+    } else if (theta < -SPEED_OBS_THETA_MAX) {
+        theta = -SPEED_OBS_THETA_MAX;
+    }
+
+    int32_t sector_edge = obs.edges % BLDC_EDGES_PER_REV;
+    if (sector_edge < 0) {
+        sector_edge += BLDC_EDGES_PER_REV;
+    }
+    int32_t cdeg = sector_edge * BLDC_CDEG_PER_EDGE +
+                   (int32_t)(theta * (float)BLDC_CDEG_PER_EDGE);
+    if (cdeg < 0) {
+        cdeg += 36000;
+    } else if (cdeg >= 36000) {
+        cdeg -= 36000;
+    }
+
+    int32_t rpm = (int32_t)(obs.omega * SPEED_OBS_RPM_PER_EPS);
+
+    seqcount_write_begin(&obs_pub_seq);
+    obs_pub.rpm        = rpm;
+    obs_pub.pos_cdeg   = cdeg;
+    obs_pub.confidence = obs_confidence(since_us);
+    seqcount_write_end(&obs_pub_seq);
+    return rpm;
+}
+
+void speed_obs_get(struct speed_obs_result *out)
+{
+    uint32_t seq;
+    do {
+        seq  = seqcount_read_begin(&obs_pub_seq);
+        *out = obs_pub;
+    } while (seqcount_read_retry(&obs_pub_seq, seq));
+}
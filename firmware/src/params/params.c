@@ -0,0 +1,265 @@
+#include "params.h"
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#ifdef CONFIG_MOTOR_PARAMS_PERSIST
+#include <zephyr/settings/settings.h>
+#endif
+
+LOG_MODULE_REGISTER(params, LOG_LEVEL_INF);
+
+/* ========================================================================= *
+ * TABLE                                                                     *
+ * ========================================================================= *
+ * Defaults are the values the constants had as #defines; the rationale    *
+ * for each stays next to the code that uses it. Ranges only keep a typo   *
+ * from disabling a safety timeout or saturating the bridge — they are    *
+ * not tuning advice.                                                       */
+#define PARAM_F_SCHEDULED   0x01        // owned by the gain schedule when it is built in
+#define PARAM_F_THREAD_PID  0x02        // rpm_pid only; the fast speed loop has no such term
+
+struct param_desc {
+    const char       *key;              // settings key under "motor/"
+    uint8_t           type;             // enum param_type
+    uint8_t           flags;
+    union param_value min, max, def;
+};
+
+#define U32F(k, fl, lo, hi, d) { k, PARAM_TYPE_U32, fl, { .u = lo }, { .u = hi }, { .u = d } }
+#define U32(k, lo, hi, d)     U32F(k, 0, lo, hi, d)
+#define F32(k, fl, lo, hi, d) { k, PARAM_TYPE_F32, fl, { .f = lo }, { .f = hi }, { .f = d } }
+
+static const struct param_desc param_table[PARAM_COUNT] = {
+    [PARAM_RPM_FILTER_TAU_US]  = U32("rpm_tau_us",     1000, 500000, 23300),
+    [PARAM_HALL_TIMEOUT_MS]    = U32("hall_to_ms",       10,   2000,   100),
+    [PARAM_STALL_TIMEOUT_MS]   = U32("stall_to_ms",     100,  60000,  5000),
+    [PARAM_HALL_DEBOUNCE_US]   = U32("hall_db_us",        0,   5000,    50),
+    [PARAM_SOFTSTART_DUTY_PCT] = F32("ss_duty",  0, 1.0f,   50.0f,  10.0f),
+    [PARAM_SOFTSTART_STEP_PCT] = F32("ss_step",  0, 0.1f,   10.0f,   1.0f),
+    [PARAM_SOFTSTART_END_PCT]  = F32("ss_end",   0, 1.0f,   60.0f,  15.0f),
+    [PARAM_PID_KP]             = F32("kp",       PARAM_F_SCHEDULED, 0.0f,   1.0f, 0.03f),
+    [PARAM_PID_KI]             = F32("ki",       PARAM_F_SCHEDULED, 0.0f,  10.0f, 0.1f),
+    [PARAM_PID_KD]             = F32("kd",       PARAM_F_THREAD_PID, 0.0f, 0.01f, 0.0002f),
+    [PARAM_PID_D_TAU_US]       = U32F("d_tau_us", PARAM_F_THREAD_PID, 1000, 1000000, 50000),
+    [PARAM_PID_FF_GAIN]        = F32("ff_gain",  PARAM_F_SCHEDULED, 0.0f,   0.05f, 0.0165f),
+    [PARAM_PID_FF_OFFSET]      = F32("ff_off",   PARAM_F_SCHEDULED, -10.0f, 10.0f, 0.3f),
+    [PARAM_PID_INTEGRAL_LIMIT] = F32("ilim",     0, 0.0f, 2000.0f, 200.0f),
+    [PARAM_ADV_RPM_0]          = U32("adv_rpm0",          0,   6000,  3000),
+    [PARAM_ADV_RPM_1]          = U32("adv_rpm1",          0,   6000,  4500),
+    [PARAM_ADV_RPM_2]          = U32("adv_rpm2",          0,   6000,  5500),
+    [PARAM_ADV_RPM_3]          = U32("adv_rpm3",          0,   6000,  6000),
+    [PARAM_ADV_DEG_0]          = F32("adv_deg0", 0, 0.0f,   30.0f,  0.0f),
+    [PARAM_ADV_DEG_1]          = F32("adv_deg1", 0, 0.0f,   30.0f, 10.0f),
+    [PARAM_ADV_DEG_2]          = F32("adv_deg2", 0, 0.0f,   30.0f, 20.0f),
+    [PARAM_ADV_DEG_3]          = F32("adv_deg3", 0, 0.0f,   30.0f, 25.0f),
+    [PARAM_HALL_COMP_0]        = F32("hall_w0",  0, 0.8f,    1.2f,  1.0f),
+    [PARAM_HALL_COMP_1]        = F32("hall_w1",  0, 0.8f,    1.2f,  1.0f),
+    [PARAM_HALL_COMP_2]        = F32("hall_w2",  0, 0.8f,    1.2f,  1.0f),
+    [PARAM_HALL_COMP_3]        = F32("hall_w3",  0, 0.8f,    1.2f,  1.0f),
+    [PARAM_HALL_COMP_4]        = F32("hall_w4",  0, 0.8f,    1.2f,  1.0f),
+    [PARAM_HALL_COMP_5]        = F32("hall_w5",  0, 0.8f,    1.2f,  1.0f),
+};
+
+/* ========================================================================= *
+ * STATE                                                                     *
+ * ========================================================================= */
+static union param_value param_active[PARAM_COUNT];     // PID thread only
+static union param_value param_staged[PARAM_COUNT];     // under param_lock
+static volatile bool     param_pending;
+static struct k_spinlock param_lock;
+
+/* ========================================================================= *
+ * VALIDATION                                                                *
+ * ========================================================================= */
+static bool param_in_range(uint8_t id, union param_value v)
+{
+    const struct param_desc *d = &param_table[id];
+
+    if (d->type == PARAM_TYPE_U32) {
+        return v.u >= d->min.u && v.u <= d->max.u;
+    }
+    return v.f >= d->min.f && v.f <= d->max.f;     // false for NaN
+}
+
+/** @brief Rules between parameters, on a complete candidate table. */
+static bool param_consistent(const union param_value *t)
+{
+    return t[PARAM_SOFTSTART_END_PCT].f >= t[PARAM_SOFTSTART_DUTY_PCT].f &&
+           t[PARAM_ADV_RPM_0].u < t[PARAM_ADV_RPM_1].u &&
+           t[PARAM_ADV_RPM_1].u < t[PARAM_ADV_RPM_2].u &&
+           t[PARAM_ADV_RPM_2].u < t[PARAM_ADV_RPM_3].u;
+}
+
+static bool param_writable(uint8_t id)
+{
+    return !(IS_ENABLED(CONFIG_MOTOR_GAIN_SCHED) &&
+             (param_table[id].flags & PARAM_F_SCHEDULED)) &&
+           !(IS_ENABLED(CONFIG_MOTOR_FAST_SPEED_LOOP) &&
+             (param_table[id].flags & PARAM_F_THREAD_PID));
+}
+
+/* ========================================================================= *
+ * PERSISTENCE                                                               *
+ * ========================================================================= */
+#ifdef CONFIG_MOTOR_PARAMS_PERSIST
+static int params_h_set(const char *name, size_t len,
+                        settings_read_cb read_cb, void *cb_arg)
+{
+    for (uint8_t id = 0; id < PARAM_COUNT; id++) {
+        const char *next;
+        if (!settings_name_steq(name, param_table[id].key, &next) || next) {
+            continue;
+        }
+
+        union param_value v;
+        if (len != sizeof(v) || read_cb(cb_arg, &v, sizeof(v)) != sizeof(v) ||
+            !param_in_range(id, v)) {
+            LOG_WRN("Saved %s ignored", param_table[id].key);
+            return 0;
+        }
+        param_staged[id] = v;       // boot, before any other writer
+        return 0;
+    }
+    return -ENOENT;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(motor_params, "motor", NULL, params_h_set,
+                               NULL, NULL);
+#endif
+
+/* ========================================================================= *
+ * PUBLIC API                                                                *
+ * ========================================================================= */
+void params_init(void)
+{
+    for (uint8_t id = 0; id < PARAM_COUNT; id++) {
+        param_staged[id] = param_table[id].def;
+    }
+
+#ifdef CONFIG_MOTOR_PARAMS_PERSIST
+    int err = settings_subsys_init();
+    if (!err) {
+        err = settings_load_subtree("motor");
+    }
+    if (err) {
+        LOG_ERR("Parameter load failed (err %d) — using defaults", err);
+    }
+    if (!param_consistent(param_staged)) {
+        LOG_WRN("Saved parameters inconsistent — using defaults");
+        for (uint8_t id = 0; id < PARAM_COUNT; id++) {
+            param_staged[id] = param_table[id].def;
+        }
+    }
+#endif
+
+    memcpy(param_active, param_staged, sizeof(param_active));
+    param_pending = false;
+}
+
+int param_type(uint8_t id)
+{
+    return (id < PARAM_COUNT) ? param_table[id].type : -1;
+}
+
+uint32_t param_u32(enum param_id id)
+{
+    return param_active[id].u;
+}
+
+float param_f32(enum param_id id)
+{
+    return param_active[id].f;
+}
+
+int params_get(struct param_entry *e, uint8_t n)
+{
+    k_spinlock_key_t key = k_spin_lock(&param_lock);
+    for (uint8_t i = 0; i < n; i++) {
+        if (e[i].id >= PARAM_COUNT) {
+            k_spin_unlock(&param_lock, key);
+            return -(i + 1);
+        }
+        e[i].v = param_staged[e[i].id];
+    }
+    k_spin_unlock(&param_lock, key);
+    return 0;
+}
+
+int params_set(const struct param_entry *e, uint8_t n)
+{
+    for (uint8_t i = 0; i < n; i++) {
+        if (e[i].id >= PARAM_COUNT || !param_writable(e[i].id) ||
+            !param_in_range(e[i].id, e[i].v)) {
+            return -(i + 1);
+        }
+    }
+
+    union param_value cand[PARAM_COUNT];
+
+    k_spinlock_key_t key = k_spin_lock(&param_lock);
+    memcpy(cand, param_staged, sizeof(cand));
+    for (uint8_t i = 0; i < n; i++) {
+        cand[e[i].id] = e[i].v;
+    }
+    if (!param_consistent(cand)) {
+        k_spin_unlock(&param_lock, key);
+        return -n;      // the batch as a whole
+    }
+    memcpy(param_staged, cand, sizeof(param_staged));
+    param_pending = true;
+    k_spin_unlock(&param_lock, key);
+
+    LOG_INF("%u parameter(s) staged", n);
+    return 0;
+}
+
+void params_defaults(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&param_lock);
+    for (uint8_t id = 0; id < PARAM_COUNT; id++) {
+        param_staged[id] = param_table[id].def;
+    }
+    param_pending = true;
+    k_spin_unlock(&param_lock, key);
+
+    LOG_INF("Parameter defaults staged");
+}
+
+int params_save(void)
+{
+#ifdef CONFIG_MOTOR_PARAMS_PERSIST
+    union param_value snap[PARAM_COUNT];
+    char              path[24];
+
+    k_spinlock_key_t key = k_spin_lock(&param_lock);
+    memcpy(snap, param_staged, sizeof(snap));
+    k_spin_unlock(&param_lock, key);
+
+    for (uint8_t id = 0; id < PARAM_COUNT; id++) {
+        snprintk(path, sizeof(path), "motor/%s", param_table[id].key);
+        int err = settings_save_one(path, &snap[id], sizeof(snap[id]));
+        if (err) {
+            LOG_ERR("Saving %s failed (err %d)", path, err);
+            return err;
+        }
+    }
+    LOG_INF("Parameters saved");
+    return 0;
+#else
+    return -ENOTSUP;
+#endif
+}
+
+bool params_apply(void)
+{
+    if (!param_pending) {
+        return false;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&param_lock);
+    memcpy(param_active, param_staged, sizeof(param_active));
+    param_pending = false;
+    k_spin_unlock(&param_lock, key);
+    return true;
+}
@@ -0,0 +1,99 @@
+#include "prof.h"
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <string.h>
+
+#ifndef CONFIG_MOTOR_SIM
+#include <soc.h>
+#endif
+
+/* ========================================================================= *
+ * CYCLE SOURCE                                                              *
+ * ========================================================================= *
+ * Cortex-M4 DWT cycle counter: one load, full 64 MHz resolution, wraps    *
+ * every ~67 s — unsigned subtraction is fine for any single probe.        *
+ * native_sim has no DWT; its k_cycle_get_32() is monotonic, which is all  *
+ * the relative numbers need.                                              */
+#ifdef CONFIG_MOTOR_SIM
+#define PROF_CYCLES()   k_cycle_get_32()
+#else
+#define PROF_CYCLES()   (DWT->CYCCNT)
+#endif
+
+/* ========================================================================= *
+ * PROBE STATE                                                               *
+ * Written from the hall ISR and the PID / telemetry threads. Each update  *
+ * is a few stores, so a short irq_lock() is cheaper than anything finer   *
+ * and keeps count/sum/histogram consistent for the BLE reader.            *
+ * ========================================================================= */
+static struct prof_stats prof_stats[PROF_PROBE_COUNT];
+
+void prof_init(void)
+{
+#ifndef CONFIG_MOTOR_SIM
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL  |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    prof_reset();
+}
+
+uint32_t prof_now(void)
+{
+    return PROF_CYCLES();
+}
+
+void prof_record(uint8_t probe, uint32_t cycles)
+{
+    if (probe >= PROF_PROBE_COUNT) {
+        return;
+    }
+
+    // 0 → bucket 0, otherwise 1 + floor(log2(cycles)), capped
+    uint32_t bucket = cycles ? 32U - (uint32_t)__builtin_clz(cycles) : 0U;
+    if (bucket >= PROF_HIST_BUCKETS) {
+        bucket = PROF_HIST_BUCKETS - 1;
+    }
+
+    struct prof_stats *s = &prof_stats[probe];
+
+    unsigned int key = irq_lock();
+    if (s->count == 0 || cycles < s->min) {
+        s->min = cycles;
+    }
+    if (cycles > s->max) {
+        s->max = cycles;
+    }
+    s->count++;
+    s->sum += cycles;
+    s->hist[bucket]++;
+    irq_unlock(key);
+}
+
+void prof_snapshot(uint8_t probe, struct prof_stats *out)
+{
+    if (probe >= PROF_PROBE_COUNT) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+
+    unsigned int key = irq_lock();
+    *out = prof_stats[probe];
+    irq_unlock(key);
+}
+
+void prof_reset(void)
+{
+    unsigned int key = irq_lock();
+    memset(prof_stats, 0, sizeof(prof_stats));
+    irq_unlock(key);
+}
+
+uint32_t prof_cycles_per_sec(void)
+{
+#ifdef CONFIG_MOTOR_SIM
+    return sys_clock_hw_cycles_per_sec();
+#else
+    return SystemCoreClock;
+#endif
+}
@@ -1,46 +1,101 @@
 #include "bldc_driver.h"
+#include "bldc_commutation.h"
+#include "bldc_hall.h"
 #include "motor_sim.h"
-#include "motor.h"
+#include "prof.h"
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+#include "speed_fast.h"
+#endif
+#include "trace.h"
 #include <zephyr/kernel.h>
 #include <zephyr/sys/atomic.h>
 #include <zephyr/logging/log.h>
-#include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 
 LOG_MODULE_REGISTER(mock_bldc, LOG_LEVEL_INF);
 
 /* ========================================================================= *
- * MOCK BLDC DRIVER                                                          *
+ * SIMULATED BLDC PLANT                                                      *
  *                                                                           *
  * Replaces bldc_driver.c for software-only BLE + PID testing.             *
  * Build with CONFIG_MOTOR_SIM=y.                                           *
  *                                                                           *
- * Physics model:                                                            *
- *   Steady-state RPM = (pulse - PULSE_ZERO) * RPM_PER_TICK                *
- *   actual_rpm ramps toward steady-state at RPM_RAMP_PER_TICK per 10ms.   *
+ * Only the hardware is simulated. Debounce, RPM, position, softstart and  *
+ * per-edge commutation are the real bldc_hall.c, fed by hall edges this   *
+ * plant generates at the exact microsecond the rotor crosses a sector.    *
  *                                                                           *
- * Why inertia matters:                                                      *
- *   Without it the sim responds instantly. The PID sees its full output    *
- *   reflected as RPM immediately, overshoots massively, the integral       *
- *   winds to -500 (its limit), and the output gets stuck well below        *
- *   target forever. The ramp gives the PI controller something physically  *
- *   realistic to control.                                                   *
+ * Physics model (line-to-line, one pair energised per six-step sector):  *
+ *   f     = (F_hi(θe) - F_lo(θe)) / 2      trapezoidal back-EMF shape     *
+ *   e     = Ke·ω·f                                                          *
+ *   L·di/dt = d·Vbus - R·i - e             d = CCR_hi / ARR from the mock *
+ *   T     = Ke·f·i                         (Kt == Ke in SI units)         *
+ *   J·dω/dt = T - B·ω - (T_coulomb + T_load)·sign(ω)                      *
+ * integrated in SIM_SUBSTEP_US steps. The bridge is modelled averaged:    *
+ * current only flows while the drive voltage exceeds the back-EMF (the    *
+ * body diodes block reverse current), and an un-energised bridge lets the *
+ * motor coast. All three low sides on short the windings: the back-EMF   *
+ * then drives a braking current for the low sides' share of the period.  *
+ *                                                                           *
+ * Which pair is energised comes from the TIM1 register mock, i.e. from    *
+ * the same bldc_comm_table the hardware uses — a wrong table entry or a   *
+ * wrong hall order shows up as lost torque, not just as a log line.       *
+ *                                                                           *
+ * Clock:                                                                    *
+ *   The plant keeps its own microsecond clock (sim_now_us) that advances  *
+ *   SIM_PERIOD_US per motor_sim_step(). It is bldc_hall_now_us(), so hall *
+ *   age and edge timing come from it, never from the kernel, and with      *
+ *   CONFIG_MOTOR_SIM_VIRTUAL_TIME the runner can step plant and controller *
+ *   back-to-back as fast as the host allows and get the same result every *
+ *   run.                                                                    *
  * ========================================================================= */
 
-#define TIM1_ARR            3200    // Must match bldc_driver.c
-#define PULSE_ZERO          192     // Below this = no torque (~6% duty)
-#define RPM_PER_TICK        2.0f    // RPM per pulse tick above PULSE_ZERO
+#define TIM1_ARR            BLDC_TIM1_ARR
+#define BOOTSTRAP_DUTY      ((TIM1_ARR * 95) / 100)   // same as bldc_driver.c
 
-// How fast the simulated motor accelerates/decelerates per 10ms tick.
-// 300 RPM/tick = 0→3000 RPM in ~100ms. Tune to match your real motor's feel.
-#define RPM_RAMP_PER_TICK   300
-
-// Fixed sim period — must match PID_PERIOD_MS in motor_control.c (10ms).
+// Fixed sim period — one control executive tick (10ms at the default rate).
 // Old code used variable sleep based on RPM which drifted out of phase with
 // the PID thread, causing the sim to read stale pulse values each wake.
-#define SIM_PERIOD_MS       10
-
-#define SIM_STACK_SIZE      512
+#define SIM_PERIOD_US       (1000000U / CONFIG_MOTOR_CONTROL_RATE_HZ)
+#define SIM_SUBSTEP_US      20      // < 2°e per substep at 6000 rpm
+#define SIM_SUBSTEPS        (SIM_PERIOD_US / SIM_SUBSTEP_US)
+BUILD_ASSERT(SIM_PERIOD_US % SIM_SUBSTEP_US == 0,
+             "control period must be a whole number of plant substeps");
+
+/* ── Motor parameters ──────────────────────────────────────────────────────
+ * Small 24 V, 8-pole outrunner, Kv ≈ 250 rpm/V → ~6000 rpm no-load at
+ * full duty, close to the old linear model's ceiling so the PID gains
+ * tuned against it still apply.                                          */
+#define SIM_VBUS            24.0f       // V
+#define SIM_KE              0.0382f     // V·s/rad line-to-line (= Kt, N·m/A)
+#define SIM_R               0.8f        // Ω line-to-line
+#define SIM_L               1.2e-3f     // H line-to-line
+#define SIM_J               2.0e-5f     // kg·m² rotor + hub
+#define SIM_B               1.0e-5f     // N·m·s/rad viscous
+#define SIM_T_COULOMB       5.0e-3f     // N·m bearing / cogging drag
+#define SIM_DT              (SIM_SUBSTEP_US * 1e-6f)
+
+/* ── Hall placement ────────────────────────────────────────────────────────
+ * Electrical sector k spans θe = [60k, 60k+60)°. Walking sectors upwards
+ * is CW rotation and gives the reverse of the CCW sequence 6→4→5→1→3→2.
+ * Back-EMF plateau centres are placed so the CW table entry for each hall
+ * state is the pair with flat, full torque across that whole sector.    */
+static const uint8_t HALL_SEQ[6] = {1, 5, 4, 6, 2, 3};
+
+/* Sensor whose output toggles on the boundary into sector k (CW). A
+ * misplaced sensor moves both of its boundaries by the same angle, so
+ * the sectors on either side of each grow and shrink in step.          */
+static const uint8_t HALL_EDGE_SENSOR[6] = {
+    BLDC_PHASE_V, BLDC_PHASE_U, BLDC_PHASE_W,
+    BLDC_PHASE_V, BLDC_PHASE_U, BLDC_PHASE_W,
+};
+static const float   EMF_CENTRE_DEG[3] = {
+    [BLDC_PHASE_U] = 300.0f,
+    [BLDC_PHASE_V] =  60.0f,
+    [BLDC_PHASE_W] = 180.0f,
+};
+
+#define SIM_STACK_SIZE      1024
 #define SIM_PRIO            6       // Below PID (5), above telemetry (7)
 
 K_THREAD_STACK_DEFINE(sim_stack, SIM_STACK_SIZE);
@@ -49,63 +104,273 @@ static struct k_thread sim_thread_data;
 /* ========================================================================= *
  * INTERNAL STATE                                                            *
  * ========================================================================= */
-static atomic_t sim_pulse_atomic      = ATOMIC_INIT(0);
-static atomic_t sim_last_cycle_atomic = ATOMIC_INIT(0);
-
-atomic_t g_motor_speed_atomic = ATOMIC_INIT(0);
+static volatile uint32_t sim_now_us   = 0;      // plant clock
+static uint32_t          sim_comm_faults = 0;
+static int               sim_last_ccw    = 0;   // direction of the mock's current step
+static uint32_t          sim_hall_drop   = 0;   // hall interrupts still to swallow
+static uint32_t          sim_drive_off_us = 0;  // plant time the high sides last stopped driving
+static bool              sim_was_driven   = false;
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+static uint32_t          sim_fast_due_us = 0;   // plant time of the next TIM1 divided update
+#endif
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+static bool              sim_comm_armed  = false;   // compare timer mock
+static uint32_t          sim_comm_due_us = 0;
+#endif
+static float             sim_hall_off[6];           // boundary into sector k, in sectors
+
+/* ── Plant ──────────────────────────────────────────────────────────────── */
+static struct {
+    float   omega;      // mechanical rad/s, + = CW
+    float   current;    // A through the energised pair
+    float   sec_pos;    // [0, 1) travelled through the current sector
+    uint8_t sector;     // 0..5, index into HALL_SEQ
+    uint8_t hall;       // 0..5, the sector the sensors report
+    int32_t edges;      // sensor state changes since reset, + = CW
+    int32_t sectors;    // true sector crossings since reset, + = CW
+    float   load;       // N·m, opposes motion
+    float   i_sum;      // ∫i over the last motor_sim_step(), A·substeps, < 0 braking
+} plant;
+
+/* ── TIM1 register mock ──────────────────────────────────────────────────── *
+ * Driven by the same bldc_comm_table as the hardware driver, so the exact  *
+ * CCER/CCR sequence the real timer would see can be checked on Linux.     */
+static struct {
+    uint32_t ccer;
+    uint32_t ccr[3];    // CCR1..CCR3
+    bool     moe;       // BDTR.MOE: false = break, every output off
+} sim_tim1;
 
 /* ========================================================================= *
- * HALL SIMULATION THREAD                                                    *
+ * PLANT MODEL                                                               *
  * ========================================================================= */
-static void sim_thread_fn(void *p1, void *p2, void *p3)
+/** @brief Trapezoidal back-EMF shape, ±1 on a 120° plateau, 60° ramps. */
+static float emf_shape(float theta_deg, uint8_t phase)
+{
+    float phi = theta_deg - EMF_CENTRE_DEG[phase];
+    while (phi >  180.0f) phi -= 360.0f;
+    while (phi < -180.0f) phi += 360.0f;
+    if (phi < 0.0f) phi = -phi;
+
+    if (phi <= 60.0f)  return  1.0f;
+    if (phi >= 120.0f) return -1.0f;
+    return 1.0f - (phi - 60.0f) / 30.0f;
+}
+
+/** @brief Shape factor of the line pair with the most back-EMF, signed so
+ *  that its back-EMF at speed @p omega is positive. */
+static float sim_short_pair(float theta_deg, float omega)
 {
-    int32_t actual_rpm = 0;     // Current simulated RPM — ramps toward target
+    static const uint8_t pair[3][2] = {
+        { BLDC_PHASE_U, BLDC_PHASE_V },
+        { BLDC_PHASE_V, BLDC_PHASE_W },
+        { BLDC_PHASE_W, BLDC_PHASE_U },
+    };
+    float best = 0.0f;
+
+    for (int p = 0; p < 3; p++) {
+        float f = 0.5f * (emf_shape(theta_deg, pair[p][0]) -
+                          emf_shape(theta_deg, pair[p][1]));
+        if ((f < 0.0f ? -f : f) > (best < 0.0f ? -best : best)) {
+            best = f;
+        }
+    }
+    return (omega < 0.0f) ? -best : best;
+}
 
-    while (1) {
-        int pulse = (int)atomic_get(&sim_pulse_atomic);
-
-        if (pulse <= PULSE_ZERO) {
-            // Ramp DOWN instead of snapping to 0.
-            // Snapping to 0 causes the stall detector to fire during normal
-            // deceleration: target!=0, rpm==0 → stall after STALL_TIMEOUT_MS.
-            actual_rpm -= RPM_RAMP_PER_TICK;
-            if (actual_rpm < 0) {
-                actual_rpm = 0;
-            }
-
-            if (actual_rpm == 0) {
-                // Fully stopped — stop refreshing timestamp so PID hall-timeout
-                // correctly detects the motor as stopped, same as real hardware.
-                k_msleep(SIM_PERIOD_MS);
-                continue;
-            }
-
-        } else {
-            int32_t target_rpm = (int32_t)((pulse - PULSE_ZERO) * RPM_PER_TICK);
-
-            // Ramp toward target — prevents instant response that winds up
-            // the PI integral on overshoot, which was the root cause of the
-            // pulse=2012→265→722→654 oscillation seen in testing.
-            if (actual_rpm < target_rpm) {
-                actual_rpm += RPM_RAMP_PER_TICK;
-                if (actual_rpm > target_rpm) {
-                    actual_rpm = target_rpm;
-                }
-            } else if (actual_rpm > target_rpm) {
-                actual_rpm -= RPM_RAMP_PER_TICK;
-                if (actual_rpm < target_rpm) {
-                    actual_rpm = target_rpm;
-                }
-            }
+/** @brief Decode the mock CCER into the driven pair.
+ *  @return false unless exactly one high side and one low side are on. */
+static bool sim_energised_pair(uint8_t *hi, uint8_t *lo, float *duty)
+{
+    int n_hi = 0, n_lo = 0;
+    if (!sim_tim1.moe) {
+        return false;
+    }
+    for (uint8_t ph = 0; ph < 3; ph++) {
+        if (sim_tim1.ccer & BLDC_CCER_HI(ph)) { *hi = ph; n_hi++; }
+        if (sim_tim1.ccer & BLDC_CCER_LO(ph)) { *lo = ph; n_lo++; }
+    }
+    if (n_hi != 1 || n_lo != 1 || *hi == *lo) {
+        return false;
+    }
+    *duty = (float)sim_tim1.ccr[*hi] / (float)TIM1_ARR;
+    return true;
+}
+
+/** @brief Decode the mock CCER as the all-low-side pattern.
+ *  @return false unless all three low sides and no high side are on. */
+static bool sim_low_sides(float *on)
+{
+    uint32_t lo = BLDC_CCER_LO(BLDC_PHASE_U) | BLDC_CCER_LO(BLDC_PHASE_V) |
+                  BLDC_CCER_LO(BLDC_PHASE_W);
+    if (!sim_tim1.moe || (sim_tim1.ccer & BLDC_CCER_ALL) != lo) {
+        return false;
+    }
+    *on = 1.0f - (float)sim_tim1.ccr[BLDC_PHASE_U] / (float)TIM1_ARR;
+    return true;
+}
+
+/** @brief Advance the plant by one substep starting at t0_us. */
+static void sim_substep(uint32_t t0_us)
+{
+    uint8_t hi = 0, lo = 0;
+    float   duty = 0.0f, low_on = 0.0f;
+
+    unsigned int key = irq_lock();
+    bool driven  = sim_energised_pair(&hi, &lo, &duty);
+    bool shorted = !driven && sim_low_sides(&low_on);
+    irq_unlock(key);
+
+    if (sim_was_driven && !driven) {
+        sim_drive_off_us = t0_us;
+    }
+    sim_was_driven = driven;
+
+    float theta = ((float)plant.sector + plant.sec_pos) * 60.0f;
+    float w_e   = plant.omega * (float)BLDC_POLE_PAIRS;
+
+    /* ── Electrical ─────────────────────────────────────────────────────── */
+    float f = 0.0f;
+    if (driven) {
+        f = 0.5f * (emf_shape(theta, hi) - emf_shape(theta, lo));
+        float e = SIM_KE * plant.omega * f;
+        float v = duty * SIM_VBUS;
+        if (e > SIM_VBUS) {
+            v = SIM_VBUS;           // generating above the bus: high-side diode
+        }
+        plant.current += (v - SIM_R * plant.current - e) * (SIM_DT / SIM_L);
+        if (plant.current < 0.0f && e <= SIM_VBUS) {
+            plant.current = 0.0f;   // diodes block reverse current
         }
+    } else if (shorted) {
+        /* The pair with the most back-EMF drives current back through the
+         * low sides while they are on, and through the high-side diodes
+         * into the bus while they are off: averaged, (1 − on)·Vbus against
+         * it. Bootstrap's 5 % only conducts above 95 % of the bus.     */
+        f = sim_short_pair(theta, plant.omega);
+        float e = SIM_KE * plant.omega * f;
+        float v = (1.0f - low_on) * SIM_VBUS;
+        plant.current += (v - SIM_R * plant.current - e) * (SIM_DT / SIM_L);
+        if (plant.current > 0.0f) {
+            plant.current = 0.0f;   // only the back-EMF drives this current
+        }
+    } else {
+        plant.current = 0.0f;
+    }
+
+    plant.i_sum += plant.current;
+
+    /* ── Mechanical ─────────────────────────────────────────────────────── */
+    float t_e    = SIM_KE * f * plant.current;
+    float t_drag = SIM_T_COULOMB + plant.load;
+
+    if (plant.omega == 0.0f && t_e <= t_drag && t_e >= -t_drag) {
+        // Stiction: not enough torque to break away
+    } else {
+        float sgn   = (plant.omega != 0.0f) ? ((plant.omega > 0.0f) ? 1.0f : -1.0f)
+                                            : ((t_e > 0.0f) ? 1.0f : -1.0f);
+        float alpha = (t_e - SIM_B * plant.omega - sgn * t_drag) / SIM_J;
+        float w_new = plant.omega + alpha * SIM_DT;
+        if (plant.omega != 0.0f && (w_new > 0.0f) != (plant.omega > 0.0f)) {
+            w_new = 0.0f;           // drag stops the rotor, never reverses it
+        }
+        plant.omega = w_new;
+    }
+
+    /* ── Angle and hall edges ──────────────────────────────────────────── *
+     * At most one sector per substep, so at most one edge. The edge is    *
+     * timestamped at the interpolated crossing instant, not the substep. *
+     * The sensors' sector runs from its misplaced lower boundary to its  *
+     * upper one; q is the rotor's position measured from the first.      */
+    float pos_old = plant.sec_pos;
+    float pos_new = pos_old + w_e * SIM_DT / (3.14159265f / 3.0f);
+    float frac    = -1.0f;
+    float rel     = (float)((int)((plant.sector + 7U - plant.hall) % 6U) - 1);
+    float q_old   = rel + pos_old;
+    float q_new   = rel + pos_new;
+    float q_up    = 1.0f + sim_hall_off[(plant.hall + 1) % 6];
+    float q_down  = sim_hall_off[plant.hall];
+
+    if (pos_new >= 1.0f) {
+        plant.sec_pos = pos_new - 1.0f;
+        plant.sector  = (plant.sector + 1) % 6;
+        plant.sectors++;
+    } else if (pos_new < 0.0f) {
+        plant.sec_pos = pos_new + 1.0f;
+        plant.sector  = (plant.sector + 5) % 6;
+        plant.sectors--;
+    } else {
+        plant.sec_pos = pos_new;
+    }
 
-        // Write current RPM for PID thread
-        atomic_set(&g_motor_speed_atomic, (atomic_val_t)actual_rpm);
+    if (q_new >= q_up) {
+        frac       = (q_up - q_old) / (q_new - q_old);
+        plant.hall = (plant.hall + 1) % 6;
+        plant.edges++;
+    } else if (q_new < q_down) {
+        frac       = (q_old - q_down) / (q_old - q_new);
+        plant.hall = (plant.hall + 5) % 6;
+        plant.edges--;
+    }
+
+    if (frac >= 0.0f && sim_hall_drop > 0) {
+        sim_hall_drop--;            // missed interrupt: the sensors still moved
+    } else if (frac >= 0.0f) {
+        // Hall ISR runs atomically w.r.t. the PID thread, as on hardware
+        key = irq_lock();
+        sim_now_us = t0_us + (uint32_t)(frac * (float)SIM_SUBSTEP_US + 0.5f);
+        PROF_BEGIN(t_isr);
+        bldc_hall_edge();
+        PROF_END(PROF_HALL_ISR, t_isr);
+        irq_unlock(key);
+    }
+}
+
+void motor_sim_step(void)
+{
+    uint32_t t0 = sim_now_us;
+
+    plant.i_sum = 0.0f;
+
+    for (uint32_t n = 0; n < SIM_SUBSTEPS; n++) {
+        uint32_t t = t0 + n * SIM_SUBSTEP_US;
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+        /* TIM1 divided update IRQ, on the substep grid: exact when the
+         * fast period is a multiple of SIM_SUBSTEP_US, else <= 20 µs late. */
+        if ((int32_t)(t - sim_fast_due_us) >= 0) {
+            sim_fast_due_us += SPEED_FAST_PERIOD_US;
+            unsigned int key = irq_lock();
+            sim_now_us = t;
+            speed_fast_tick();
+            irq_unlock(key);
+        }
+#endif
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+        /* Compare interrupt, on the substep grid like the hall edges: a
+         * step due inside a substep drives the plant from the next one,
+         * just as an edge's commutation does.                           */
+        if (sim_comm_armed && (int32_t)(t - sim_comm_due_us) >= 0) {
+            sim_comm_armed = false;
+            unsigned int key = irq_lock();
+            sim_now_us = t;
+            bldc_hall_advance_fire();
+            irq_unlock(key);
+        }
+#endif
+        sim_substep(t);
+    }
+    sim_now_us = t0 + SIM_PERIOD_US;
 
-        // Refresh hall-edge timestamp — keeps PID watchdog alive while moving
-        atomic_set(&sim_last_cycle_atomic, (atomic_val_t)k_cycle_get_32());
+    LOG_DBG("[SIM] rpm=%d i=%dmA hall=%u",
+            (int)(plant.omega * 9.5493f), (int)(plant.current * 1000.0f),
+            HALL_SEQ[plant.hall]);
+}
 
-        k_msleep(SIM_PERIOD_MS);
+static void sim_thread_fn(void *p1, void *p2, void *p3)
+{
+    while (1) {
+        motor_sim_step();
+        k_usleep(SIM_PERIOD_US);
     }
 }
 
@@ -116,93 +381,257 @@ static void sim_thread_fn(void *p1, void *p2, void *p3)
 int bldc_driver_init(void)
 {
     LOG_INF("================================================");
-    LOG_INF("  MOCK BLDC DRIVER — NO HARDWARE WILL ACTUATE  ");
-    LOG_INF("  ARR=%-4d  PULSE_ZERO=%-3d  RPM/TICK=%.1f     ",
-            TIM1_ARR, PULSE_ZERO, (double)RPM_PER_TICK);
-    LOG_INF("  Max RPM: %.0f  Ramp: %d RPM per %dms         ",
-            (double)((TIM1_ARR - PULSE_ZERO) * RPM_PER_TICK),
-            RPM_RAMP_PER_TICK, SIM_PERIOD_MS);
+    LOG_INF("  SIMULATED BLDC PLANT — NO HARDWARE WILL ACTUATE");
+    LOG_INF("  Vbus=%.0fV  Ke=%.4f  R=%.2f  L=%.1fmH  %dPP  ",
+            (double)SIM_VBUS, (double)SIM_KE, (double)SIM_R,
+            (double)(SIM_L * 1e3f), BLDC_POLE_PAIRS);
+    LOG_INF("  No-load: %.0f rpm  Stall: %.2f N·m  Load: %d mN·m",
+            (double)(SIM_VBUS / SIM_KE * 9.5493f),
+            (double)(SIM_KE * SIM_VBUS / SIM_R), CONFIG_MOTOR_SIM_LOAD_MNM);
     LOG_INF("================================================");
 
-    atomic_set(&sim_last_cycle_atomic, (atomic_val_t)k_cycle_get_32());
+    motor_sim_reset();
     return 0;
 }
 
 void motor_sim_init(void)
 {
-    // Re-seed here too — bldc_driver_init() may have been called early enough
-    // that the gap triggers a false hall timeout before the thread starts
-    atomic_set(&sim_last_cycle_atomic, (atomic_val_t)k_cycle_get_32());
+#ifdef CONFIG_MOTOR_SIM_VIRTUAL_TIME
+    LOG_INF("Plant on virtual clock — stepped by the sim runner");
+    return;
+#endif
 
     k_thread_create(&sim_thread_data, sim_stack,
                     K_THREAD_STACK_SIZEOF(sim_stack),
                     sim_thread_fn, NULL, NULL, NULL,
                     SIM_PRIO, 0, K_NO_WAIT);
 
-    k_thread_name_set(&sim_thread_data, "hall_sim");
-    LOG_INF("Hall sim thread started (prio=%d period=%dms ramp=%d RPM/tick)",
-            SIM_PRIO, SIM_PERIOD_MS, RPM_RAMP_PER_TICK);
+    k_thread_name_set(&sim_thread_data, "bldc_plant");
+    LOG_INF("Plant thread started (prio=%d period=%uus substep=%dus)",
+            SIM_PRIO, SIM_PERIOD_US, SIM_SUBSTEP_US);
 }
 
-void bldc_set_pwm(int pulse)
+void motor_sim_reset(void)
 {
-    if (pulse > TIM1_ARR) pulse = TIM1_ARR;
-    if (pulse < 0)        pulse = 0;
+    sim_now_us      = 0;
+    sim_comm_faults = 0;
+    sim_last_ccw    = 0;
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+    sim_fast_due_us = 0;
+#endif
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+    sim_comm_armed  = false;
+#endif
+    memset(&plant, 0, sizeof(plant));
+    memset(sim_hall_off, 0, sizeof(sim_hall_off));
+    sim_hall_drop = 0;
+    plant.sec_pos = 0.5f;       // rotor parked mid-sector
+    plant.load    = CONFIG_MOTOR_SIM_LOAD_MNM * 1e-3f;
+    memset(&sim_tim1, 0, sizeof(sim_tim1));
+    sim_tim1.moe     = true;    // bldc_driver_init() enables the outputs
+    sim_drive_off_us = 0;
+    sim_was_driven   = false;
+
+    bldc_hall_init(HALL_SEQ[plant.hall]);
+}
+
+void motor_sim_set_load(int32_t load_mnm)
+{
+    plant.load = (float)load_mnm * 1e-3f;
+}
+
+void motor_sim_drop_hall_edges(uint32_t n)
+{
+    sim_hall_drop = n;
+}
 
-    atomic_set(&sim_pulse_atomic, (atomic_val_t)pulse);
+int32_t motor_sim_get_edge_count(void)
+{
+    return plant.edges;
+}
 
-    // Threshold reduced from 50 to 10 so settling is visible in the log.
-    // At threshold=50, a PI converging the last 130 RPM of error (~4 pulse
-    // ticks at these gains) would never trigger a log line — looks frozen.
-    static int last_logged = -999;
-    if (abs(pulse - last_logged) > 10) {
-        last_logged = pulse;
-        LOG_INF("[SIM PWM] pulse=%4d (%4.1f%%) actual_rpm=%-5d target_rpm=%-5d",
-                pulse,
-                (double)(pulse * 100.0f / TIM1_ARR),
-                (int32_t)atomic_get(&g_motor_speed_atomic),
-                motor_get_target_speed());
+int32_t motor_sim_get_angle_cdeg(void)
+{
+    int32_t cdeg = (int32_t)(((float)plant.sectors + plant.sec_pos) *
+                             (float)BLDC_CDEG_PER_EDGE) % 36000;
+    return (cdeg < 0) ? cdeg + 36000 : cdeg;
+}
+
+void motor_sim_set_hall_error(int32_t u_cdeg, int32_t v_cdeg, int32_t w_cdeg)
+{
+    const int32_t err[3] = {
+        [BLDC_PHASE_U] = u_cdeg,
+        [BLDC_PHASE_V] = v_cdeg,
+        [BLDC_PHASE_W] = w_cdeg,
+    };
+    for (int k = 0; k < 6; k++) {
+        sim_hall_off[k] = (float)err[HALL_EDGE_SENSOR[k]] / 6000.0f;
     }
 }
 
-void bldc_set_commutation(uint8_t step)
+float motor_sim_get_sector_width(uint8_t hall)
 {
-    static uint8_t last_step = 0xFF;
-    if (step != last_step) {
-        last_step = step;
-        if (step != 0 && step != 7) {
-            LOG_DBG("[SIM COMM] step=%u (%s)", step, step > 8 ? "CCW" : "CW");
+    for (int k = 0; k < 6; k++) {
+        if (HALL_SEQ[k] == hall) {
+            return 1.0f + sim_hall_off[(k + 1) % 6] - sim_hall_off[k];
         }
     }
+    return 0.0f;
 }
 
-int bldc_read_hall_state(void)
+uint32_t motor_sim_time_us(void)
+{
+    return sim_now_us;
+}
+
+int32_t motor_sim_get_rpm(void)
+{
+    return (int32_t)(plant.omega * 9.5493f);
+}
+
+int32_t motor_sim_get_current_ma(void)
+{
+    return (int32_t)(plant.i_sum * 1000.0f / (float)SIM_SUBSTEPS);
+}
+
+int motor_sim_get_pulse(void)
+{
+    uint8_t hi = 0, lo = 0;
+    float   duty;
+    return sim_energised_pair(&hi, &lo, &duty) ? (int)sim_tim1.ccr[hi] : 0;
+}
+
+uint32_t motor_sim_drive_off_us(void)
+{
+    return sim_drive_off_us;
+}
+
+uint32_t motor_sim_get_comm_faults(void)
+{
+    return sim_comm_faults;
+}
+
+/* ========================================================================= *
+ * DRIVER API — hardware half of bldc_driver.c                              *
+ * ========================================================================= */
+uint32_t bldc_hall_now_us(void)
 {
-    static const uint8_t HALL_SEQ[6] = {1, 5, 4, 6, 2, 3};
-    static uint8_t idx = 0;
+    return sim_now_us;
+}
 
-    int32_t rpm = (int32_t)atomic_get(&g_motor_speed_atomic);
-    if (abs(rpm) < 10) {
-        return HALL_SEQ[idx];
+#ifdef CONFIG_MOTOR_PHASE_ADVANCE
+void bldc_comm_timer_start(uint32_t at_us)
+{
+    if ((int32_t)(sim_now_us - at_us) >= 0) {
+        sim_comm_armed = false;
+        bldc_hall_advance_fire();
+        return;
     }
-    idx = (rpm > 0) ? (idx + 1) % 6 : (idx + 5) % 6;
-    return HALL_SEQ[idx];
+    sim_comm_due_us = at_us;
+    sim_comm_armed  = true;
+}
+
+void bldc_comm_timer_cancel(void)
+{
+    sim_comm_armed = false;
+}
+#endif
+
+void bldc_set_bootstrap(void)
+{
+    bldc_hall_stop();
+
+    unsigned int key = irq_lock();
+    sim_tim1.ccer &= ~BLDC_CCER_ALL;
+    sim_tim1.ccr[0] = BOOTSTRAP_DUTY;
+    sim_tim1.ccr[1] = BOOTSTRAP_DUTY;
+    sim_tim1.ccr[2] = BOOTSTRAP_DUTY;
+    sim_tim1.ccer |= BLDC_CCER_LO(BLDC_PHASE_U) | BLDC_CCER_LO(BLDC_PHASE_V) |
+                     BLDC_CCER_LO(BLDC_PHASE_W);
+    irq_unlock(key);
+
+    LOG_INF("[SIM] Bootstrap: low-sides active, high-sides off");
+}
+
+#ifdef CONFIG_MOTOR_ESTOP_BREAK
+void bldc_estop(void)
+{
+    sim_tim1.moe = false;       // the plant's next substep coasts
+}
+
+void bldc_estop_release(void)
+{
+    sim_tim1.moe = true;
 }
+#endif
 
-int bldc_percent_to_pulse(float percent_duty_cycle)
+#ifdef CONFIG_MOTOR_FOUR_QUADRANT
+void bldc_set_brake_with_duty(int pulse)
 {
-    int pulse = (int)(percent_duty_cycle * 32.0f);
     if (pulse > TIM1_ARR) pulse = TIM1_ARR;
     if (pulse < 0)        pulse = 0;
-    return pulse;
+
+    unsigned int key = irq_lock();
+    sim_tim1.ccr[0] = (uint32_t)(TIM1_ARR - pulse);
+    sim_tim1.ccr[1] = (uint32_t)(TIM1_ARR - pulse);
+    sim_tim1.ccr[2] = (uint32_t)(TIM1_ARR - pulse);
+    sim_tim1.ccer = (sim_tim1.ccer & ~BLDC_CCER_ALL) |
+                    BLDC_CCER_LO(BLDC_PHASE_U) | BLDC_CCER_LO(BLDC_PHASE_V) |
+                    BLDC_CCER_LO(BLDC_PHASE_W);
+    irq_unlock(key);
+
+    trace_record(TRACE_EV_BRAKE, bldc_get_direction() ? 0x08 : 0,
+                 (uint16_t)pulse);
 }
+#endif
 
-uint32_t bldc_get_last_cycle_count(void)
+void bldc_set_commutation_with_duty(uint8_t hall_state, int pulse)
 {
-    return (uint32_t)atomic_get(&sim_last_cycle_atomic);
+    PROF_BEGIN(t0);
+
+    if (pulse > TIM1_ARR) pulse = TIM1_ARR;
+    if (pulse < 0)        pulse = 0;
+
+    int ccw = bldc_get_direction();
+    const struct bldc_comm_step *step =
+        &bldc_comm_table[ccw ? BLDC_DIR_CCW : BLDC_DIR_CW][hall_state & 0x7];
+
+    if (step->ccer == 0) {
+        LOG_ERR("[SIM COMM] invalid hall state 0x%X", hall_state);
+        return;
+    }
+
+    unsigned int key = irq_lock();
+
+    /* Consecutive six-step patterns keep exactly one switch in common
+     * (one terminal changes per edge). Anything else means the table or
+     * the hall sequence is wrong — count it so a sim run exposes it.
+     * A direction change legitimately swaps the pair, so skip that step. */
+    uint32_t prev = sim_tim1.ccer & BLDC_CCER_ALL;
+    if (prev != 0 && prev != step->ccer && ccw == sim_last_ccw &&
+        __builtin_popcount(prev & step->ccer) != 1) {
+        sim_comm_faults++;
+        LOG_WRN("[SIM COMM] non-adjacent step: ccer 0x%03X -> 0x%03X (faults=%u)",
+                prev, step->ccer, sim_comm_faults);
+    }
+
+    sim_tim1.ccr[step->high] = (uint32_t)pulse;
+    sim_tim1.ccr[step->low]  = 0;
+    sim_tim1.ccer = (sim_tim1.ccer & ~BLDC_CCER_ALL) | step->ccer;
+    sim_last_ccw  = ccw;
+    irq_unlock(key);
+
+    trace_record(TRACE_EV_COMMUTATE,
+                 (hall_state & 0x7) | (ccw ? 0x08 : 0),
+                 (uint16_t)pulse);
+    PROF_END(PROF_COMMUTATE, t0);
+
+    LOG_DBG("[SIM COMM] hall=%u %s ccer=0x%03X ccr=[%u %u %u]",
+            hall_state, ccw ? "CCW" : "CW", sim_tim1.ccer,
+            sim_tim1.ccr[0], sim_tim1.ccr[1], sim_tim1.ccr[2]);
 }
 
-void bldc_set_direction(int ccw)
+int bldc_read_hall_state(void)
 {
-    LOG_INF("[SIM DIR] %s", ccw ? "CCW" : "CW");
-}
\ No newline at end of file
+    return HALL_SEQ[plant.hall];
+}
@@ -0,0 +1,17 @@
+/* ========================================================================= *
+ * HOST CLOCK (native_sim, runner side)                                      *
+ * ========================================================================= *
+ * Built into the native simulator runner rather than the Zephyr image, so  *
+ * it sees the host libc. Gives the self-tests a clock that advances while  *
+ * code runs; see include/bench_clock.h.                                    */
+
+#include <stdint.h>
+#include <time.h>
+
+uint64_t bench_host_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
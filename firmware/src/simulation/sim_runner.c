@@ -0,0 +1,974 @@
+#include "motor_sim.h"
+#include "bldc_driver.h"
+#include "motor_control.h"
+#include "motor.h"
+#include "trace.h"
+#include "params.h"
+#ifdef CONFIG_MOTOR_PID_SELFTEST
+#include "pid.h"
+#endif
+#ifdef CONFIG_MOTOR_HALL_SELFTEST
+#include "bldc_hall.h"
+#endif
+#ifdef CONFIG_MOTOR_AUTOTUNE
+#include "autotune.h"
+#endif
+#ifdef CONFIG_MOTOR_SPEED_OBSERVER
+#include "speed_obs.h"
+#endif
+#ifdef CONFIG_MOTOR_HALL_COMP
+#include "hall_comp.h"
+#endif
+#include <zephyr/sys/atomic.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ========================================================================= *
+ * VIRTUAL-TIME SCENARIO RUNNER                                              *
+ * ========================================================================= *
+ * Steps plant and controller back-to-back on the plant clock — no sleeps, *
+ * no threads, no kernel time — so a scenario runs as fast as the host can *
+ * execute it and the same inputs always give the same outputs.            *
+ *                                                                           *
+ * Per tick: apply due scenario events → motor_sim_step() (plant moves one *
+ * period with the previous duty) → motor_control_step() (controller reads *
+ * feedback, writes new duty). Every tick's feedback and duty is folded    *
+ * into an FNV-1a hash; each scenario is repeated CONFIG_MOTOR_SIM_RUNS    *
+ * times and every repeat must reproduce the first run's hash exactly.     *
+ *                                                                           *
+ * Scenarios with a bench spec are also scored on the first run: one       *
+ * "BENCH {json}" line each, checked against the spec's limits, so a       *
+ * controller or filter change that degrades the response fails the run.  */
+
+#define SIM_TICK_US         (1000000U / CONFIG_MOTOR_CONTROL_RATE_HZ)  // = plant period
+#define SIM_TICK_DT         (SIM_TICK_US / 1e6f)
+
+#define FNV_OFFSET          2166136261U
+#define FNV_PRIME           16777619U
+
+enum sim_event_kind {
+    SIM_EV_SPEED,       // motor_set_target_speed(value)
+    SIM_EV_POSITION,    // motor_set_target_position(value)
+    SIM_EV_STOP,        // motor_set_target_speed(0)
+    SIM_EV_ESTOP,       // motor_trigger_estop()
+    SIM_EV_LOAD,        // motor_sim_set_load(value mN·m)
+    SIM_EV_HALL_DROP,   // motor_sim_drop_hall_edges(value)
+    SIM_EV_AUTOTUNE,    // motor_start_autotune(value rpm)
+    SIM_EV_PARAMS,      // params_set(param_batches[value])
+    SIM_EV_HALL_ERROR,  // motor_sim_set_hall_error(hall_errors[value])
+    SIM_EV_HALL_CAL,    // speed value, then hall_comp_request(value)
+};
+
+struct sim_event {
+    uint32_t t_ms;
+    uint8_t  kind;      // enum sim_event_kind
+    int32_t  value;
+};
+
+/* ── Step-response bench ──────────────────────────────────────────────────── *
+ * Scores current_speed over [t_step, t_end).                                *
+ * y0 = speed on the tick before t_step, r = target from t_step on.        *
+ *   STEP:        rise 10→90 % of |r - y0|, overshoot past r in % of the    *
+ *                step, settling = last exit from the ±band around r. A     *
+ *                step that changes sign also reports the reversal time,   *
+ *                from t_step to the first tick turning r's way.          *
+ *   DISTURBANCE: target unchanged, load applied at t_step. dip = largest   *
+ *                |y - y0|, recovery = last exit from the ±band around y0.  *
+ *   Both:        steady-state error = mean |r - y| over the last           *
+ *                BENCH_SSE_WINDOW_MS, IAE = ∫|ref - y| dt in rpm·s, with   *
+ *                ref = r (STEP) or y0 (DISTURBANCE).                       *
+ * band = BENCH_BAND_PCT of |r - y0| (STEP) or of |r| (DISTURBANCE), never  *
+ * below BENCH_BAND_MIN_RPM — the hall RPM quantum at low speed.            *
+ * A limit of 0 is reported but not enforced.                              */
+#define BENCH_BAND_PCT          5
+#define BENCH_BAND_MIN_RPM      20
+#define BENCH_SSE_WINDOW_MS     500
+
+enum sim_bench_kind {
+    BENCH_STEP,
+    BENCH_DISTURBANCE,
+};
+
+struct sim_bench {
+    uint8_t  kind;              // enum sim_bench_kind
+    uint32_t t_step_ms;
+    uint32_t t_end_ms;
+    int32_t  max_rise_ms;       // STEP
+    int32_t  max_overshoot_pct; // STEP
+    int32_t  max_reverse_ms;    // STEP through zero
+    int32_t  max_dip_rpm;       // DISTURBANCE
+    int32_t  max_settle_ms;     // STEP settling / DISTURBANCE recovery
+    int32_t  max_sse_rpm;
+    int32_t  max_iae_rpm_s;
+};
+
+struct sim_scenario {
+    const char             *name;
+    uint32_t                duration_ms;
+    const struct sim_event *events;     // sorted by t_ms
+    uint8_t                 n_events;
+    const struct sim_bench *bench;      // NULL = determinism only
+};
+
+/* ========================================================================= *
+ * BUILT-IN SCENARIOS                                                        *
+ * ========================================================================= */
+static const struct sim_event ev_spinup[] = {
+    {    0, SIM_EV_SPEED, 3000 },
+};
+
+static const struct sim_event ev_step_down[] = {
+    {    0, SIM_EV_SPEED, 3000 },
+    { 3000, SIM_EV_SPEED, 1000 },
+    { 6000, SIM_EV_STOP,     0 },
+};
+
+static const struct sim_event ev_position[] = {
+    {    0, SIM_EV_POSITION,  90 },
+    { 3000, SIM_EV_POSITION, 270 },
+};
+
+/* Targets between hall edges (every 15°), the second one back the other way */
+static const struct sim_event ev_position_fine[] = {
+    {    0, SIM_EV_POSITION, 100 },
+    { 3000, SIM_EV_POSITION,  37 },
+};
+
+static const struct sim_event ev_estop[] = {
+    {    0, SIM_EV_SPEED, 2000 },
+    { 1500, SIM_EV_ESTOP,    0 },
+};
+
+static const struct sim_event ev_load_impulse[] = {
+    {    0, SIM_EV_SPEED, 2000 },
+    { 3000, SIM_EV_LOAD,   100 },
+    { 3200, SIM_EV_LOAD,     0 },
+};
+
+static const struct sim_event ev_autotune[] = {
+    {    0, SIM_EV_AUTOTUNE, 2000 },
+    { 6000, SIM_EV_SPEED,    3000 },
+};
+
+/* Batch 0 carries one bad value and must change nothing; batch 1 slows
+ * the RPM filter and shortens the stall timeout mid-run.              */
+static const struct param_entry param_batch_bad[] = {
+    { PARAM_STALL_TIMEOUT_MS,  { .u = 4000 } },
+    { PARAM_HALL_TIMEOUT_MS,   { .u = 5 } },            // below the minimum
+};
+static const struct param_entry param_batch_retune[] = {
+    { PARAM_RPM_FILTER_TAU_US, { .u = 40000 } },
+    { PARAM_STALL_TIMEOUT_MS,  { .u = 3000 } },
+};
+static const struct {
+    const struct param_entry *e;
+    uint8_t                   n;
+} param_batches[] = {
+    { param_batch_bad,    ARRAY_SIZE(param_batch_bad)    },
+    { param_batch_retune, ARRAY_SIZE(param_batch_retune) },
+};
+
+static const struct sim_event ev_params[] = {
+    {    0, SIM_EV_SPEED,  2000 },
+    { 1500, SIM_EV_PARAMS,    0 },
+    { 2000, SIM_EV_PARAMS,    1 },
+    { 3000, SIM_EV_SPEED,  3000 },
+};
+
+static const struct sim_event ev_low_speed[] = {
+    {    0, SIM_EV_SPEED,   300 },
+    { 2000, SIM_EV_SPEED,   120 },
+    { 4000, SIM_EV_SPEED,    60 },
+};
+
+/* Sensor placement error in electrical centidegrees, U / V / W: sectors
+ * of 70°, 57° and 53°e, twice per electrical revolution.              */
+static const int32_t hall_errors[][3] = {
+    { 500, -500, 200 },
+};
+
+static const struct sim_event ev_hall_comp[] = {
+    {    0, SIM_EV_HALL_ERROR,    0 },
+    {    0, SIM_EV_SPEED,      1500 },
+    { 3000, SIM_EV_HALL_CAL,   1500 },
+};
+
+// Past what full duty reaches on the edge: the last second is scored
+static const struct sim_event ev_top_speed[] = {
+    {    0, SIM_EV_SPEED,  6000 },
+    { 3000, SIM_EV_LOAD,     20 },
+};
+
+static const struct sim_event ev_reversal[] = {
+    {    0, SIM_EV_SPEED,  1000 },
+    { 3000, SIM_EV_SPEED, -1000 },
+};
+
+/* Missed hall interrupts: one, then two in a row (the opposite sector),
+ * then one more, then coast to a stop. The edge count must still end on
+ * the plant's own count.                                               */
+static const struct sim_event ev_hall_drop[] = {
+    {    0, SIM_EV_SPEED,     2000 },
+    { 1000, SIM_EV_HALL_DROP,    1 },
+    { 1500, SIM_EV_HALL_DROP,    2 },
+    { 2000, SIM_EV_HALL_DROP,    1 },
+    { 2500, SIM_EV_STOP,         0 },
+};
+
+/* Limits sit ~15 % above what the current controller scores, so they catch
+ * regressions; tighten them whenever a change improves the numbers. Both
+ * speed loops reach every target, so rise and settling are enforced; rise
+ * is bounded by the 6000 rpm/s speed profile and the step-down by the
+ * unpowered coast-down (with CONFIG_MOTOR_FOUR_QUADRANT it brakes, and
+ * does better). Reversal is enforced only with CONFIG_MOTOR_FOUR_QUADRANT:
+ * without it speed mode cannot drive a negative target.                 */
+#ifdef CONFIG_MOTOR_FAST_SPEED_LOOP
+/* 1-2 kHz fixed-point PI on rpm_pid's gains and feedforward. The faster
+ * sampling buys a shallower load dip; elsewhere it scores as the thread. */
+static const struct sim_bench bench_spinup = {
+    .kind = BENCH_STEP, .t_step_ms = 0, .t_end_ms = 3000,
+    .max_rise_ms = 540, .max_overshoot_pct = 5, .max_settle_ms = 580,
+    .max_sse_rpm = 20, .max_iae_rpm_s = 960,
+};
+
+static const struct sim_bench bench_step_down = {
+    .kind = BENCH_STEP, .t_step_ms = 3000, .t_end_ms = 6000,
+    .max_rise_ms = 550, .max_overshoot_pct = 11, .max_settle_ms = 1100,
+    .max_sse_rpm = 20, .max_iae_rpm_s = 830,
+};
+
+static const struct sim_bench bench_load_impulse = {
+    .kind = BENCH_DISTURBANCE, .t_step_ms = 3000, .t_end_ms = 6000,
+    .max_dip_rpm = 265, .max_settle_ms = 265,
+    .max_sse_rpm = 20, .max_iae_rpm_s = 70,
+};
+
+/* 2000 → 3000 rpm through the slower RPM filter set at 2000 ms. */
+static const struct sim_bench bench_params = {
+    .kind = BENCH_STEP, .t_step_ms = 3000, .t_end_ms = 6000,
+    .max_rise_ms = 165, .max_overshoot_pct = 5, .max_settle_ms = 255,
+    .max_sse_rpm = 20, .max_iae_rpm_s = 155,
+};
+#else
+/* Thread-rate rpm_pid with feedforward and conditional integration. */
+static const struct sim_bench bench_spinup = {
+    .kind = BENCH_STEP, .t_step_ms = 0, .t_end_ms = 3000,
+    .max_rise_ms = 560, .max_overshoot_pct = 5, .max_settle_ms = 600,
+    .max_sse_rpm = 20, .max_iae_rpm_s = 990,
+};
+
+static const struct sim_bench bench_step_down = {
+    .kind = BENCH_STEP, .t_step_ms = 3000, .t_end_ms = 6000,
+    .max_rise_ms = 550, .max_overshoot_pct = 11, .max_settle_ms = 1100,
+    .max_sse_rpm = 20, .max_iae_rpm_s = 830,
+};
+
+static const struct sim_bench bench_load_impulse = {
+    .kind = BENCH_DISTURBANCE, .t_step_ms = 3000, .t_end_ms = 6000,
+    .max_dip_rpm = 330, .max_settle_ms = 290,
+    .max_sse_rpm = 20, .max_iae_rpm_s = 70,
+};
+
+static const struct sim_bench bench_params = {
+    .kind = BENCH_STEP, .t_step_ms = 3000, .t_end_ms = 6000,
+    .max_rise_ms = 180, .max_overshoot_pct = 5, .max_settle_ms = 260,
+    .max_sse_rpm = 20, .max_iae_rpm_s = 165,
+};
+#endif
+
+#ifdef CONFIG_MOTOR_AUTOTUNE
+/* Spin-up to 3000 rpm on the gains the autotuner just put live. */
+static const struct sim_bench bench_autotune = {
+    .kind = BENCH_STEP, .t_step_ms = 6000, .t_end_ms = 9000,
+    .max_rise_ms = 520, .max_overshoot_pct = 5, .max_settle_ms = 590,
+    .max_sse_rpm = 20, .max_iae_rpm_s = 980,
+};
+#endif
+
+#if defined(CONFIG_MOTOR_FOUR_QUADRANT) && defined(CONFIG_MOTOR_FAST_SPEED_LOOP)
+/* Braked to 200 rpm, flipped, then up the speed profile from 0. */
+static const struct sim_bench bench_reversal = {
+    .kind = BENCH_STEP, .t_step_ms = 3000, .t_end_ms = 6000,
+    .max_reverse_ms = 390, .max_rise_ms = 450, .max_overshoot_pct = 5,
+    .max_settle_ms = 580, .max_sse_rpm = 20, .max_iae_rpm_s = 700,
+};
+#elif defined(CONFIG_MOTOR_FOUR_QUADRANT)
+static const struct sim_bench bench_reversal = {
+    .kind = BENCH_STEP, .t_step_ms = 3000, .t_end_ms = 6000,
+    .max_reverse_ms = 390, .max_rise_ms = 450, .max_overshoot_pct = 5,
+    .max_settle_ms = 610, .max_sse_rpm = 20, .max_iae_rpm_s = 700,
+};
+#else
+static const struct sim_bench bench_reversal = {
+    .kind = BENCH_STEP, .t_step_ms = 3000, .t_end_ms = 6000,
+};
+#endif
+
+static const struct sim_scenario scenarios[] = {
+    { "spinup_3000",  3000, ev_spinup,       ARRAY_SIZE(ev_spinup),       &bench_spinup       },
+    { "step_down",    7000, ev_step_down,    ARRAY_SIZE(ev_step_down),    &bench_step_down    },
+    { "top_speed",    6000, ev_top_speed,    ARRAY_SIZE(ev_top_speed),    NULL                },
+    { "position",     6000, ev_position,     ARRAY_SIZE(ev_position),     NULL                },
+    { "position_fine",6000, ev_position_fine,ARRAY_SIZE(ev_position_fine),NULL                },
+    { "estop",        3000, ev_estop,        ARRAY_SIZE(ev_estop),        NULL                },
+    { "load_impulse", 6000, ev_load_impulse, ARRAY_SIZE(ev_load_impulse), &bench_load_impulse },
+    { "reversal",     6000, ev_reversal,     ARRAY_SIZE(ev_reversal),     &bench_reversal     },
+    { "low_speed",    6000, ev_low_speed,    ARRAY_SIZE(ev_low_speed),    NULL                },
+    { "params",       6000, ev_params,       ARRAY_SIZE(ev_params),       &bench_params       },
+    { "hall_comp",    7000, ev_hall_comp,    ARRAY_SIZE(ev_hall_comp),    NULL                },
+    { "hall_drop",    5000, ev_hall_drop,    ARRAY_SIZE(ev_hall_drop),    NULL                },
+#ifdef CONFIG_MOTOR_AUTOTUNE
+    { "autotune",     9000, ev_autotune,     ARRAY_SIZE(ev_autotune),     &bench_autotune     },
+#endif
+};
+
+/* ========================================================================= *
+ * HELPERS                                                                   *
+ * ========================================================================= */
+static inline uint32_t fnv1a_u32(uint32_t h, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        h ^= (v >> (8 * i)) & 0xFF;
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+/* ── Bench accumulator ───────────────────────────────────────────────────── */
+struct bench_acc {
+    bool     started;
+    int32_t  y0, r, prev_y;
+    int32_t  t10_ms, t90_ms;    // -1 until crossed
+    int32_t  t0_ms;             // STEP through zero: first tick turning r's way
+    int32_t  peak;              // STEP: furthest progress past y0, in rpm
+                                // DISTURBANCE: largest |y - y0|
+    int32_t  last_out_ms;       // last tick outside the band, -1 = never
+    uint64_t iae_rpm_us;
+    uint64_t sse_sum;
+    uint32_t sse_n;
+};
+
+struct bench_result {
+    int32_t rise_ms, overshoot_pct, reverse_ms, dip_rpm, settle_ms, sse_rpm, iae_rpm_s;
+    bool    reverses;
+    bool    pass;
+};
+
+static void bench_sample(const struct sim_bench *b, struct bench_acc *a,
+                         uint32_t t_ms, int32_t y, int32_t target)
+{
+    if (t_ms < b->t_step_ms) {
+        a->prev_y = y;
+        return;
+    }
+    if (t_ms >= b->t_end_ms) {
+        return;
+    }
+
+    if (!a->started) {
+        a->started     = true;
+        a->y0          = a->prev_y;
+        a->r           = target;
+        a->t10_ms      = -1;
+        a->t90_ms      = -1;
+        a->t0_ms       = -1;
+        a->peak        = 0;
+        a->last_out_ms = -1;
+    }
+
+    int32_t rel_ms = (int32_t)(t_ms - b->t_step_ms);
+    int32_t err    = a->r - y;
+    int32_t band;
+    int32_t dev;
+
+    if (b->kind == BENCH_STEP) {
+        int32_t span     = a->r - a->y0;
+        int32_t mag      = (span < 0) ? -span : span;
+        int32_t progress = (span < 0) ? (a->y0 - y) : (y - a->y0);
+
+        if (a->t10_ms < 0 && progress * 10 >= mag)     a->t10_ms = rel_ms;
+        if (a->t90_ms < 0 && progress * 10 >= mag * 9) a->t90_ms = rel_ms;
+        if (a->t0_ms  < 0 && (a->r < 0 ? y < 0 : y > 0)) a->t0_ms = rel_ms;
+        if (progress > a->peak)                        a->peak   = progress;
+
+        band = MAX(mag * BENCH_BAND_PCT / 100, BENCH_BAND_MIN_RPM);
+        dev  = err;
+    } else {
+        int32_t mag = (a->r < 0) ? -a->r : a->r;
+
+        dev  = y - a->y0;
+        if ((dev < 0 ? -dev : dev) > a->peak) a->peak = (dev < 0) ? -dev : dev;
+        band = MAX(mag * BENCH_BAND_PCT / 100, BENCH_BAND_MIN_RPM);
+    }
+
+    uint32_t abs_dev = (uint32_t)((dev < 0) ? -dev : dev);
+    if ((int32_t)abs_dev > band) {
+        a->last_out_ms = rel_ms;
+    }
+    a->iae_rpm_us += (uint64_t)abs_dev * SIM_TICK_US;
+
+    if (t_ms + BENCH_SSE_WINDOW_MS >= b->t_end_ms) {
+        a->sse_sum += (uint32_t)((err < 0) ? -err : err);
+        a->sse_n++;
+    }
+}
+
+static inline bool bench_within(int32_t value, int32_t limit)
+{
+    return limit == 0 || (value >= 0 && value <= limit);
+}
+
+static void bench_score(const struct sim_bench *b, const struct bench_acc *a,
+                        struct bench_result *res)
+{
+    int32_t window_ms = (int32_t)(b->t_end_ms - b->t_step_ms);
+    int32_t tick_ms   = (int32_t)DIV_ROUND_UP(SIM_TICK_US, 1000U);
+    int32_t mag       = a->r - a->y0;
+    if (mag < 0) mag = -mag;
+
+    res->rise_ms       = (a->t10_ms >= 0 && a->t90_ms >= 0) ? a->t90_ms - a->t10_ms : -1;
+    res->overshoot_pct = (mag > 0 && a->peak > mag) ? ((a->peak - mag) * 100) / mag : 0;
+    res->reverses      = (a->y0 < 0 && a->r > 0) || (a->y0 > 0 && a->r < 0);
+    res->reverse_ms    = a->t0_ms;
+    res->dip_rpm       = a->peak;
+    // Still outside the band on the last tick = never settled
+    res->settle_ms     = (a->last_out_ms < 0) ? 0
+                       : (a->last_out_ms + tick_ms >= window_ms) ? -1
+                       : a->last_out_ms + tick_ms;
+    res->sse_rpm       = a->sse_n ? (int32_t)(a->sse_sum / a->sse_n) : -1;
+    res->iae_rpm_s     = (int32_t)(a->iae_rpm_us / 1000000U);
+
+    res->pass = bench_within(res->settle_ms, b->max_settle_ms) &&
+                bench_within(res->sse_rpm,   b->max_sse_rpm)   &&
+                bench_within(res->iae_rpm_s, b->max_iae_rpm_s);
+    if (b->kind == BENCH_STEP) {
+        res->pass = res->pass &&
+                    bench_within(res->rise_ms,       b->max_rise_ms) &&
+                    bench_within(res->overshoot_pct, b->max_overshoot_pct) &&
+                    (!res->reverses ||
+                     bench_within(res->reverse_ms, b->max_reverse_ms));
+    } else {
+        res->pass = res->pass && bench_within(res->dip_rpm, b->max_dip_rpm);
+    }
+}
+
+/** @brief One machine-readable line per benched scenario:
+ *  grep '^BENCH ' | cut -c7- gives JSON Lines. -1 = never reached. */
+static void bench_print(const char *name, const struct sim_bench *b,
+                        const struct bench_result *res)
+{
+    if (b->kind == BENCH_STEP && res->reverses) {
+        printk("BENCH {\"scenario\":\"%s\",\"kind\":\"step\","
+               "\"reverse_ms\":%d,"
+               "\"rise_ms\":%d,\"overshoot_pct\":%d,\"settle_ms\":%d,"
+               "\"sse_rpm\":%d,\"iae_rpm_s\":%d,\"pass\":%s}\n",
+               name, res->reverse_ms,
+               res->rise_ms, res->overshoot_pct, res->settle_ms,
+               res->sse_rpm, res->iae_rpm_s, res->pass ? "true" : "false");
+    } else if (b->kind == BENCH_STEP) {
+        printk("BENCH {\"scenario\":\"%s\",\"kind\":\"step\","
+               "\"rise_ms\":%d,\"overshoot_pct\":%d,\"settle_ms\":%d,"
+               "\"sse_rpm\":%d,\"iae_rpm_s\":%d,\"pass\":%s}\n",
+               name, res->rise_ms, res->overshoot_pct, res->settle_ms,
+               res->sse_rpm, res->iae_rpm_s, res->pass ? "true" : "false");
+    } else {
+        printk("BENCH {\"scenario\":\"%s\",\"kind\":\"disturbance\","
+               "\"dip_rpm\":%d,\"recover_ms\":%d,"
+               "\"sse_rpm\":%d,\"iae_rpm_s\":%d,\"pass\":%s}\n",
+               name, res->dip_rpm, res->settle_ms,
+               res->sse_rpm, res->iae_rpm_s, res->pass ? "true" : "false");
+    }
+}
+
+static int param_batch_rc[ARRAY_SIZE(param_batches)];
+static uint32_t estop_cmd_us;       // plant time of the last SIM_EV_ESTOP
+
+static void apply_event(const struct sim_event *ev)
+{
+    switch (ev->kind) {
+        case SIM_EV_SPEED:    motor_set_target_speed(ev->value);    break;
+        case SIM_EV_POSITION: motor_set_target_position(ev->value); break;
+        case SIM_EV_STOP:     motor_set_target_speed(0);            break;
+        case SIM_EV_ESTOP:
+            estop_cmd_us = motor_sim_time_us();
+            motor_trigger_estop();
+            break;
+        case SIM_EV_LOAD:     motor_sim_set_load(ev->value);        break;
+        case SIM_EV_HALL_DROP: motor_sim_drop_hall_edges((uint32_t)ev->value); break;
+#ifdef CONFIG_MOTOR_AUTOTUNE
+        case SIM_EV_AUTOTUNE: motor_start_autotune(ev->value);      break;
+#endif
+        case SIM_EV_PARAMS:
+            param_batch_rc[ev->value] = params_set(param_batches[ev->value].e,
+                                                   param_batches[ev->value].n);
+            break;
+        case SIM_EV_HALL_ERROR:
+            motor_sim_set_hall_error(hall_errors[ev->value][0],
+                                     hall_errors[ev->value][1],
+                                     hall_errors[ev->value][2]);
+            break;
+        case SIM_EV_HALL_CAL:
+            motor_set_target_speed(ev->value);
+#ifdef CONFIG_MOTOR_HALL_COMP
+            hall_comp_request(ev->value);
+#endif
+            break;
+        default:                                                    break;
+    }
+}
+
+/* ── Missed hall edges ──────────────────────────────────────────────────── */
+static bool hall_drop_report(void)
+{
+    int32_t edges = bldc_get_edge_count();
+    int32_t truth = motor_sim_get_edge_count();
+    bool    pass  = (edges == truth);
+
+    printk("HALLDROP {\"edges\":%d,\"plant_edges\":%d,\"pass\":%s}\n",
+           edges, truth, pass ? "true" : "false");
+    return pass;
+}
+
+#ifdef CONFIG_MOTOR_AUTOTUNE
+/* ── Autotune check ─────────────────────────────────────────────────────── *
+ * The sim plant's steady state is near-affine in duty, ~60 rpm per %, so  *
+ * the identified static gain must land within AUTOTUNE_K_TOL_PCT of that *
+ * and the experiment must finish. The gains' quality is judged by the    *
+ * scenario's step bench, which runs on them.                              */
+#define AUTOTUNE_K_EXPECT       60.0f
+#define AUTOTUNE_K_TOL_PCT      25
+
+static bool autotune_report(void)
+{
+    struct autotune_result r;
+    autotune_get_result(&r);
+
+    float k_err = (r.k_rpm_pct - AUTOTUNE_K_EXPECT) / AUTOTUNE_K_EXPECT;
+    bool  pass  = r.status == AUTOTUNE_DONE &&
+                  k_err * 100.0f <=  (float)AUTOTUNE_K_TOL_PCT &&
+                  k_err * 100.0f >= -(float)AUTOTUNE_K_TOL_PCT;
+
+    printk("AUTOTUNE {\"status\":%u,\"error\":%u,\"rpm\":%d,"
+           "\"u0_cpct\":%d,\"k_mrpm_pct\":%d,\"tau_us\":%d,\"dead_us\":%d,"
+           "\"tu_us\":%d,\"amp_drpm\":%d,\"kp_u\":%d,\"ki_u\":%d,"
+           "\"ff_gain_u\":%d,\"ff_offset_cpct\":%d,\"pass\":%s}\n",
+           r.status, r.error, r.rpm, (int)(r.u0_pct * 100.0f),
+           (int)(r.k_rpm_pct * 1000.0f), (int)(r.tau_s * 1e6f),
+           (int)(r.dead_s * 1e6f), (int)(r.tu_s * 1e6f),
+           (int)(r.amp_rpm * 10.0f), (int)(r.kp * 1e6f), (int)(r.ki * 1e6f),
+           (int)(r.ff_gain * 1e6f), (int)(r.ff_offset * 100.0f),
+           pass ? "true" : "false");
+    return pass;
+}
+#endif
+
+/* ── Parameter check ────────────────────────────────────────────────────── *
+ * The bad batch is refused at its second entry and none of it is staged; *
+ * the good one is live by the end, both in the registry and in the       *
+ * staged copy the BLE side reads.                                         */
+static bool params_report(void)
+{
+    struct param_entry e[] = {
+        { .id = PARAM_RPM_FILTER_TAU_US },
+        { .id = PARAM_STALL_TIMEOUT_MS },
+        { .id = PARAM_HALL_TIMEOUT_MS },
+    };
+    params_get(e, ARRAY_SIZE(e));
+
+    bool pass = param_batch_rc[0] == -2 && param_batch_rc[1] == 0 &&
+                e[0].v.u == 40000 && e[1].v.u == 3000 && e[2].v.u == 100 &&
+                param_u32(PARAM_RPM_FILTER_TAU_US) == 40000 &&
+                param_u32(PARAM_STALL_TIMEOUT_MS) == 3000;
+
+    printk("PARAMS {\"bad_rc\":%d,\"retune_rc\":%d,\"tau_us\":%u,"
+           "\"stall_ms\":%u,\"hall_ms\":%u,\"pass\":%s}\n",
+           param_batch_rc[0], param_batch_rc[1], e[0].v.u, e[1].v.u, e[2].v.u,
+           pass ? "true" : "false");
+    return pass;
+}
+
+#ifdef CONFIG_MOTOR_SPEED_OBSERVER
+/* ── Observer check ─────────────────────────────────────────────────────── *
+ * From OBS_CHECK_T0_MS on (300 → 120 → 60 rpm) the observer, which the   *
+ * loop runs on, is scored against the plant's true speed next to the     *
+ * 6-edge average the hall ISR still keeps, both on the same motion. The  *
+ * observer must be the closer of the two, and the shaft itself must stay *
+ * within OBS_TRACK_MAX_RPM of the target on average — on the 6-edge      *
+ * average the loop limit-cycles here between a stall and ~190 rpm and    *
+ * scores ~30 rpm.                                                         */
+#define OBS_CHECK_T0_MS     2000
+#define OBS_TRACK_MAX_RPM   8
+
+static struct {
+    uint64_t obs_err, avg_err, track_err, conf;
+    uint32_t n;
+} obs_acc;
+
+static void observer_sample(uint32_t t_ms, int32_t target)
+{
+    if (t_ms < OBS_CHECK_T0_MS) {
+        return;
+    }
+    struct speed_obs_result o;
+    speed_obs_get(&o);
+    int32_t truth = motor_sim_get_rpm();
+    int32_t avg   = (int32_t)atomic_get(&g_motor_speed_atomic);
+
+    obs_acc.obs_err   += (uint32_t)abs(o.rpm - truth);
+    obs_acc.avg_err   += (uint32_t)abs(avg - truth);
+    obs_acc.track_err += (uint32_t)abs(target - truth);
+    obs_acc.conf      += o.confidence;
+    obs_acc.n++;
+}
+
+static bool observer_report(void)
+{
+    uint32_t n     = obs_acc.n ? obs_acc.n : 1;
+    int32_t  track = (int32_t)(obs_acc.track_err / n);
+    bool     pass  = obs_acc.n > 0 && obs_acc.obs_err < obs_acc.avg_err &&
+                     track <= OBS_TRACK_MAX_RPM;
+
+    printk("OBSERVER {\"obs_err_drpm\":%d,\"avg6_err_drpm\":%d,"
+           "\"track_err_rpm\":%d,\"conf_pct\":%d,\"pass\":%s}\n",
+           (int32_t)(obs_acc.obs_err * 10U / n),
+           (int32_t)(obs_acc.avg_err * 10U / n), track,
+           (int32_t)(obs_acc.conf / n), pass ? "true" : "false");
+    return pass;
+}
+#endif
+
+/* ── Top speed check ───────────────────────────────────────────────────── *
+ * Mean true speed, current and duty over the last second at full command *
+ * under 20 mN·m. Commutating on the edge the loop saturates at ~5600 rpm; *
+ * with phase advance it must reach TOP_MIN_RPM. Without it the line is   *
+ * report only.                                                            */
+#define TOP_CHECK_T0_MS     5000
+#define TOP_MIN_RPM         5900
+
+static struct {
+    int64_t  rpm, current_ma, pulse;
+    uint32_t n;
+} top_acc;
+
+static void top_speed_sample(uint32_t t_ms)
+{
+    if (t_ms < TOP_CHECK_T0_MS) {
+        return;
+    }
+    top_acc.rpm        += motor_sim_get_rpm();
+    top_acc.current_ma += motor_sim_get_current_ma();
+    top_acc.pulse      += motor_sim_get_pulse();
+    top_acc.n++;
+}
+
+static bool top_speed_report(void)
+{
+    uint32_t n    = top_acc.n ? top_acc.n : 1;
+    int32_t  rpm  = (int32_t)(top_acc.rpm / n);
+    bool     pass = !IS_ENABLED(CONFIG_MOTOR_PHASE_ADVANCE) ||
+                    (top_acc.n > 0 && rpm >= TOP_MIN_RPM);
+
+    printk("TOPSPEED {\"rpm\":%d,\"current_ma\":%d,\"duty_dpct\":%d,"
+           "\"advance\":%s,\"pass\":%s}\n",
+           rpm, (int32_t)(top_acc.current_ma / n),
+           (int32_t)(top_acc.pulse * 1000 / n / BLDC_TIM1_ARR),
+           IS_ENABLED(CONFIG_MOTOR_PHASE_ADVANCE) ? "true" : "false",
+           pass ? "true" : "false");
+    return pass;
+}
+
+/* ── Hall compensation check ──────────────────────────────────────────── *
+ * The ISR speed against the true speed at 1500 rpm with misplaced halls: *
+ * before calibration on the 6-edge window, after it on the compensated   *
+ * short window. The single-edge figure from the raw last interval shows *
+ * what the window was hiding. With the option built in the learned      *
+ * weights must match the plant's sector widths within HALL_W_TOL_PPM     *
+ * and the short window must come within HALL_NOISE_TOL_DRPM of the       *
+ * 6-edge one — both sit at the sub-rpm ripple of the true speed, where  *
+ * the single raw edge is off by ~150 rpm.                                */
+#define HALL_BEFORE_T0_MS   1500
+#define HALL_BEFORE_T1_MS   3000
+#define HALL_AFTER_T0_MS    5500
+#define HALL_W_TOL_PPM      5000
+#define HALL_NOISE_TOL_DRPM 10          // 1 rpm
+
+static struct {
+    uint64_t raw1_err, avg_err, comp_err;
+    uint32_t n_before, n_after;
+} hall_acc;
+
+static void hall_comp_sample(uint32_t t_ms)
+{
+    int32_t truth = motor_sim_get_rpm();
+    int32_t isr   = (int32_t)atomic_get(&g_motor_speed_atomic);
+
+    if (t_ms >= HALL_BEFORE_T0_MS && t_ms < HALL_BEFORE_T1_MS) {
+        struct bldc_edge_snapshot s;
+        bldc_get_edge_snapshot(&s);
+        int32_t raw1 = s.dt_us ? (int32_t)(60000000U / (BLDC_EDGES_PER_REV * s.dt_us)) : 0;
+
+        hall_acc.raw1_err += (uint32_t)abs(raw1 - truth);
+        hall_acc.avg_err  += (uint32_t)abs(isr - truth);
+        hall_acc.n_before++;
+    } else if (t_ms >= HALL_AFTER_T0_MS) {
+        hall_acc.comp_err += (uint32_t)abs(isr - truth);
+        hall_acc.n_after++;
+    }
+}
+
+static bool hall_comp_report(void)
+{
+    uint32_t nb   = hall_acc.n_before ? hall_acc.n_before : 1;
+    uint32_t na   = hall_acc.n_after ? hall_acc.n_after : 1;
+    int32_t  raw1 = (int32_t)(hall_acc.raw1_err * 10U / nb);
+    int32_t  avg6 = (int32_t)(hall_acc.avg_err * 10U / nb);
+    int32_t  comp = (int32_t)(hall_acc.comp_err * 10U / na);
+    bool     pass = true;
+    int      status = -1;
+    int32_t  w_err  = -1;
+
+#ifdef CONFIG_MOTOR_HALL_COMP
+    /* Firmware sectors run along 6→4→5→1→3→2; the plant gives the true
+     * width of the sector each hall state stands for.                */
+    static const uint8_t comp_hall[6] = { 6, 4, 5, 1, 3, 2 };
+    struct hall_comp_result r;
+    hall_comp_get_result(&r);
+
+    w_err = 0;
+    for (int s = 0; s < 6; s++) {
+        float   expect = 1.0f / motor_sim_get_sector_width(comp_hall[s]);
+        int32_t ppm    = (int32_t)((r.weight[s] - expect) * 1e6f);
+        w_err = MAX(w_err, abs(ppm));
+    }
+    status = r.status;
+    pass   = r.status == HALL_COMP_DONE && w_err <= HALL_W_TOL_PPM &&
+             hall_acc.n_after > 0 && comp <= avg6 + HALL_NOISE_TOL_DRPM;
+#endif
+
+    printk("HALLCOMP {\"status\":%d,\"w_err_ppm\":%d,\"raw1_err_drpm\":%d,"
+           "\"avg6_err_drpm\":%d,\"comp_err_drpm\":%d,\"pass\":%s}\n",
+           status, w_err, raw1, avg6, comp, pass ? "true" : "false");
+    return pass;
+}
+
+/* ── Estop check ────────────────────────────────────────────────────────── *
+ * Plant time from motor_trigger_estop() to the first substep in which no  *
+ * high side drives. Through the TIM1 break that is the very next substep; *
+ * left to the control tick the bridge keeps driving through the whole    *
+ * plant step before it. Without the break the line is report only.      */
+#define ESTOP_MAX_US        100
+
+static bool estop_report(void)
+{
+    uint32_t off    = motor_sim_drive_off_us();
+    int32_t  off_us = (off >= estop_cmd_us) ? (int32_t)(off - estop_cmd_us) : -1;
+    bool     pass   = !IS_ENABLED(CONFIG_MOTOR_ESTOP_BREAK) ||
+                      (off_us >= 0 && off_us <= ESTOP_MAX_US);
+
+    printk("ESTOP {\"off_us\":%d,\"break\":%s,\"pass\":%s}\n",
+           off_us, IS_ENABLED(CONFIG_MOTOR_ESTOP_BREAK) ? "true" : "false",
+           pass ? "true" : "false");
+    return pass;
+}
+
+/* ── Position between hall edges ────────────────────────────────────────── *
+ * The last move, to a target between two hall edges: time from its      *
+ * command to the settled flag, and the true shaft angle against the      *
+ * target once settled. Stopped, the halls only place the shaft within   *
+ * its 15° sector, so the limit is half a sector. Enforced with the      *
+ * observer and the braking bridge; without them the move coasts past   *
+ * its target on a hall speed six edges late, and the line is report   *
+ * only.                                                                 */
+#define POSF_MAX_SETTLE_MS  450
+#define POSF_MAX_ERR_CDEG   (BLDC_CDEG_PER_EDGE / 2)
+
+static int32_t posf_settle_ms;
+
+static void position_fine_sample(uint32_t t_ms)
+{
+    uint32_t t_cmd = ev_position_fine[ARRAY_SIZE(ev_position_fine) - 1].t_ms;
+
+    if (t_ms <= t_cmd) {
+        posf_settle_ms = -1;
+    } else if (posf_settle_ms < 0 && motor_is_settled()) {
+        posf_settle_ms = (int32_t)(t_ms - t_cmd);
+    }
+}
+
+static bool position_fine_report(void)
+{
+    int32_t target = ev_position_fine[ARRAY_SIZE(ev_position_fine) - 1].value;
+    int32_t est    = bldc_get_position_cdeg();
+    int32_t truth  = motor_sim_get_angle_cdeg();
+    int32_t err    = target * 100 - truth;
+    if (err >  18000) err -= 36000;
+    if (err < -18000) err += 36000;
+
+    bool pass = !IS_ENABLED(CONFIG_MOTOR_SPEED_OBSERVER) ||
+                !IS_ENABLED(CONFIG_MOTOR_FOUR_QUADRANT) ||
+                (motor_is_settled() &&
+                 posf_settle_ms >= 0 && posf_settle_ms <= POSF_MAX_SETTLE_MS &&
+                 err >= -POSF_MAX_ERR_CDEG && err <= POSF_MAX_ERR_CDEG);
+
+    printk("POSITION {\"target_cdeg\":%d,\"est_cdeg\":%d,\"true_cdeg\":%d,"
+           "\"settle_ms\":%d,\"pass\":%s}\n",
+           target * 100, est, truth, posf_settle_ms, pass ? "true" : "false");
+    return pass;
+}
+
+/** @brief Run one scenario from power-on state.
+ *  @return FNV-1a hash of every tick's feedback and duty.
+ */
+static uint32_t run_scenario(const struct sim_scenario *sc,
+                             struct motor_stats *final,
+                             struct bench_acc *acc)
+{
+    motor_init();
+    motor_sim_reset();
+    params_defaults();          // motor_control_reset() applies them
+    motor_control_reset();
+    trace_rearm();
+#ifdef CONFIG_MOTOR_SPEED_OBSERVER
+    memset(&obs_acc, 0, sizeof(obs_acc));
+#endif
+    memset(&top_acc, 0, sizeof(top_acc));
+    memset(&hall_acc, 0, sizeof(hall_acc));
+    estop_cmd_us = 0;
+
+    uint32_t hash  = FNV_OFFSET;
+    uint8_t  next  = 0;
+    uint32_t ticks = (sc->duration_ms * 1000U) / SIM_TICK_US;
+
+    for (uint32_t tick = 0; tick < ticks; tick++) {
+        uint32_t t_ms = (uint32_t)(((uint64_t)tick * SIM_TICK_US) / 1000U);
+
+        while (next < sc->n_events && sc->events[next].t_ms <= t_ms) {
+            apply_event(&sc->events[next++]);
+        }
+
+        motor_sim_step();
+        motor_control_step(SIM_TICK_DT);
+
+        motor_get_snapshot(final);
+        hash = fnv1a_u32(hash, (uint32_t)final->current_speed);
+        hash = fnv1a_u32(hash, (uint32_t)final->filtered_speed);
+        hash = fnv1a_u32(hash, (uint32_t)final->current_position);
+        hash = fnv1a_u32(hash, final->motor_status);
+        hash = fnv1a_u32(hash, (uint32_t)motor_sim_get_pulse());
+
+        if (sc->bench) {
+            bench_sample(sc->bench, acc, t_ms, final->current_speed,
+                         final->target_speed);
+        }
+#ifdef CONFIG_MOTOR_SPEED_OBSERVER
+        if (sc->events == ev_low_speed) {
+            observer_sample(t_ms, final->target_speed);
+        }
+#endif
+        if (sc->events == ev_top_speed) {
+            top_speed_sample(t_ms);
+        }
+        if (sc->events == ev_hall_comp) {
+            hall_comp_sample(t_ms);
+        }
+        if (sc->events == ev_position_fine) {
+            position_fine_sample(t_ms);
+        }
+    }
+
+    return hash;
+}
+
+/* ========================================================================= *
+ * PUBLIC API                                                                *
+ * ========================================================================= */
+int sim_runner_run(void)
+{
+    uint32_t mismatches  = 0;
+    uint32_t bench_fails = 0;
+    uint64_t sim_ms      = 0;
+
+    printk("SIM virtual time: %u scenarios x %u runs\n",
+           (unsigned int)ARRAY_SIZE(scenarios), CONFIG_MOTOR_SIM_RUNS);
+
+#ifdef CONFIG_MOTOR_PID_SELFTEST
+    // Fixed-point vs float PID equivalence counts as a bench
+    bench_fails += pid_q_selftest() ? 1 : 0;
+#endif
+#ifdef CONFIG_MOTOR_HALL_SELFTEST
+    bench_fails += bldc_hall_selftest() ? 1 : 0;
+#endif
+#ifdef CONFIG_MOTOR_VAULT_BENCH
+    bench_fails += motor_vault_bench() ? 1 : 0;
+#endif
+
+    for (size_t i = 0; i < ARRAY_SIZE(scenarios); i++) {
+        const struct sim_scenario *sc = &scenarios[i];
+        struct motor_stats final;
+        struct bench_acc   acc;
+        uint32_t first = 0;
+
+        for (uint32_t run = 0; run < CONFIG_MOTOR_SIM_RUNS; run++) {
+            memset(&acc, 0, sizeof(acc));
+            uint32_t hash = run_scenario(sc, &final, &acc);
+            sim_ms += sc->duration_ms;
+
+            if (run == 0) {
+                first = hash;
+                printk("SIM %-12s %5ums  rpm=%5d  pos=%3d  status=0x%02X  "
+                       "faults=%u  hash=0x%08x\n",
+                       sc->name, sc->duration_ms, final.current_speed,
+                       final.current_position, final.motor_status,
+                       motor_sim_get_comm_faults(), hash);
+
+                if (sc->bench) {
+                    struct bench_result res;
+                    bench_score(sc->bench, &acc, &res);
+                    bench_print(sc->name, sc->bench, &res);
+                    bench_fails += res.pass ? 0 : 1;
+                }
+                if (sc->events == ev_hall_drop) {
+                    bench_fails += hall_drop_report() ? 0 : 1;
+                }
+#ifdef CONFIG_MOTOR_AUTOTUNE
+                if (sc->events == ev_autotune) {
+                    bench_fails += autotune_report() ? 0 : 1;
+                }
+#endif
+                if (sc->events == ev_params) {
+                    bench_fails += params_report() ? 0 : 1;
+                }
+                if (sc->events == ev_top_speed) {
+                    bench_fails += top_speed_report() ? 0 : 1;
+                }
+                if (sc->events == ev_hall_comp) {
+                    bench_fails += hall_comp_report() ? 0 : 1;
+                }
+                if (sc->events == ev_estop) {
+                    bench_fails += estop_report() ? 0 : 1;
+                }
+                if (sc->events == ev_position_fine) {
+                    bench_fails += position_fine_report() ? 0 : 1;
+                }
+#ifdef CONFIG_MOTOR_SPEED_OBSERVER
+                if (sc->events == ev_low_speed) {
+                    bench_fails += observer_report() ? 0 : 1;
+                }
+#endif
+            } else if (hash != first) {
+                mismatches++;
+                printk("SIM %-12s run %u: hash 0x%08x != 0x%08x — NOT DETERMINISTIC\n",
+                       sc->name, run, hash, first);
+            }
+        }
+    }
+
+    printk("SIM done: %llu s simulated, %s, bench %s\n",
+           sim_ms / 1000U, mismatches ? "MISMATCH" : "deterministic",
+           bench_fails ? "FAIL" : "pass");
+    return (mismatches || bench_fails) ? -1 : 0;
+}
@@ -0,0 +1,96 @@
+#include "telemetry.h"
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/barrier.h>
+
+#ifdef CONFIG_MOTOR_SIM_VIRTUAL_TIME
+#include "motor_sim.h"
+#define TELEMETRY_NOW_MS()  (motor_sim_time_us() / 1000U)   // plant clock
+#else
+#define TELEMETRY_NOW_MS()  k_uptime_get_32()
+#endif
+
+/* ========================================================================= *
+ * RING CONFIG                                                               *
+ * ========================================================================= */
+// 128 samples = 1.28s at 100Hz — rides out a few missed connection events
+#define TELEMETRY_RING_SIZE     128
+BUILD_ASSERT((TELEMETRY_RING_SIZE & (TELEMETRY_RING_SIZE - 1)) == 0,
+             "ring size must be a power of two");
+
+/* ========================================================================= *
+ * SPSC RING                                                                 *
+ * head is written only by the producer (PID thread), tail only by the     *
+ * consumer (telemetry thread). Free-running counters; index = count & mask.*
+ * ========================================================================= */
+static struct telemetry_sample ring[TELEMETRY_RING_SIZE];
+static volatile uint32_t ring_head = 0;
+static volatile uint32_t ring_tail = 0;
+static uint16_t          next_seq  = 0;     // producer-owned
+static atomic_t          stream_on = ATOMIC_INIT(0);
+
+static inline int16_t clamp_i16(int32_t v)
+{
+    if (v >  INT16_MAX) return INT16_MAX;
+    if (v <  INT16_MIN) return INT16_MIN;
+    return (int16_t)v;
+}
+
+void telemetry_stream_enable(bool enable)
+{
+    atomic_set(&stream_on, enable ? 1 : 0);
+}
+
+void telemetry_push(int32_t raw_rpm, int32_t filtered_rpm, int32_t target_rpm,
+                    float duty_pct)
+{
+    if (!atomic_get(&stream_on)) {
+        return;
+    }
+
+    uint16_t seq  = next_seq++;
+    uint32_t head = ring_head;
+    if (head - ring_tail >= TELEMETRY_RING_SIZE) {
+        return;     // full — the skipped seq tells the client
+    }
+
+    struct telemetry_sample *s = &ring[head & (TELEMETRY_RING_SIZE - 1)];
+    s->t_ms         = TELEMETRY_NOW_MS();
+    s->seq          = seq;
+    s->raw_rpm      = clamp_i16(raw_rpm);
+    s->filtered_rpm = clamp_i16(filtered_rpm);
+    s->target_rpm   = clamp_i16(target_rpm);
+    s->duty_cpct    = (duty_pct <= 0.0f) ? 0U
+                    : (duty_pct >= 100.0f) ? 10000U
+                    : (uint16_t)(duty_pct * 100.0f);
+
+    barrier_dmem_fence_full();   // sample visible before the new head
+    ring_head = head + 1;
+}
+
+bool telemetry_peek(uint32_t i, struct telemetry_sample *out)
+{
+    uint32_t tail = ring_tail;
+    if (ring_head - tail <= i) {
+        return false;
+    }
+    barrier_dmem_fence_full();
+    *out = ring[(tail + i) & (TELEMETRY_RING_SIZE - 1)];
+    return true;
+}
+
+void telemetry_consume(uint32_t n)
+{
+    barrier_dmem_fence_full();   // copies done before the slots are released
+    ring_tail += n;
+}
+
+void telemetry_flush(void)
+{
+    ring_tail = ring_head;
+}
+
+uint32_t telemetry_pending(void)
+{
+    return ring_head - ring_tail;
+}
@@ -0,0 +1,150 @@
+#include "trace.h"
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/barrier.h>
+#include <string.h>
+
+#if defined(CONFIG_MOTOR_SIM)
+#include "motor_sim.h"
+#else
+#include <soc.h>
+#endif
+
+/* ========================================================================= *
+ * BUFFER CONFIG                                                             *
+ * ========================================================================= */
+#define TRACE_DEPTH     CONFIG_MOTOR_TRACE_DEPTH
+BUILD_ASSERT((TRACE_DEPTH & (TRACE_DEPTH - 1)) == 0,
+             "CONFIG_MOTOR_TRACE_DEPTH must be a power of two");
+BUILD_ASSERT(sizeof(struct trace_entry) == 8, "trace entry must stay 8 bytes");
+
+/* Same 1 MHz base the hall ISR uses for its edge timing */
+#if defined(CONFIG_MOTOR_SIM)
+#define TRACE_NOW_US()  motor_sim_time_us()     // plant clock — hall edges use it too
+#else
+#define TRACE_NOW_US()  (TIM2->CNT)     // free-running, started by bldc_driver_init()
+#endif
+
+/* ========================================================================= *
+ * RING                                                                      *
+ * trace_widx is free-running; each writer reserves its slot with one      *
+ * atomic increment, so the hall ISR can preempt the PID thread mid-entry  *
+ * without either losing or sharing a slot. Entries are only read back     *
+ * once frozen, so there is no consumer index.                              *
+ * A reservation and its store are not one step: a freeze can land between *
+ * them, and a writer that passed the frozen check just before the freeze  *
+ * reserves a slot past trace_end, wrapping onto the oldest entry. So each *
+ * writer clears the slot's mark in trace_seq[], stores, then publishes    *
+ * index + 1; a read returns any slot whose mark does not match, before    *
+ * and after the copy, as TRACE_EV_NONE.                                    *
+ * ========================================================================= */
+static struct trace_entry trace_buf[TRACE_DEPTH];
+static uint32_t           trace_seq[TRACE_DEPTH];   // index + 1 of the entry last stored, 0 = none
+static atomic_t           trace_widx     = ATOMIC_INIT(0);
+static atomic_t           trace_frozen   = ATOMIC_INIT(0);
+static atomic_t           trace_triggers = ATOMIC_INIT(TRACE_TRIG_DEFAULT);
+static uint32_t           trace_end      = 0;   // trace_widx at freeze time
+
+void trace_record(uint8_t event, uint8_t arg, uint16_t val)
+{
+    if (atomic_get(&trace_frozen)) {
+        return;
+    }
+
+    uint32_t idx  = (uint32_t)atomic_inc(&trace_widx);
+    uint32_t slot = idx & (TRACE_DEPTH - 1);
+    struct trace_entry *e = &trace_buf[slot];
+
+    trace_seq[slot] = 0;
+    barrier_dmem_fence_full();      // mark cleared before the entry changes
+    e->ts_us = TRACE_NOW_US();
+    e->event = event;
+    e->arg   = arg;
+    e->val   = val;
+
+    barrier_dmem_fence_full();      // entry before its mark
+    trace_seq[slot] = idx + 1;
+}
+
+void trace_trigger(uint8_t trig)
+{
+    if (atomic_get(&trace_triggers) & trig) {
+        trace_freeze(trig);
+    }
+}
+
+void trace_freeze(uint8_t reason)
+{
+    if (atomic_get(&trace_frozen)) {
+        return;     // first trigger wins — keep the history that led to it
+    }
+
+    trace_record(TRACE_EV_TRIGGER, reason, 0);
+
+    unsigned int key = irq_lock();
+    if (!atomic_get(&trace_frozen)) {
+        trace_end = (uint32_t)atomic_get(&trace_widx);
+        barrier_dmem_fence_full();
+        atomic_set(&trace_frozen, 1);
+    }
+    irq_unlock(key);
+}
+
+void trace_set_triggers(uint8_t mask)
+{
+    atomic_set(&trace_triggers, mask);
+}
+
+void trace_rearm(void)
+{
+    unsigned int key = irq_lock();
+    atomic_set(&trace_widx, 0);
+    trace_end = 0;
+    memset(trace_seq, 0, sizeof(trace_seq));    // the new indices restart at 0
+    barrier_dmem_fence_full();
+    atomic_set(&trace_frozen, 0);
+    irq_unlock(key);
+}
+
+bool trace_is_frozen(void)
+{
+    return atomic_get(&trace_frozen) != 0;
+}
+
+uint16_t trace_count(void)
+{
+    if (!trace_is_frozen()) {
+        return 0;
+    }
+    return (uint16_t)((trace_end < TRACE_DEPTH) ? trace_end : TRACE_DEPTH);
+}
+
+uint16_t trace_read(uint16_t first, struct trace_entry *out, uint16_t max)
+{
+    uint16_t count = trace_count();
+    if (first >= count) {
+        return 0;
+    }
+
+    uint16_t n = count - first;
+    if (n > max) {
+        n = max;
+    }
+
+    uint32_t oldest = trace_end - count;
+    for (uint16_t i = 0; i < n; i++) {
+        uint32_t idx  = oldest + first + i;
+        uint32_t slot = idx & (TRACE_DEPTH - 1);
+
+        if (trace_seq[slot] != idx + 1) {
+            out[i] = (struct trace_entry){ .event = TRACE_EV_NONE };
+            continue;               // reserved, not stored — or overwritten after the freeze
+        }
+        out[i] = trace_buf[slot];
+        barrier_dmem_fence_full();  // mark re-checked after the copy
+        if (trace_seq[slot] != idx + 1) {
+            out[i] = (struct trace_entry){ .event = TRACE_EV_NONE };
+        }
+    }
+    return n;
+}
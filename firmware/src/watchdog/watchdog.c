@@ -11,12 +11,10 @@ static struct k_work_delayable watchdog_work;  // WORKQUEUE THREAD -> THREAD THA
 
 // EMERGENCY STOP FUNCTION IF WATCHDOG EXPIRES -> WILL HALT MOTOR
 static void watchdog_expired(struct k_work *work){
-    LOG_ERR("Watchdog Timer Expired - Connection Lost - HALTING MOTOR.");
-
+    motor_trigger_estop();              // OUTPUTS FIRST, THEN THE LOG
     motor_set_sync_warning(true);
-    motor_trigger_estop();
-    
-    LOG_INF("MOTOR HALTED");
+
+    LOG_ERR("Watchdog Timer Expired - Connection Lost - MOTOR HALTED.");
 }
 
 // INIT WATCHDOG